@@ -572,11 +572,12 @@ thunkCode cl_info fv_details _cc node arity body
         { -- Overwrite with black hole if necessary
           -- but *after* the heap-overflow check
         ; tickyEnterThunk cl_info
-        ; when (blackHoleOnEntry cl_info && node_points)
-                (blackHoleIt node)
+        ; upd_info <- if blackHoleOnEntry cl_info && node_points
+                        then blackHoleIt node
+                        else return Nothing
 
           -- Push update frame
-        ; setupUpdate cl_info node $
+        ; setupUpdate cl_info node upd_info $
             -- We only enter cc after setting up update so
             -- that cc of enclosing scope will be recorded
             -- in update frame CAF/DICT functions will be
@@ -592,14 +593,21 @@ thunkCode cl_info fv_details _cc node arity body
 --              Update and black-hole wrappers
 ------------------------------------------------------------------------
 
-blackHoleIt :: LocalReg -> FCode ()
+blackHoleIt :: LocalReg -> FCode (Maybe CmmExpr)
 -- Only called for closures with no args
 -- Node points to the closure
+-- Returns the info pointer for the update frame, if the choice between
+-- blackholing and not was made at runtime (-fadaptive-blackholing)
 blackHoleIt node_reg
-  = emitBlackHoleCode (CmmReg (CmmLocal node_reg))
+  = blackHoleCode True (CmmReg (CmmLocal node_reg))
 
 emitBlackHoleCode :: CmmExpr -> FCode ()
-emitBlackHoleCode node = do
+-- For hand-written Cmm, which pushes its own update frame, so only
+-- does eager blackholing
+emitBlackHoleCode node = void (blackHoleCode False node)
+
+blackHoleCode :: Bool -> CmmExpr -> FCode (Maybe CmmExpr)
+blackHoleCode allow_adaptive node = do
   dflags <- getDynFlags
 
   -- Eager blackholing is normally disabled, but can be turned on with
@@ -626,17 +634,53 @@ emitBlackHoleCode node = do
              -- profiling), so currently eager blackholing doesn't
              -- work with profiling.
 
-  when eager_blackholing $ do
-    emitStore (cmmOffsetW dflags node (fixedHdrSizeW dflags))
-                  (CmmReg (CmmGlobal CurrentTSO))
-    emitPrimCall [] MO_WriteBarrier []
-    emitStore node (CmmReg (CmmGlobal EagerBlackholeInfo))
-
-setupUpdate :: ClosureInfo -> LocalReg -> FCode () -> FCode ()
+       adaptive_blackholing =  allow_adaptive
+                            && not (gopt Opt_SccProfilingOn dflags)
+                            && gopt Opt_AdaptiveBlackHoling dflags
+
+       blackhole = do
+         emitStore (cmmOffsetW dflags node (fixedHdrSizeW dflags))
+                       (CmmReg (CmmGlobal CurrentTSO))
+         emitPrimCall [] MO_WriteBarrier []
+         emitStore node (CmmReg (CmmGlobal EagerBlackholeInfo))
+
+  if eager_blackholing
+     then do blackhole; return Nothing
+     else if not adaptive_blackholing
+     then return Nothing
+     else do
+       -- With -fadaptive-blackholing, only blackhole the thunk if the RTS
+       -- has seen contention on its info table: see Note [Adaptive eager
+       -- blackholing] in rts/BlackHoles.c.  The RTS may set the byte at
+       -- any time, so we read it once and choose the update frame here
+       -- too: a thunk we blackholed needs stg_bh_upd_frame, which wakes
+       -- up the threads that block on it before we update it.
+       let info  = CmmLoad node (bWord dflags)
+           slot  = cmmAndWord dflags
+                     (cmmUShrWord dflags info
+                        (mkIntExpr dflags (eAGER_BH_SHIFT dflags)))
+                     (mkIntExpr dflags (2 ^ eAGER_BH_TABLE_BITS dflags - 1))
+           table = CmmLit (CmmLabel (mkCmmDataLabel rtsUnitId
+                                       (fsLit "eager_blackhole_table")))
+           flag  = CmmMachOp (MO_UU_Conv W8 (wordWidth dflags))
+                     [CmmLoad (cmmAddWord dflags table slot) b8]
+       upd_info <- newTemp (bWord dflags)
+       code <- getCode $ do
+         blackhole
+         emitAssign (CmmLocal upd_info) (mkLblExpr mkBHUpdInfoLabel)
+       emit =<< mkCmmIfThenElse (cmmNeWord dflags flag (zeroExpr dflags))
+                  code
+                  (mkAssign (CmmLocal upd_info) (mkLblExpr mkUpdInfoLabel))
+       return (Just (CmmReg (CmmLocal upd_info)))
+
+setupUpdate :: ClosureInfo -> LocalReg -> Maybe CmmExpr -> FCode ()
+            -> FCode ()
         -- Nota Bene: this function does not change Node (even if it's a CAF),
         -- so that the cost centre in the original closure can still be
         -- extracted by a subsequent enterCostCentre
-setupUpdate closure_info node body
+        -- The Maybe CmmExpr is the update frame info pointer chosen by
+        -- blackHoleIt, if any
+setupUpdate closure_info node upd_info body
   | not (lfUpdatable (closureLFInfo closure_info))
   = body
 
@@ -654,7 +698,10 @@ setupUpdate closure_info node body
               lbl | bh        = mkBHUpdInfoLabel
                   | otherwise = mkUpdInfoLabel
 
-          pushUpdateFrame lbl (CmmReg (CmmLocal node)) body
+              info = maybe (mkLblExpr lbl) id upd_info
+
+          pushUpdateFrameInfo info (CmmReg (CmmLocal node)) body
+
 
   | otherwise   -- A static closure
   = do  { tickyUpdateBhCaf closure_info
@@ -674,7 +721,10 @@ setupUpdate closure_info node body
 -- at the old end of the area.
 --
 pushUpdateFrame :: CLabel -> CmmExpr -> FCode () -> FCode ()
-pushUpdateFrame lbl updatee body
+pushUpdateFrame lbl = pushUpdateFrameInfo (mkLblExpr lbl)
+
+pushUpdateFrameInfo :: CmmExpr -> CmmExpr -> FCode () -> FCode ()
+pushUpdateFrameInfo info updatee body
   = do
        updfr  <- getUpdFrameOff
        dflags <- getDynFlags
@@ -682,16 +732,20 @@ pushUpdateFrame lbl updatee body
            hdr         = fixedHdrSize dflags
            frame       = updfr + hdr + sIZEOF_StgUpdateFrame_NoHdr dflags
        --
-       emitUpdateFrame dflags (CmmStackSlot Old frame) lbl updatee
+       emitUpdateFrameInfo dflags (CmmStackSlot Old frame) info updatee
        withUpdFrameOff frame body
 
 emitUpdateFrame :: DynFlags -> CmmExpr -> CLabel -> CmmExpr -> FCode ()
-emitUpdateFrame dflags frame lbl updatee = do
+emitUpdateFrame dflags frame lbl
+  = emitUpdateFrameInfo dflags frame (mkLblExpr lbl)
+
+emitUpdateFrameInfo :: DynFlags -> CmmExpr -> CmmExpr -> CmmExpr -> FCode ()
+emitUpdateFrameInfo dflags frame info updatee = do
   let
            hdr         = fixedHdrSize dflags
            off_updatee = hdr + oFFSET_StgUpdateFrame_updatee dflags
   --
-  emitStore frame (mkLblExpr lbl)
+  emitStore frame info
   emitStore (cmmOffset dflags frame off_updatee) updatee
   initUpdFrameProf frame
 
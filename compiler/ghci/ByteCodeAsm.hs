@@ -152,7 +152,7 @@ assembleOneBCO hsc_env pbco = do
 assembleBCO :: DynFlags -> ProtoBCO Name -> IO UnlinkedBCO
 assembleBCO dflags (ProtoBCO nm instrs bitmap bsize arity _origin _malloced) = do
   -- pass 1: collect up the offsets of the local labels.
-  let asm = mapM_ (assembleI dflags) instrs
+  let asm = assembleInstrs dflags instrs
 
       initial_offset = 0
 
@@ -340,6 +340,61 @@ largeArg16s :: DynFlags -> Word
 largeArg16s dflags | wORD_SIZE_IN_BITS dflags == 64 = 4
                    | otherwise                      = 2
 
+{-
+Note [Superinstructions]
+~~~~~~~~~~~~~~~~~~~~~~~~
+Every bytecode instruction costs the interpreter a dispatch, and a few
+pairs of instructions are so common that it pays to give each pair an
+opcode of its own:
+
+  PUSH_L o; ENTER         ==>  PUSH_L_ENTER o       (enter a local)
+  PUSH_G g; ENTER         ==>  PUSH_G_ENTER g       (enter a global)
+  SLIDE n by; ENTER       ==>  SLIDE_ENTER n by     (tail call)
+  PUSH_APPLY_P..; PUSH_L  ==>  PUSH_APPLY_PTRS_L n o
+
+The last one comes from tail calls (ByteCodeGen.doTailCall), where the
+stg_ap_p..p frame for n pointer arguments is followed by the push of the
+function, or of the next group of arguments, usually from a local slot.
+
+The pairs are fused here, rather than in ByteCodeGen, so that the stack
+usage calculation (bciStackUse) and the debugger only ever see the
+ordinary instructions.  A pair is fused only when the two instructions
+are adjacent in the instruction list, so a jump can never land in the
+middle of a superinstruction: jumps go to LABELs, and a LABEL between
+the two prevents the fusion.
+-}
+
+assembleInstrs :: DynFlags -> [BCInstr] -> Assembler ()
+assembleInstrs dflags = go
+  where
+    go (PUSH_L o1 : ENTER : is)
+      = do emit bci_PUSH_L_ENTER [SmallOp o1]
+           go is
+    go (PUSH_G nm : ENTER : is)
+      = do p <- ptr (BCOPtrName nm)
+           emit bci_PUSH_G_ENTER [Op p]
+           go is
+    go (SLIDE n by : ENTER : is)
+      = do emit bci_SLIDE_ENTER [SmallOp n, SmallOp by]
+           go is
+    go (i : PUSH_L o1 : is)
+      | Just n <- applyPtrs i
+      = do emit bci_PUSH_APPLY_PTRS_L [SmallOp n, SmallOp o1]
+           go is
+    go (i : is)
+      = do assembleI dflags i
+           go is
+    go []
+      = return ()
+
+    applyPtrs PUSH_APPLY_P      = Just 1
+    applyPtrs PUSH_APPLY_PP     = Just 2
+    applyPtrs PUSH_APPLY_PPP    = Just 3
+    applyPtrs PUSH_APPLY_PPPP   = Just 4
+    applyPtrs PUSH_APPLY_PPPPP  = Just 5
+    applyPtrs PUSH_APPLY_PPPPPP = Just 6
+    applyPtrs _                 = Nothing
+
 assembleI :: DynFlags
           -> BCInstr
           -> Assembler ()
@@ -456,6 +456,7 @@ data GeneralFlag
    | Opt_ForceRecomp
    | Opt_ExcessPrecision
    | Opt_EagerBlackHoling
+   | Opt_AdaptiveBlackHoling
    | Opt_NoHsMain
    | Opt_SplitObjs
    | Opt_SplitSections
@@ -3356,6 +3357,7 @@ fFlagsDeps = [
 -- See Note [Updating flag description in the User's Guide]
 -- See Note [Supporting CLI completion]
 -- Please keep the list of flags below sorted alphabetically
+  flagSpec "adaptive-blackholing"             Opt_AdaptiveBlackHoling,
   flagGhciSpec "break-on-error"               Opt_BreakOnError,
   flagGhciSpec "break-on-exception"           Opt_BreakOnException,
   flagSpec "building-cabal-package"           Opt_BuildingCabalPackage,
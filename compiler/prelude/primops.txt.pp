@@ -2334,6 +2334,21 @@ primop  ThreadStatusOp "threadStatus#" GenPrimOp
    out_of_line = True
    has_side_effects = True
 
+primop  SetThreadPriorityOp "setThreadPriority#" GenPrimOp
+   ThreadId# -> Int# -> State# RealWorld -> State# RealWorld
+   {Set the scheduling priority of a thread: 0 is high, 1 is normal and
+    2 is low.}
+   with
+   out_of_line = True
+   has_side_effects = True
+
+primop  ThreadPriorityOp "threadPriority#" GenPrimOp
+   ThreadId# -> State# RealWorld -> (# State# RealWorld, Int# #)
+   {Get the scheduling priority of a thread, as for {\tt setThreadPriority\#}.}
+   with
+   out_of_line = True
+   has_side_effects = True
+
 ------------------------------------------------------------------------
 section "Weak pointers"
 ------------------------------------------------------------------------
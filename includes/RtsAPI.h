@@ -185,6 +185,20 @@ Capability *rts_unsafeGetMyCapability (void);
 // specified capability, set by either +RTS -qa or +RTS --numa.
 void rts_setInCallCapability (int preferred_capability, int affinity);
 
+// Set the length of the time slice, in microseconds, for threads
+// running on the given capability.  The default is set by +RTS -C;
+// a value <= 0 restores it.  Slices are measured at the resolution of
+// the RTS timer (+RTS -V).
+void rts_setCapabilityTimeSlice (uint32_t cap, HsInt usecs);
+
+// Set or get the scheduling priority of a Haskell thread, like
+// GHC.Conc.setThreadPriority and getThreadPriority.  tid is a ThreadId,
+// e.g. from deRefStablePtr() on a StablePtr ThreadId, and priority is
+// one of ThreadPriorityHigh, ThreadPriorityNormal or ThreadPriorityLow.
+// cap is the token from rts_lock().
+void  rts_setThreadPriority (Capability *cap, HaskellObj tid, HsInt priority);
+HsInt rts_getThreadPriority (HaskellObj tid);
+
 /* ----------------------------------------------------------------------------
    Building Haskell objects from C datatypes.
    ------------------------------------------------------------------------- */
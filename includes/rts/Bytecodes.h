@@ -79,6 +79,14 @@
 #define bci_BRK_FUN			54
 #define bci_TESTLT_W   			55
 #define bci_TESTEQ_W  			56
+
+/* Superinstructions, which do the work of a pair of the above.  The
+   bytecode assembler fuses them; see Note [Superinstructions] in
+   ghc/compiler/ghci/ByteCodeAsm.hs. */
+#define bci_PUSH_L_ENTER		57
+#define bci_PUSH_G_ENTER		58
+#define bci_SLIDE_ENTER			59
+#define bci_PUSH_APPLY_PTRS_L		60
 /* If you need to go past 255 then you will run into the flags */
 
 /* If you need to go below 0x0100 then you will run into the instructions */
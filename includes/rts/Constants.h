@@ -73,6 +73,15 @@
  */
 #define MUT_ARR_PTRS_CARD_BITS 7
 
+/* The eager blackholing table has (1<<EAGER_BH_TABLE_BITS) one-byte
+ * entries, indexed by bits of a thunk's info pointer starting at bit
+ * EAGER_BH_SHIFT.  Code compiled with -fadaptive-blackholing consults
+ * it on thunk entry; see Note [Adaptive eager blackholing] in
+ * rts/BlackHoles.c.
+ */
+#define EAGER_BH_TABLE_BITS 14
+#define EAGER_BH_SHIFT      3
+
 /* -----------------------------------------------------------------------------
    STG Registers.
 
@@ -224,7 +233,12 @@
    by tryWakeupThread() */
 #define ThreadMigrating     13
 
-/* WARNING WARNING top number is BlockedOnMVarRead 14, not 13!! */
+/* The thread is runnable, but has been offered to other capabilities
+   on tso->cap->steal_queue (+RTS -qt) rather than being on the run
+   queue.  See Note [Thread stealing] in rts/Schedule.c */
+#define ThreadStealable     15
+
+/* WARNING WARNING top number is ThreadStealable 15, not 13!! */
 
 /*
  * These constants are returned to the scheduler by a thread that has
@@ -237,6 +251,17 @@
 #define ThreadBlocked  4
 #define ThreadFinished 5
 
+/*
+ * Thread priorities: each Capability has a run queue for each
+ * priority, and 0 is run first.  See Note [Thread priorities] in
+ * rts/Schedule.c.
+ * NB. keep these in sync with GHC.Conc.Sync: ThreadPriority
+ */
+#define ThreadPriorityHigh   0
+#define ThreadPriorityNormal 1
+#define ThreadPriorityLow    2
+#define N_THREAD_PRIORITIES  3
+
 /*
  * Flags for the tso->flags field.
  */
@@ -277,6 +302,13 @@
  */
 #define TSO_ALLOC_LIMIT 256
 
+/*
+ * Set the first time the scheduler runs a thread.  Threads that have
+ * never run haven't built up a working set in any CPU's cache, so
+ * they are the cheapest ones to migrate (see schedulePushWork()).
+ */
+#define TSO_HAS_RUN 512
+
 /*
  * The number of times we spin in a spin lock before yielding (see
  * #3758).  To tune this value, use the benchmark in #3758: run the
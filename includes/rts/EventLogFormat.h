@@ -178,12 +178,17 @@
 #define EVENT_HEAP_PROF_SAMPLE_BEGIN       162
 #define EVENT_HEAP_PROF_SAMPLE_COST_CENTRE 163
 #define EVENT_HEAP_PROF_SAMPLE_STRING      164
+
+#define EVENT_THREAD_MIGRATION_COUNTERS    181 /* (from_node, to_node, count) */
+#define EVENT_TASK_RETURN_WAIT             182 /* (taskID, wait, parked) */
+#define EVENT_BLACKHOLE_CONTENTION         183 /* (info, blocked, duplicated) */
+
 /*
  * The highest event code +1 that ghc itself emits. Note that some event
  * ranges higher than this are reserved but not currently emitted by ghc.
  * This must match the size of the EventDesc[] array in EventLog.c
  */
-#define NUM_GHC_EVENT_TAGS        165
+#define NUM_GHC_EVENT_TAGS        184
 
 #if 0  /* DEPRECATED EVENTS: */
 /* we don't actually need to record the thread, it's implicit */
@@ -243,6 +248,7 @@ typedef StgWord32 EventCapsetID;
 typedef StgWord16 EventCapsetType;   /* types for EVENT_CAPSET_CREATE */
 typedef StgWord64 EventTaskId;         /* for EVENT_TASK_* */
 typedef StgWord64 EventKernelThreadId; /* for EVENT_TASK_CREATE */
+typedef StgWord16 EventNumaNode;       /* for EVENT_THREAD_MIGRATION_COUNTERS */
 
 #endif
 
@@ -158,6 +158,7 @@ typedef struct _TRACE_FLAGS {
     rtsBool sparks_full;    /* trace spark events 100% accurately */
     rtsBool user;           /* trace user events (emitted from Haskell code) */
     rtsBool in_memory;      /* store all events in memory */
+    rtsBool blackholes;     /* trace blackhole contention statistics */
 } TRACE_FLAGS;
 
 /* See Note [Synchronization of flags and base APIs] */
@@ -182,12 +183,16 @@ typedef struct _MISC_FLAGS {
     rtsBool machineReadable;
     StgWord linkerMemBase;       /* address to ask the OS for memory
                                   * for the linker, NULL ==> off */
+    uint32_t linkerThreads;      /* threads used to relocate objects */
+    const char *linkerCacheDir;  /* where the linker caches relocated
+                                  * objects, NULL ==> off */
 } MISC_FLAGS;
 
 /* See Note [Synchronization of flags and base APIs] */
 typedef struct _PAR_FLAGS {
   uint32_t       nCapabilities;  /* number of threads to run simultaneously */
   rtsBool        migrate;        /* migrate threads between capabilities */
+  rtsBool        stealThreads;   /* let idle capabilities steal threads */
   uint32_t       maxLocalSparks;
   rtsBool        parGcEnabled;   /* enable parallel GC */
   uint32_t       parGcGen;       /* do parallel GC in this generation
@@ -211,6 +216,16 @@ typedef struct _PAR_FLAGS {
                                   * GC (default: use all nNodes). */
 
   rtsBool        setAffinity;    /* force thread affinity with CPUs */
+
+  uint32_t       spareWorkers;   /* spare worker Tasks to start for
+                                  * each Capability */
+  uint32_t       maxSpins;       /* spin at most this many times before
+                                  * sleeping when waiting for a
+                                  * Capability (zero disables) */
+  uint32_t       eagerBlackholeThreshold;
+                                 /* eagerly blackhole thunks whose info
+                                  * table has been contended this many
+                                  * times (zero disables) */
 } PAR_FLAGS;
 
 /* See Note [Synchronization of flags and base APIs] */
@@ -84,6 +84,19 @@ void warnMissingKBLibraryPaths( void );
 */
 pathchar* findSystemLibrary(pathchar* dll_name);
 
+/* Memory the linker has mapped for the sections and symbol extras of
+   loaded objects.  Large sections that are mapped straight from an
+   object file are not included. */
+typedef struct _LinkerMemStats {
+    StgWord64 code_bytes;        /* mapped for code */
+    StgWord64 rodata_bytes;      /* mapped for read-only data */
+    StgWord64 rwdata_bytes;      /* mapped for writable data */
+    StgWord64 allocated_bytes;   /* of the above, in use by loaded objects */
+} LinkerMemStats;
+
+/* get the linker's memory statistics */
+void getLinkerMemStats( LinkerMemStats *stats );
+
 /* called by the initialization code for a module, not a user API */
 StgStablePtr foreignExportStablePtr (StgPtr p);
 
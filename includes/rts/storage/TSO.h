@@ -55,11 +55,10 @@ typedef union {
   StgAsyncIOResult *async_result;
 #endif
 #if !defined(THREADED_RTS)
-  StgWord target;
-    // Only for the non-threaded RTS: the target time for a thread
-    // blocked in threadDelay, in units of 1ms.  This is a
-    // compromise: we don't want to take up much space in the TSO.  If
-    // you want better resolution for threadDelay, use -threaded.
+  StgWord sleep_index;
+    // Only for the non-threaded RTS: the position of a thread blocked
+    // in threadDelay in the heap of sleeping threads (see Note
+    // [Sleeping threads] in rts/posix/Select.c).
 #endif
 } StgTSOBlockInfo;
 
@@ -174,6 +173,16 @@ typedef struct StgTSO_ {
      */
     StgWord32  tot_stack_size;
 
+    /*
+     * The scheduling priority of the thread (ThreadPriorityHigh etc.),
+     * and the priority of the run queue that the thread is on, if it is
+     * on one: the priority may be changed by another Capability while
+     * the thread is queued.  See Note [Thread priorities] in
+     * rts/Schedule.c.
+     */
+    StgWord16  priority;
+    StgWord16  run_queue_priority;
+
 #ifdef TICKY_TICKY
     /* TICKY-specific stuff would go here. */
 #endif
@@ -241,7 +250,7 @@ void dirty_STACK (Capability *cap, StgStack *stack);
 
         BlockedOnRead          NULL                 blocked_queue
         BlockedOnWrite         NULL                 blocked_queue
-        BlockedOnDelay         NULL                 blocked_queue
+        BlockedOnDelay         heap index           sleeping threads
 
       tso->link == END_TSO_QUEUE, if the thread is currently running.
 
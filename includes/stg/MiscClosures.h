@@ -435,6 +435,8 @@ RTS_FUN_DECL(stg_myThreadIdzh);
 RTS_FUN_DECL(stg_labelThreadzh);
 RTS_FUN_DECL(stg_isCurrentThreadBoundzh);
 RTS_FUN_DECL(stg_threadStatuszh);
+RTS_FUN_DECL(stg_setThreadPriorityzh);
+RTS_FUN_DECL(stg_threadPriorityzh);
 
 RTS_FUN_DECL(stg_mkWeakzh);
 RTS_FUN_DECL(stg_mkWeakNoFinalizzerzh);
@@ -480,9 +482,11 @@ extern StgWord rts_stop_next_breakpoint[];
 extern StgWord rts_stop_on_exception[];
 extern StgWord rts_breakpoint_io_action[];
 
+// BlackHoles.c
+extern StgWord eager_blackhole_table[];
+
 // Schedule.c
 extern StgWord RTS_VAR(blocked_queue_hd), RTS_VAR(blocked_queue_tl);
-extern StgWord RTS_VAR(sleeping_queue);
 extern StgWord RTS_VAR(sched_mutex);
 
 // Apply.cmm
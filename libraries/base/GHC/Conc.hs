@@ -50,6 +50,10 @@ module GHC.Conc
         , threadStatus
         , threadCapability
 
+        , ThreadPriority(..)
+        , setThreadPriority
+        , getThreadPriority
+
         -- * Waiting
         , threadDelay
         , registerDelay
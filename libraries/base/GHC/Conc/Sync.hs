@@ -59,6 +59,10 @@ module GHC.Conc.Sync
         , threadStatus
         , threadCapability
 
+        , ThreadPriority(..)
+        , setThreadPriority
+        , getThreadPriority
+
         -- * Allocation counter and quota
         , setAllocationCounter
         , getAllocationCounter
@@ -577,6 +581,7 @@ threadStatus (ThreadId t) = IO $ \s ->
      mk_stat 11 = ThreadBlocked BlockedOnForeignCall
      mk_stat 12 = ThreadBlocked BlockedOnException
      mk_stat 14 = ThreadBlocked BlockedOnMVar -- possibly: BlockedOnMVarRead
+     mk_stat 15 = ThreadRunning -- waiting to be stolen by another capability
      -- NB. these are hardcoded in rts/PrimOps.cmm
      mk_stat 16 = ThreadFinished
      mk_stat 17 = ThreadDied
@@ -593,6 +598,47 @@ threadCapability (ThreadId t) = IO $ \s ->
    case threadStatus# t s of
      (# s', _, cap#, locked# #) -> (# s', (I# cap#, isTrue# (locked# /=# 0#)) #)
 
+-- | The scheduling priority of a thread.  When there are more runnable
+-- threads than capabilities, a capability runs its 'HighPriority'
+-- threads before its 'NormalPriority' threads, and those before its
+-- 'LowPriority' threads.  Lower priority threads are not starved: the
+-- scheduler gives them a time slice every so often while higher
+-- priority threads are waiting.  New threads start at 'NormalPriority'.
+--
+-- @since 4.10.0.0
+data ThreadPriority
+  = LowPriority
+  | NormalPriority
+  | HighPriority
+  deriving (Eq,Ord,Show)
+
+-- | Set the scheduling priority of a thread.  If the thread is
+-- currently waiting to run on another capability, the new priority
+-- takes effect the next time it is scheduled.
+--
+-- @since 4.10.0.0
+setThreadPriority :: ThreadId -> ThreadPriority -> IO ()
+setThreadPriority (ThreadId t) prio = IO $ \s ->
+   case setThreadPriority# t (prio_num prio) s of
+     s' -> (# s', () #)
+   where
+        -- NB. keep these in sync with includes/rts/Constants.h
+     prio_num HighPriority   = 0#
+     prio_num NormalPriority = 1#
+     prio_num LowPriority    = 2#
+
+-- | Get the scheduling priority of a thread.
+--
+-- @since 4.10.0.0
+getThreadPriority :: ThreadId -> IO ThreadPriority
+getThreadPriority (ThreadId t) = IO $ \s ->
+   case threadPriority# t s of
+     (# s', prio #) -> (# s', mk_prio (I# prio) #)
+   where
+     mk_prio 0 = HighPriority
+     mk_prio 2 = LowPriority
+     mk_prio _ = NormalPriority
+
 -- | make a weak pointer to a 'ThreadId'.  It can be important to do
 -- this if you want to hold a reference to a 'ThreadId' while still
 -- allowing the thread to receive the @BlockedIndefinitely@ family of
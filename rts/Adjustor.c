@@ -41,6 +41,7 @@ Haskell side.
 
 #include "RtsUtils.h"
 #include "Stable.h"
+#include "AdjustorPool.h"
 
 #if defined(USE_LIBFFI_FOR_ADJUSTORS)
 #include "ffi.h"
@@ -107,7 +108,7 @@ freeHaskellFunctionPtr(void* ptr)
     freeStablePtr(cl->user_data);
     stgFree(cl->cif->arg_types);
     stgFree(cl->cif);
-    freeExec(ptr);
+    freeAdjustor(ptr);
 }
 
 static ffi_type * char_to_ffi_type(char c)
@@ -167,7 +168,7 @@ createAdjustor (int cconv,
     r = ffi_prep_cif(cif, abi, n_args, result_type, arg_types);
     if (r != FFI_OK) barf("ffi_prep_cif failed: %d", r);
     
-    cl = allocateExec(sizeof(ffi_closure), &code);
+    cl = allocateAdjustor(sizeof(ffi_closure), &code);
     if (cl == NULL) {
         barf("createAdjustor: failed to allocate memory");
     }
@@ -394,7 +395,7 @@ createAdjustor(int cconv, StgStablePtr hptr,
      <c>:       ff e0             jmp    %eax              # and jump to it.
                 # the callee cleans up the stack
     */
-    adjustor = allocateExec(14,&code);
+    adjustor = allocateAdjustor(14,&code);
     {
         unsigned char *const adj_code = (unsigned char *)adjustor;
         adj_code[0x00] = (unsigned char)0x58;  /* popl %eax  */
@@ -424,7 +425,7 @@ createAdjustor(int cconv, StgStablePtr hptr,
 
           We offload most of the work to AdjustorAsm.S.
         */
-        AdjustorStub *adjustorStub = allocateExec(sizeof(AdjustorStub),&code);
+        AdjustorStub *adjustorStub = allocateAdjustor(sizeof(AdjustorStub),&code);
         adjustor = adjustorStub;
 
         int sz = totalArgumentSize(typeString);
@@ -541,7 +542,7 @@ createAdjustor(int cconv, StgStablePtr hptr,
             (typeString[2] == '\0') ||
             (typeString[3] == '\0')) {
 
-            adjustor = allocateExec(0x38,&code);
+            adjustor = allocateAdjustor(0x38,&code);
             adj_code = (StgWord8*)adjustor;
 
             *(StgInt32 *)adj_code        = 0x49c1894d;
@@ -562,7 +563,7 @@ createAdjustor(int cconv, StgStablePtr hptr,
             int fourthFloating;
 
             fourthFloating = (typeString[3] == 'f' || typeString[3] == 'd');
-            adjustor = allocateExec(0x58,&code);
+            adjustor = allocateAdjustor(0x58,&code);
             adj_code = (StgWord8*)adjustor;
             *(StgInt32 *)adj_code        = 0x08ec8348;
             *(StgInt32 *)(adj_code+0x4)  = fourthFloating ? 0x5c110ff2
@@ -658,7 +659,7 @@ createAdjustor(int cconv, StgStablePtr hptr,
         }
 
         if (i < 6) {
-            adjustor = allocateExec(0x30,&code);
+            adjustor = allocateAdjustor(0x30,&code);
             adj_code = (StgWord8*)adjustor;
 
             *(StgInt32 *)adj_code        = 0x49c1894d;
@@ -673,7 +674,7 @@ createAdjustor(int cconv, StgStablePtr hptr,
         }
         else
         {
-            adjustor = allocateExec(0x40,&code);
+            adjustor = allocateAdjustor(0x40,&code);
             adj_code = (StgWord8*)adjustor;
 
             *(StgInt32 *)adj_code        = 0x35ff5141;
@@ -724,7 +725,7 @@ createAdjustor(int cconv, StgStablePtr hptr,
      similarly, and local variables should be accessed via %fp, not %sp. In a
      nutshell: This should work! (Famous last words! :-)
   */
-    adjustor = allocateExec(4*(11+1),&code);
+    adjustor = allocateAdjustor(4*(11+1),&code);
     {
         unsigned long *const adj_code = (unsigned long *)adjustor;
 
@@ -801,7 +802,7 @@ TODO: Depending on how much allocation overhead stgMallocBytes uses for
       4 bytes (getting rid of the nop), hence saving memory. [ccshan]
   */
     ASSERT(((StgWord64)wptr & 3) == 0);
-    adjustor = allocateExec(48,&code);
+    adjustor = allocateAdjustor(48,&code);
     {
         StgWord64 *const code = (StgWord64 *)adjustor;
 
@@ -906,7 +907,7 @@ TODO: Depending on how much allocation overhead stgMallocBytes uses for
             */
                     // allocate space for at most 4 insns per parameter
                     // plus 14 more instructions.
-        adjustor = allocateExec(4 * (4*n + 14),&code);
+        adjustor = allocateAdjustor(4 * (4*n + 14),&code);
         code = (unsigned*)adjustor;
         
         *code++ = 0x48000008; // b *+8
@@ -1060,7 +1061,7 @@ TODO: Depending on how much allocation overhead stgMallocBytes uses for
 #ifdef FUNDESCS
         adjustorStub = stgMallocBytes(sizeof(AdjustorStub), "createAdjustor");
 #else
-        adjustorStub = allocateExec(sizeof(AdjustorStub),&code);
+        adjustorStub = allocateAdjustor(sizeof(AdjustorStub),&code);
 #endif
         adjustor = adjustorStub;
             
@@ -1317,7 +1318,7 @@ freeHaskellFunctionPtr(void* ptr)
  // Can't write to this memory, it is only executable:
  // *((unsigned char*)ptr) = '\0';
 
- freeExec(ptr);
+ freeAdjustor(ptr);
 }
 
 #endif // !USE_LIBFFI_FOR_ADJUSTORS
@@ -0,0 +1,315 @@
+/* ---------------------------------------------------------------------------
+ *
+ * (c) The GHC Team, 2016
+ *
+ * Executable memory for adjustor thunks
+ *
+ * -------------------------------------------------------------------------*/
+
+#include "PosixSource.h"
+#include "Rts.h"
+
+#include "AdjustorPool.h"
+#include "Capability.h"
+#include "RtsUtils.h"
+#include "Task.h"
+
+/* Note [Adjustor pool]
+   ~~~~~~~~~~~~~~~~~~~~
+
+   Every foreign import "wrapper" call creates an adjustor thunk
+   (Adjustor.c), and every freeHaskellFunPtr frees one.  Getting the
+   executable memory for them straight from allocateExec() and
+   freeExec() means taking sm_mutex twice per adjustor.  On Linux it
+   also means a trip through libffi's closure allocator.  That hurts
+   bindings that create and free a callback per event or per query.
+
+   So adjustors are allocated from pools instead.  An adjustor stub is
+   an AdjustorHeader followed by the code, rounded up to a multiple of
+   ADJUSTOR_ALIGN bytes, which gives its size class.  Each Capability
+   has a pool with a free list of stubs for each size class, and freed
+   stubs go back on it instead of to freeExec().  Only the Task running
+   on a Capability touches its pool, so the common case of creating and
+   freeing adjustors from Haskell takes no lock at all.
+
+   Where allocateExec() is our own allocator, a pool also has a slab of
+   executable memory that new stubs are carved from.  A slab is a
+   single allocateExec() call of ADJUSTOR_SLAB_BYTES, so the cost of
+   allocateExec() (and of the mapping and mprotect() calls behind it) is
+   paid once for a slab full of adjustors.  On Linux, allocateExec() is
+   libffi's ffi_closure_alloc(), which only promises that the writable
+   and executable addresses it returns refer to the same closure: with
+   static trampolines they are not even part of the same mapping.  So
+   there we allocate each new stub with its own allocateExec() call,
+   and only reuse the stubs once they have been freed.
+
+   Threads that don't own a Capability can create and free adjustors
+   too: hs_free_fun_ptr() can be called from any C thread.  They use
+   global_pool, under global_pool_mutex.  A Capability whose own free
+   list for a size class is empty takes the whole of global_pool's free
+   list for that class, so stubs freed by foreign threads get reused.
+
+   Executable memory may be mapped twice, once writable and once
+   executable (libffi does this under SELinux), so a stub's header
+   records the writable address of the stub.  The free lists go through
+   the first word of each free stub's code.  They are read through the
+   executable mapping and written through the writable one.
+
+   Stubs bigger than ADJUSTOR_N_CLASSES size classes (there are none on
+   the common platforms) are allocated with allocateExec() as before,
+   and freed with freeExec().  Pooled stubs and slabs are never given
+   back, so the pools hold on to as much memory as the largest number
+   of adjustors that were ever alive at once.
+
+   On iOS, allocateExec() can only allocate ffi_closures, so there are
+   no pools and allocateAdjustor() is just allocateExec().
+*/
+
+#if !defined(ios_HOST_OS)
+
+// Can we carve stubs out of a bigger allocateExec() block?
+#if defined(linux_HOST_OS)
+#define ADJUSTOR_SLABS      0
+#else
+#define ADJUSTOR_SLABS      1
+#endif
+
+#define ADJUSTOR_ALIGN      16
+#define ADJUSTOR_N_CLASSES  16
+
+#if ADJUSTOR_SLABS
+// Small enough for the allocateExec() of every platform, which can't
+// allocate more than a block.
+#define ADJUSTOR_SLAB_BYTES (BLOCK_SIZE - 4 * sizeof(W_))
+#endif
+
+// Size classes in the header of stubs that are not in a pool, or are
+// on a free list
+#define ADJUSTOR_UNPOOLED   ((StgWord)-1)
+#define ADJUSTOR_FREE       ((StgWord)1 << (BITS_IN(StgWord) - 2))
+
+typedef struct {
+    AdjustorWritable writable;   // the writable address of this header
+    StgWord          size_class;
+} AdjustorHeader;
+
+struct AdjustorPool_ {
+    // free stubs of each size class, by the address of their code
+    AdjustorExecutable free[ADJUSTOR_N_CLASSES];
+
+#if ADJUSTOR_SLABS
+    // what is left of the current slab
+    StgWord8 *slab;
+    W_        slab_left;
+    StgWord   slab_offset;   // writable address - executable address
+#endif
+};
+
+// For Tasks that don't own a Capability
+static AdjustorPool global_pool;
+#if defined(THREADED_RTS)
+static Mutex global_pool_mutex;
+#endif
+
+void
+initAdjustorPool (void)
+{
+#if defined(THREADED_RTS)
+    initMutex(&global_pool_mutex);
+#endif
+}
+
+void
+exitAdjustorPool (void)
+{
+#if defined(THREADED_RTS)
+    closeMutex(&global_pool_mutex);
+#endif
+}
+
+void
+freeAdjustorPool (AdjustorPool *pool)
+{
+    stgFree(pool);
+}
+
+// The pool of the Capability we are running on, or NULL if we are not
+// running on one.
+static AdjustorPool *
+myAdjustorPool (void)
+{
+    Capability *cap;
+
+#if defined(THREADED_RTS)
+    Task *task = myTask();
+    if (task == NULL || task->cap == NULL || task->cap->running_task != task) {
+        return NULL;
+    }
+    cap = task->cap;
+#else
+    cap = &MainCapability;
+#endif
+
+    if (cap->adjustor_pool == NULL) {
+        cap->adjustor_pool = stgCallocBytes(1, sizeof(AdjustorPool),
+                                            "myAdjustorPool");
+    }
+    return cap->adjustor_pool;
+}
+
+STATIC_INLINE AdjustorHeader *
+writableHeader (AdjustorExecutable code)
+{
+    return (AdjustorHeader *)((AdjustorHeader *)code - 1)->writable;
+}
+
+// Allocate a stub of size class c from the free list or the slab of
+// pool.  Returns the address of its code, or NULL if we are out of
+// memory.
+static AdjustorExecutable
+allocFromPool (AdjustorPool *pool, uint32_t c)
+{
+    AdjustorExecutable code;
+    AdjustorHeader *hdr;
+    W_ stub_bytes;
+#if ADJUSTOR_SLABS
+    AdjustorWritable writ;
+    W_ pad;
+#endif
+
+    code = pool->free[c];
+    if (code != NULL) {
+        pool->free[c] = *(AdjustorExecutable *)code;
+        writableHeader(code)->size_class = c;
+        return code;
+    }
+
+    stub_bytes = (c + 1) * ADJUSTOR_ALIGN;
+
+#if ADJUSTOR_SLABS
+    if (pool->slab_left < stub_bytes) {
+        // The rest of the old slab, less than one stub, is wasted.
+        writ = allocateExec(ADJUSTOR_SLAB_BYTES, &code);
+        if (writ == NULL) return NULL;
+        pad = (ADJUSTOR_ALIGN - ((W_)code & (ADJUSTOR_ALIGN - 1)))
+              & (ADJUSTOR_ALIGN - 1);
+        pool->slab        = (StgWord8 *)code + pad;
+        pool->slab_left   = ADJUSTOR_SLAB_BYTES - pad;
+        pool->slab_offset = (StgWord)writ - (StgWord)code;
+    }
+
+    hdr = (AdjustorHeader *)((StgWord)pool->slab + pool->slab_offset);
+    hdr->writable   = hdr;
+    hdr->size_class = c;
+    code = (AdjustorHeader *)pool->slab + 1;
+    pool->slab      += stub_bytes;
+    pool->slab_left -= stub_bytes;
+#else
+    hdr = allocateExec(stub_bytes, &code);
+    if (hdr == NULL) return NULL;
+    hdr->writable   = hdr;
+    hdr->size_class = c;
+    code = (AdjustorHeader *)code + 1;
+#endif
+    return code;
+}
+
+static void
+freeToPool (AdjustorPool *pool, AdjustorExecutable code, uint32_t c)
+{
+    AdjustorHeader *hdr = writableHeader(code);
+
+    hdr->size_class = c | ADJUSTOR_FREE;
+    *(AdjustorExecutable *)(hdr + 1) = pool->free[c];
+    pool->free[c] = code;
+}
+
+AdjustorWritable
+allocateAdjustor (W_ bytes, AdjustorExecutable *exec_ret)
+{
+    AdjustorPool *pool;
+    AdjustorExecutable code;
+    AdjustorHeader *hdr;
+    W_ stub_bytes;
+    uint32_t c;
+
+    stub_bytes = (sizeof(AdjustorHeader) + bytes + ADJUSTOR_ALIGN - 1)
+                 & ~(W_)(ADJUSTOR_ALIGN - 1);
+    c = stub_bytes / ADJUSTOR_ALIGN - 1;
+
+    if (c >= ADJUSTOR_N_CLASSES) {
+        hdr = allocateExec(sizeof(AdjustorHeader) + bytes, &code);
+        if (hdr == NULL) return NULL;
+        hdr->writable   = hdr;
+        hdr->size_class = ADJUSTOR_UNPOOLED;
+        *exec_ret = (AdjustorHeader *)code + 1;
+        return hdr + 1;
+    }
+
+    pool = myAdjustorPool();
+    if (pool != NULL) {
+        // Take the stubs freed by foreign threads, if we have run out.
+        if (pool->free[c] == NULL &&
+            VOLATILE_LOAD(&global_pool.free[c]) != 0) {
+            ACQUIRE_LOCK(&global_pool_mutex);
+            pool->free[c] = global_pool.free[c];
+            global_pool.free[c] = NULL;
+            RELEASE_LOCK(&global_pool_mutex);
+        }
+        code = allocFromPool(pool, c);
+    } else {
+        ACQUIRE_LOCK(&global_pool_mutex);
+        code = allocFromPool(&global_pool, c);
+        RELEASE_LOCK(&global_pool_mutex);
+    }
+
+    if (code == NULL) return NULL;
+    *exec_ret = code;
+    return writableHeader(code) + 1;
+}
+
+void
+freeAdjustor (AdjustorExecutable code)
+{
+    AdjustorHeader *hdr = (AdjustorHeader *)code - 1;
+    AdjustorPool *pool;
+    StgWord c;
+
+    c = hdr->size_class;
+    if (c == ADJUSTOR_UNPOOLED) {
+        freeExec(hdr);
+        return;
+    }
+    if (c & ADJUSTOR_FREE) {
+        barf("freeAdjustor: already free?");
+    }
+
+    pool = myAdjustorPool();
+    if (pool != NULL) {
+        freeToPool(pool, code, c);
+    } else {
+        ACQUIRE_LOCK(&global_pool_mutex);
+        freeToPool(&global_pool, code, c);
+        RELEASE_LOCK(&global_pool_mutex);
+    }
+}
+
+#else /* ios_HOST_OS */
+
+void initAdjustorPool (void) {}
+void exitAdjustorPool (void) {}
+void freeAdjustorPool (AdjustorPool *pool STG_UNUSED) {}
+
+AdjustorWritable
+allocateAdjustor (W_ bytes, AdjustorExecutable *exec_ret)
+{
+    return allocateExec(bytes, exec_ret);
+}
+
+void
+freeAdjustor (AdjustorExecutable code)
+{
+    freeExec(code);
+}
+
+#endif /* ios_HOST_OS */
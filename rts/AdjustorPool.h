@@ -0,0 +1,29 @@
+/* ---------------------------------------------------------------------------
+ *
+ * (c) The GHC Team, 2016
+ *
+ * Executable memory for adjustor thunks
+ *
+ * -------------------------------------------------------------------------*/
+
+#ifndef ADJUSTORPOOL_H
+#define ADJUSTORPOOL_H
+
+#include "BeginPrivate.h"
+
+typedef struct AdjustorPool_ AdjustorPool;
+
+void initAdjustorPool (void);
+void exitAdjustorPool (void);
+
+// Like allocateExec() and freeExec(), but the memory is kept and
+// reused; see Note [Adjustor pool] in AdjustorPool.c.
+AdjustorWritable allocateAdjustor (W_ bytes, AdjustorExecutable *exec_ret);
+void             freeAdjustor     (AdjustorExecutable exec);
+
+// Free a Capability's pool (see freeCapability()).
+void freeAdjustorPool (AdjustorPool *pool);
+
+#include "EndPrivate.h"
+
+#endif /* ADJUSTORPOOL_H */
@@ -0,0 +1,207 @@
+/* ---------------------------------------------------------------------------
+ *
+ * (c) The GHC Team, 2016
+ *
+ * Blackhole contention statistics and adaptive eager blackholing
+ *
+ * -------------------------------------------------------------------------*/
+
+#include "PosixSource.h"
+#include "Rts.h"
+
+#include "BlackHoles.h"
+#include "Hash.h"
+#include "RtsUtils.h"
+#include "Trace.h"
+
+/* Note [Blackhole contention]
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+   With lazy blackholing (the default), a thunk is only turned into a
+   BLACKHOLE when the thread evaluating it stops (threadPaused()).  Two
+   threads can therefore start evaluating the same thunk, and we only
+   find out when one of them stops: it either blocks on the BLACKHOLE
+   (messageBlackHole()) or, in threadPaused(), discovers that another
+   thread has claimed a thunk it is evaluating and suspends its
+   duplicate work.  Either way some parallelism has been lost, and it is
+   useful to know which thunks are responsible.
+
+   By the time we notice the contention, the thunk's info pointer has
+   been overwritten with a BLACKHOLE.  So when blackhole tracking is on,
+   threadPaused() records the original info pointer of every thunk it
+   blackholes in bh_owners, keyed by the address of the BLACKHOLE.  The
+   GC moves BLACKHOLEs, so bh_owners is emptied at every GC; until then
+   the address of a BLACKHOLE can't be reused, even after it has been
+   updated.  When a thread blocks or suspends duplicate work, we look
+   the BLACKHOLE up in bh_owners and bump the counters for its thunk's
+   info table in bh_stats.  Contention on a BLACKHOLE that we have no
+   record of (it was blackholed eagerly, or before the last GC) is
+   counted against a NULL info pointer.
+
+   At exit the counters are emitted with +RTS -lb as one
+   EVENT_BLACKHOLE_CONTENTION per info table.
+
+   Tracking takes a global lock for every thunk blackholed by
+   threadPaused(), so it is only on when -lb or -qe is given.
+*/
+
+/* Note [Adaptive eager blackholing]
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+   Eager blackholing (-feager-blackholing) avoids most duplicate work,
+   but costs a couple of stores on every thunk entry, which is a waste
+   for the vast majority of thunks that are never shared between
+   threads.  With -fadaptive-blackholing, the code generator instead
+   emits a test on thunk entry: the thunk is blackholed eagerly only if
+   the byte for its info pointer in eager_blackhole_table is non-zero.
+
+   The table is indexed by the bits of the info pointer from
+   EAGER_BH_SHIFT upwards (see includes/rts/Constants.h), so that the
+   test is a load, a shift, a mask and a byte load.  Several info tables
+   may share an entry; that only means that some uncontended thunks get
+   blackholed eagerly as well, which is safe.
+
+   An entry is set when the contention counters (Note [Blackhole
+   contention]) for an info table reach the +RTS -qe threshold, and is
+   never cleared.  Entries are written without synchronisation: a
+   thread that doesn't see the write yet just blackholes lazily.
+
+   The entry code reads the byte once, and uses it to pick the update
+   frame as well: stg_bh_upd_frame if it blackholed the thunk, and
+   stg_upd_frame if it didn't.  A plain stg_upd_frame would be wrong for
+   an eagerly blackholed thunk: another thread may block on it before
+   our thread ever gets to threadPaused(), and then messageBlackHole()
+   has made a BLOCKING_QUEUE the indirectee.  Only stg_bh_upd_frame
+   (via updateThunk()) wakes up the threads on that queue; stg_upd_frame
+   would just overwrite it.
+*/
+
+StgWord8 eager_blackhole_table[1 << EAGER_BH_TABLE_BITS];
+
+rtsBool blackhole_tracking = rtsFalse;
+
+typedef struct {
+    StgWord64 blocked;
+    StgWord64 duplicated;
+} BlackHoleStats;
+
+// BLACKHOLE address -> info pointer of the thunk it was made from
+static HashTable *bh_owners = NULL;
+
+// info pointer -> BlackHoleStats
+static HashTable *bh_stats = NULL;
+
+#ifdef THREADED_RTS
+static Mutex bh_mutex;
+#endif
+
+void initBlackHoles (void)
+{
+    blackhole_tracking = RtsFlags.ParFlags.eagerBlackholeThreshold > 0;
+#ifdef TRACING
+    blackhole_tracking = blackhole_tracking || TRACE_blackholes;
+#endif
+
+    if (!blackhole_tracking) return;
+
+#ifdef THREADED_RTS
+    initMutex(&bh_mutex);
+#endif
+    bh_owners = allocHashTable();
+    bh_stats  = allocHashTable();
+}
+
+void exitBlackHoles (void)
+{
+    StgWord *infos;
+    int i, n;
+    BlackHoleStats *stats;
+
+    if (!blackhole_tracking) return;
+
+    // all the Capabilities have been stopped, so we don't need the lock
+    n = keyCountHashTable(bh_stats);
+    infos = stgMallocBytes(sizeof(StgWord) * (n + 1), "exitBlackHoles");
+    n = keysHashTable(bh_stats, infos, n);
+
+    for (i = 0; i < n; i++) {
+        stats = lookupHashTable(bh_stats, infos[i]);
+#ifdef TRACING
+        if (TRACE_blackholes) {
+            traceBlackHoleContention((const StgInfoTable *)infos[i],
+                                     stats->blocked, stats->duplicated);
+        }
+#endif
+        stgFree(stats);
+    }
+
+    stgFree(infos);
+    freeHashTable(bh_stats, NULL);
+    freeHashTable(bh_owners, NULL);
+    bh_stats = NULL;
+    bh_owners = NULL;
+#ifdef THREADED_RTS
+    closeMutex(&bh_mutex);
+#endif
+    blackhole_tracking = rtsFalse;
+}
+
+void resetBlackHoleOwners (void)
+{
+    if (!blackhole_tracking) return;
+
+    if (keyCountHashTable(bh_owners) > 0) {
+        freeHashTable(bh_owners, NULL);
+        bh_owners = allocHashTable();
+    }
+}
+
+void recordLazyBlackHole_ (StgClosure *bh, const StgInfoTable *info)
+{
+    ACQUIRE_LOCK(&bh_mutex);
+    insertHashTable(bh_owners, (StgWord)bh, info);
+    RELEASE_LOCK(&bh_mutex);
+}
+
+// Must be called with bh_mutex held.
+static BlackHoleStats *
+lookupStats (StgClosure *bh)
+{
+    const StgInfoTable *info;
+    BlackHoleStats *stats;
+    uint32_t threshold;
+
+    info = lookupHashTable(bh_owners, (StgWord)bh);
+
+    stats = lookupHashTable(bh_stats, (StgWord)info);
+    if (stats == NULL) {
+        stats = stgMallocBytes(sizeof(BlackHoleStats), "lookupStats");
+        stats->blocked = 0;
+        stats->duplicated = 0;
+        insertHashTable(bh_stats, (StgWord)info, stats);
+    }
+
+    // The caller is about to bump one of the counters, hence the + 1.
+    threshold = RtsFlags.ParFlags.eagerBlackholeThreshold;
+    if (threshold > 0 && info != NULL &&
+        stats->blocked + stats->duplicated + 1 >= threshold) {
+        eager_blackhole_table[((StgWord)info >> EAGER_BH_SHIFT) &
+                              ((1 << EAGER_BH_TABLE_BITS) - 1)] = 1;
+    }
+
+    return stats;
+}
+
+void recordBlackHoleBlock_ (StgClosure *bh)
+{
+    ACQUIRE_LOCK(&bh_mutex);
+    lookupStats(bh)->blocked++;
+    RELEASE_LOCK(&bh_mutex);
+}
+
+void recordDuplicateWork_ (StgClosure *bh)
+{
+    ACQUIRE_LOCK(&bh_mutex);
+    lookupStats(bh)->duplicated++;
+    RELEASE_LOCK(&bh_mutex);
+}
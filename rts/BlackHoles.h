@@ -0,0 +1,60 @@
+/* ---------------------------------------------------------------------------
+ *
+ * (c) The GHC Team, 2016
+ *
+ * Blackhole contention statistics and adaptive eager blackholing
+ *
+ * -------------------------------------------------------------------------*/
+
+#ifndef BLACKHOLES_H
+#define BLACKHOLES_H
+
+// Consulted on thunk entry by code compiled with -fadaptive-blackholing,
+// so it must be visible outside the RTS.
+extern StgWord8 eager_blackhole_table[1 << EAGER_BH_TABLE_BITS];
+
+#include "BeginPrivate.h"
+
+void initBlackHoles (void);
+void exitBlackHoles (void);
+
+// Forget which thunks the current BLACKHOLEs were made from (called by
+// the GC, which moves the BLACKHOLEs).
+void resetBlackHoleOwners (void);
+
+void recordLazyBlackHole_  (StgClosure *bh, const StgInfoTable *info);
+void recordBlackHoleBlock_ (StgClosure *bh);
+void recordDuplicateWork_  (StgClosure *bh);
+
+extern rtsBool blackhole_tracking;
+
+// threadPaused() has turned the thunk bh, whose info pointer was info,
+// into a BLACKHOLE.
+INLINE_HEADER void recordLazyBlackHole (StgClosure *bh,
+                                        const StgInfoTable *info)
+{
+    if (RTS_UNLIKELY(blackhole_tracking)) {
+        recordLazyBlackHole_(bh, info);
+    }
+}
+
+// A thread has blocked on the BLACKHOLE bh.
+INLINE_HEADER void recordBlackHoleBlock (StgClosure *bh)
+{
+    if (RTS_UNLIKELY(blackhole_tracking)) {
+        recordBlackHoleBlock_(bh);
+    }
+}
+
+// A thread has found that the thunk it was evaluating has been claimed
+// by another thread, and suspended its duplicate work.
+INLINE_HEADER void recordDuplicateWork (StgClosure *bh)
+{
+    if (RTS_UNLIKELY(blackhole_tracking)) {
+        recordDuplicateWork_(bh);
+    }
+}
+
+#include "EndPrivate.h"
+
+#endif /* BLACKHOLES_H */
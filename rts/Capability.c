@@ -27,6 +27,7 @@
 #include "STM.h"
 #include "RtsUtils.h"
 #include "sm/OSMem.h"
+#include "GetTime.h"
 
 #if !defined(mingw32_HOST_OS)
 #include "rts/IOManager.h" // for setIOManagerControlFd()
@@ -54,6 +55,16 @@ Capability **capabilities = NULL;
 // locking, so we don't do that.
 static Capability *last_free_capability[MAX_NUMA_NODES];
 
+#if defined(THREADED_RTS)
+// Capacity of each Capability's steal_queue.  A Capability offers at
+// most this many threads at a time (see offerThreads() in Schedule.c).
+#define STEAL_QUEUE_SIZE 64
+
+// The most times to spin waiting for a Capability: RtsFlags.ParFlags.maxSpins,
+// or 0 if we have only one processor.  See Note [Spinning for a Capability].
+static uint32_t max_spins = 0;
+#endif
+
 /*
  * Indicates that the RTS wants to synchronise all the Capabilities
  * for some reason.  All Capabilities should yieldCapability().
@@ -96,8 +107,10 @@ findSpark (Capability *cap)
 {
   Capability *robbed;
   StgClosurePtr spark;
+  StgClosurePtr stolen[SPARK_STEAL_BATCH];
   rtsBool retry;
   uint32_t i = 0;
+  uint32_t j, n, room;
 
   if (!emptyRunQueue(cap) || cap->n_returning_tasks != 0) {
       // If there are other threads, don't try to run any new
@@ -149,12 +162,27 @@ findSpark (Capability *cap)
           if (emptySparkPoolCap(robbed)) // nothing to steal here
               continue;
 
-          spark = tryStealSpark(robbed->sparks);
-          while (spark != NULL && fizzledSpark(spark)) {
-              cap->spark_stats.fizzled++;
-              traceEventSparkFizzle(cap);
-              spark = tryStealSpark(robbed->sparks);
-          }
+          // Steal up to half of the sparks at once: we run the first
+          // one that hasn't fizzled and move the rest to our own pool,
+          // where other idle Capabilities can find them too.  So we
+          // don't take more than fits in our pool.
+          room = cap->sparks->size - sparkPoolSize(cap->sparks);
+          do {
+              spark = NULL;
+              n = tryStealSparks(robbed->sparks, stolen,
+                                 stg_min(room, SPARK_STEAL_BATCH));
+              for (j = 0; j < n; j++) {
+                  if (fizzledSpark(stolen[j])) {
+                      cap->spark_stats.fizzled++;
+                      traceEventSparkFizzle(cap);
+                  } else if (spark == NULL) {
+                      spark = stolen[j];
+                  } else {
+                      pushWSDeque(cap->sparks, stolen[j]);
+                  }
+              }
+          } while (spark == NULL && n > 0);
+
           if (spark == NULL && !emptySparkPoolCap(robbed)) {
               // we conflicted with another thread while trying to steal;
               // try again later.
@@ -243,7 +271,7 @@ popReturningTask (Capability *cap)
 static void
 initCapability (Capability *cap, uint32_t i)
 {
-    uint32_t g;
+    uint32_t g, p;
 
     cap->no = i;
     cap->node = capNoToNumaNode(i);
@@ -251,8 +279,11 @@ initCapability (Capability *cap, uint32_t i)
     cap->idle              = 0;
     cap->disabled          = rtsFalse;
 
-    cap->run_queue_hd      = END_TSO_QUEUE;
-    cap->run_queue_tl      = END_TSO_QUEUE;
+    for (p = 0; p < N_THREAD_PRIORITIES; p++) {
+        cap->run_queue_hd[p] = END_TSO_QUEUE;
+        cap->run_queue_tl[p] = END_TSO_QUEUE;
+        cap->run_queue_skipped[p] = 0;
+    }
     cap->n_run_queue       = 0;
 
 #if defined(THREADED_RTS)
@@ -265,14 +296,29 @@ initCapability (Capability *cap, uint32_t i)
     cap->returning_tasks_hd = NULL;
     cap->returning_tasks_tl = NULL;
     cap->n_returning_tasks  = 0;
+    cap->return_spins       = 0;
+    cap->worker_spins       = 0;
     cap->inbox              = (Message*)END_TSO_QUEUE;
     cap->sparks             = allocSparkPool();
+    cap->spark_gen_marks    = stgMallocBytes(sizeof(StgWord) *
+                                             RtsFlags.GcFlags.generations,
+                                             "initCapability");
+    for (g = 0; g < RtsFlags.GcFlags.generations; g++) {
+        cap->spark_gen_marks[g] = 0;
+    }
+    for (g = 0; g < SPARK_FILTER_SIZE; g++) {
+        cap->recent_sparks[g] = NULL;
+    }
+    cap->steal_queue        = newWSDeque(STEAL_QUEUE_SIZE);
     cap->spark_stats.created    = 0;
     cap->spark_stats.dud        = 0;
     cap->spark_stats.overflowed = 0;
     cap->spark_stats.converted  = 0;
     cap->spark_stats.gcd        = 0;
     cap->spark_stats.fizzled    = 0;
+    for (g = 0; g < MAX_NUMA_NODES; g++) {
+        cap->thread_migrations[g] = 0;
+    }
 #if !defined(mingw32_HOST_OS)
     cap->io_manager_control_wr_fd = -1;
 #endif
@@ -294,6 +340,12 @@ initCapability (Capability *cap, uint32_t i)
         cap->mut_lists[g] = NULL;
     }
 
+    cap->n_cached_stack_chunks = 0;
+    cap->stack_chunk_hits      = 0;
+    cap->stack_chunk_misses    = 0;
+    cap->free_tsos             = END_TSO_QUEUE;
+    cap->n_free_tsos           = 0;
+
     cap->weak_ptr_list_hd = NULL;
     cap->weak_ptr_list_tl = NULL;
     cap->free_tvar_watch_queues = END_STM_WATCH_QUEUE;
@@ -302,8 +354,12 @@ initCapability (Capability *cap, uint32_t i)
     cap->free_trec_headers = NO_TREC;
     cap->transaction_tokens = 0;
     cap->context_switch = 0;
+    cap->slice_thread = 0;
+    cap->slice_start = 0;
+    cap->time_slice = RtsFlags.ConcFlags.ctxtSwitchTime;
     cap->pinned_object_block = NULL;
     cap->pinned_object_blocks = NULL;
+    cap->adjustor_pool = NULL;
 
 #ifdef PROFILING
     cap->r.rCCCS = CCS_SYSTEM;
@@ -379,6 +435,11 @@ void initCapabilities (void)
     moreCapabilities(0, RtsFlags.ParFlags.nCapabilities);
     n_capabilities = RtsFlags.ParFlags.nCapabilities;
 
+    // See Note [Spinning for a Capability]
+    if (getNumberOfProcessors() > 1) {
+        max_spins = RtsFlags.ParFlags.maxSpins;
+    }
+
 #else /* !THREADED_RTS */
 
     n_capabilities = 1;
@@ -437,15 +498,35 @@ moreCapabilities (uint32_t from USED_IF_THREADS, uint32_t to USED_IF_THREADS)
 }
 
 /* ----------------------------------------------------------------------------
- * setContextSwitches: cause all capabilities to context switch as
- * soon as possible.
+ * preemptCapabilities: called on each timer tick, cause the
+ * capabilities whose thread has run for a whole time slice to context
+ * switch as soon as possible.  See Note [Time slices] in Schedule.c.
  * ------------------------------------------------------------------------- */
 
-void contextSwitchAllCapabilities(void)
+void preemptCapabilities(Time now)
 {
     uint32_t i;
+    Capability *cap;
+
     for (i=0; i < n_capabilities; i++) {
-        contextSwitchCapability(capabilities[i]);
+        cap = capabilities[i];
+        if (cap->r.rCurrentTSO != NULL &&
+            now - cap->slice_start >= cap->time_slice) {
+            contextSwitchCapability(cap);
+        }
+    }
+}
+
+void rts_setCapabilityTimeSlice (uint32_t cap_no, HsInt usecs)
+{
+    if (cap_no >= n_capabilities) {
+        errorBelch("rts_setCapabilityTimeSlice: no capability %d", cap_no);
+        return;
+    }
+    if (usecs <= 0) {
+        capabilities[cap_no]->time_slice = RtsFlags.ConcFlags.ctxtSwitchTime;
+    } else {
+        capabilities[cap_no]->time_slice = USToTime(usecs);
     }
 }
 
@@ -554,7 +635,8 @@ releaseCapability_ (Capability* cap,
         // is interrupted, we only create a worker task if there
         // are threads that need to be completed.  If the system is
         // shutting down, we never create a new worker.
-        if (sched_state < SCHED_SHUTTING_DOWN || !emptyRunQueue(cap)) {
+        if (sched_state < SCHED_SHUTTING_DOWN || !emptyRunQueue(cap) ||
+            !looksEmptyWSDeque(cap->steal_queue)) {
             debugTrace(DEBUG_sched,
                        "starting new worker on capability %d", cap->no);
             startWorkerTask(cap);
@@ -566,6 +648,7 @@ releaseCapability_ (Capability* cap,
     // anything else to do, give the Capability to a worker thread.
     if (always_wakeup ||
         !emptyRunQueue(cap) || !emptyInbox(cap) ||
+        !looksEmptyWSDeque(cap->steal_queue) ||
         (!cap->disabled && !emptySparkPoolCap(cap)) || globalWorkToDo()) {
         if (cap->spare_workers) {
             giveCapabilityToTask(cap, cap->spare_workers);
@@ -609,7 +692,8 @@ enqueueWorker (Capability* cap USED_IF_THREADS)
     ASSERT(!task->stopped);
     ASSERT(task->worker);
 
-    if (cap->n_spare_workers < MAX_SPARE_WORKERS)
+    if (cap->n_spare_workers <
+        stg_max(MAX_SPARE_WORKERS, RtsFlags.ParFlags.spareWorkers))
     {
         task->next = cap->spare_workers;
         cap->spare_workers = task;
@@ -629,20 +713,86 @@ enqueueWorker (Capability* cap USED_IF_THREADS)
 
 #endif
 
+/* ----------------------------------------------------------------------------
+ * Spinning for a Capability
+ *
+ * Note [Spinning for a Capability]
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * A Task waiting to be given a Capability (a Task returning from a
+ * safe foreign call that found its Capability busy, a spare worker, or
+ * a bound Task) sleeps on task->cond until giveCapabilityToTask() sets
+ * task->wakeup.  When the wait is short, as it is for a program making
+ * lots of short safe foreign calls, the sleep and the wakeup cost a
+ * pair of futex system calls and a trip through the OS scheduler,
+ * which can take much longer than the wait itself.
+ *
+ * So before it sleeps, the Task spins for a while watching
+ * task->wakeup.  How long it spins adapts to how long the recent waits
+ * on the Capability have been (cap->return_spins for returning Tasks,
+ * cap->worker_spins for the others): a wait that ends while we are
+ * spinning moves the estimate towards the number of spins it took, and
+ * a wait that ends up sleeping halves the estimate, so that we soon
+ * stop wasting CPU time when the Capability is held for long stretches.
+ * We spin at most RtsFlags.ParFlags.maxSpins times (+RTS -qs), and not
+ * at all if there is only one processor, because the Task holding the
+ * Capability can't make progress while we spin.  The estimates are
+ * only hints, so we update them without taking a lock.
+ *
+ * A safe foreign call also has to find a worker to hand the Capability
+ * to, and if there are no spare workers releaseCapability_() creates a
+ * new OS thread, which is slower still.  +RTS -qp<n> starts n spare
+ * workers for each Capability up front (startSpareWorkerTask()), and
+ * lets each Capability keep at least that many.
+ *
+ * When scheduler tracing is on, a Task that had to wait to return from
+ * a foreign call records how long it waited with
+ * EVENT_TASK_RETURN_WAIT.
+ * ------------------------------------------------------------------------- */
+
+#if defined(THREADED_RTS)
+
+// Spin at least this many times, however short the recent waits were
+#define MIN_SPINS 16
+
+// Spin until task->wakeup is set, for up to about twice the recent
+// waits.  Returns rtsTrue if it was set.
+static rtsBool
+spinForWakeup (Task *task, uint32_t *estimate)
+{
+    uint32_t i, limit;
+
+    limit = stg_min(max_spins, 2 * *estimate + MIN_SPINS);
+    for (i = 0; i < limit; i++) {
+        if (*(volatile rtsBool *)&task->wakeup) {
+            *estimate = *estimate - *estimate / 8 + i / 8;
+            return rtsTrue;
+        }
+        busy_wait_nop();
+    }
+    *estimate = *estimate / 2;
+    return rtsFalse;
+}
+
+#endif /* THREADED_RTS */
+
 /* ----------------------------------------------------------------------------
  * waitForWorkerCapability(task)
  *
  * waits to be given a Capability, and then returns the Capability.  The task
  * must be either a worker (and on a cap->spare_workers queue), or a bound Task.
+ * Also used by spare workers when they start (see startSpareWorkerTask()).
  * ------------------------------------------------------------------------- */
 
 #if defined(THREADED_RTS)
 
-static Capability * waitForWorkerCapability (Task *task)
+Capability * waitForWorkerCapability (Task *task)
 {
     Capability *cap;
 
     for (;;) {
+        // See Note [Spinning for a Capability]
+        spinForWakeup(task, &task->cap->worker_spins);
+
         ACQUIRE_LOCK(&task->lock);
         // task->lock held, cap->lock not held
         if (!task->wakeup) waitCondition(&task->cond, &task->lock);
@@ -697,20 +847,26 @@ static Capability * waitForWorkerCapability (Task *task)
  *
  * The Task should be on the cap->returning_tasks queue of a Capability.  This
  * function waits for the Task to be woken up, and returns the Capability that
- * it was woken up on.
+ * it was woken up on.  *parked is set if the Task had to sleep.
  *
  * ------------------------------------------------------------------------- */
 
 #if defined(THREADED_RTS)
 
-static Capability * waitForReturnCapability (Task *task)
+static Capability * waitForReturnCapability (Task *task, rtsBool *parked)
 {
     Capability *cap;
 
     for (;;) {
+        // See Note [Spinning for a Capability]
+        spinForWakeup(task, &task->cap->return_spins);
+
         ACQUIRE_LOCK(&task->lock);
         // task->lock held, cap->lock not held
-        if (!task->wakeup) waitCondition(&task->cond, &task->lock);
+        if (!task->wakeup) {
+            waitCondition(&task->cond, &task->lock);
+            *parked = rtsTrue;
+        }
         cap = task->cap;
         task->wakeup = rtsFalse;
         RELEASE_LOCK(&task->lock);
@@ -800,9 +956,19 @@ void waitForCapability (Capability **pCap, Task *task)
         cap->running_task = task;
         RELEASE_LOCK(&cap->lock);
     } else {
+        rtsBool parked = rtsFalse;
+#if defined(TRACING)
+        Time wait_start = 0;
+        if (RTS_UNLIKELY(TRACE_sched)) {
+            wait_start = getProcessElapsedTime();
+        }
+#endif
         newReturningTask(cap,task);
         RELEASE_LOCK(&cap->lock);
-        cap = waitForReturnCapability(task);
+        cap = waitForReturnCapability(task, &parked);
+#if defined(TRACING)
+        traceTaskReturnWait(cap, task, wait_start, parked);
+#endif
     }
 
 #ifdef PROFILING
@@ -858,6 +1024,7 @@ yieldCapability (Capability** pCap, Task *task, rtsBool gcAllowed)
                 gcWorkerThread(cap);
                 traceEventGcEnd(cap);
                 traceSparkCounters(cap);
+                traceThreadMigrationCounters(cap);
                 // See Note [migrated bound threads 2]
                 if (task->cap == cap) {
                     return rtsTrue;
@@ -889,9 +1056,10 @@ yieldCapability (Capability** pCap, Task *task, rtsBool gcAllowed)
         // what we do.  We still hold cap->lock at this point
         // The Task waiting for this Capability does not have it
         // yet, so we can be sure to be woken up later. (see #10545)
+        rtsBool parked = rtsFalse;
         newReturningTask(cap,task);
         RELEASE_LOCK(&cap->lock);
-        cap = waitForReturnCapability(task);
+        cap = waitForReturnCapability(task, &parked);
     }
 
     debugTrace(DEBUG_sched, "resuming capability %d", cap->no);
@@ -1089,6 +1257,7 @@ shutdownCapability (Capability *cap USED_IF_THREADS,
         }
 
         traceSparkCounters(cap);
+        traceThreadMigrationCounters(cap);
         RELEASE_LOCK(&cap->lock);
         break;
     }
@@ -1122,7 +1291,10 @@ freeCapability (Capability *cap)
     stgFree(cap->saved_mut_lists);
 #if defined(THREADED_RTS)
     freeSparkPool(cap->sparks);
+    stgFree(cap->spark_gen_marks);
+    freeWSDeque(cap->steal_queue);
 #endif
+    freeAdjustorPool(cap->adjustor_pool);
     traceCapsetRemoveCap(CAPSET_OSPROCESS_DEFAULT, cap->no);
     traceCapsetRemoveCap(CAPSET_CLOCKDOMAIN_DEFAULT, cap->no);
     traceCapDelete(cap);
@@ -1157,14 +1329,17 @@ markCapability (evac_fn evac, void *user, Capability *cap,
                 rtsBool no_mark_sparks USED_IF_THREADS)
 {
     InCall *incall;
+    uint32_t p;
 
     // Each GC thread is responsible for following roots from the
     // Capability of the same number.  There will usually be the same
     // or fewer Capabilities as GC threads, but just in case there
     // are more, we mark every Capability whose number is the GC
     // thread's index plus a multiple of the number of GC threads.
-    evac(user, (StgClosure **)(void *)&cap->run_queue_hd);
-    evac(user, (StgClosure **)(void *)&cap->run_queue_tl);
+    for (p = 0; p < N_THREAD_PRIORITIES; p++) {
+        evac(user, (StgClosure **)(void *)&cap->run_queue_hd[p]);
+        evac(user, (StgClosure **)(void *)&cap->run_queue_tl[p]);
+    }
 #if defined(THREADED_RTS)
     evac(user, (StgClosure **)(void *)&cap->inbox);
 #endif
@@ -1177,8 +1352,24 @@ markCapability (evac_fn evac, void *user, Capability *cap,
     if (!no_mark_sparks) {
         traverseSparkQueue (evac, user, cap);
     }
+    // Unlike sparks, the threads in the steal queue are runnable and
+    // must always be kept alive.
+    {
+        WSDeque *q = cap->steal_queue;
+        StgWord top;
+        for (top = q->top; top < q->bottom; top++) {
+            evac(user, (StgClosure **)(q->elements + (top & q->moduloSize)));
+        }
+    }
 #endif
 
+    // Drop the cached stack chunks: see Note [Stack chunk cache] in
+    // Threads.c
+    cap->n_cached_stack_chunks = 0;
+
+    // but keep the dead threads: see Note [Recycling dead threads]
+    evac(user, (StgClosure **)(void *)&cap->free_tsos);
+
     // Free STM structures for this Capability
     stmPreGCHook(cap);
 }
@@ -24,9 +24,16 @@
 #include "sm/GC.h" // for evac_fn
 #include "Task.h"
 #include "Sparks.h"
+#include "AdjustorPool.h"
 
 #include "BeginPrivate.h"
 
+// Number of free stack chunks each Capability keeps between GCs
+#define STACK_CHUNK_CACHE_SIZE 4
+
+// Number of dead threads each Capability keeps for recycling
+#define MAX_FREE_TSOS 32
+
 struct Capability_ {
     // State required by the STG virtual machine when running Haskell
     // code.  During STG execution, the BaseReg register always points
@@ -64,8 +71,14 @@ struct Capability_ {
     // access to its run queue, so can wake up threads without
     // taking a lock, and the common path through the scheduler is
     // also lock-free.
-    StgTSO *run_queue_hd;
-    StgTSO *run_queue_tl;
+    //
+    // There is one queue for each thread priority, and n_run_queue
+    // counts the threads in all of them.  run_queue_skipped[p] counts
+    // the threads run ahead of queue p since it last had a thread run,
+    // see Note [Thread priorities] in Schedule.c.
+    StgTSO *run_queue_hd[N_THREAD_PRIORITIES];
+    StgTSO *run_queue_tl[N_THREAD_PRIORITIES];
+    uint32_t run_queue_skipped[N_THREAD_PRIORITIES];
     uint32_t n_run_queue;
 
     // Tasks currently making safe foreign calls.  Doubly-linked.
@@ -90,6 +103,23 @@ struct Capability_ {
     // full pinned object blocks allocated since the last GC
     bdescr *pinned_object_blocks;
 
+    // Empty stack chunks of the standard size (+RTS -kc), freed by
+    // threads on this Capability since the last GC, for reuse when a
+    // thread's stack overflows.  See Note [Stack chunk cache] in
+    // Threads.c.
+    StgStack *stack_chunk_cache[STACK_CHUNK_CACHE_SIZE];
+    uint32_t n_cached_stack_chunks;
+    // standard-size chunks taken from the cache, and allocated afresh
+    W_ stack_chunk_hits;
+    W_ stack_chunk_misses;
+
+    // Dead threads, with their stacks, that createThread() can reuse;
+    // linked by _link.  Refilled by the GC from the threads that died
+    // on this Capability.  See Note [Recycling dead threads] in
+    // Threads.c.
+    StgTSO *free_tsos;
+    uint32_t n_free_tsos;
+
     // per-capability weak pointer list associated with nursery (older
     // lists stored in generation object)
     StgWeak *weak_ptr_list_hd;
@@ -109,6 +139,13 @@ struct Capability_ {
     // reset after we have executed the context switch.
     int interrupt;
 
+    // Time slicing, see Note [Time slices] in Schedule.c: the thread
+    // whose slice is running, when the slice started, and the length
+    // of a slice on this Capability.
+    StgThreadID slice_thread;
+    Time slice_start;
+    Time time_slice;
+
     // Total words allocated by this cap since rts start
     // See [Note allocation accounting] in Storage.c
     W_ total_allocated;
@@ -122,7 +159,6 @@ struct Capability_ {
     //    running_task
     //    returning_tasks_{hd,tl}
     //    wakeup_queue
-    //    inbox
     Mutex lock;
 
     // Tasks waiting to return from a foreign call, or waiting to make
@@ -134,14 +170,38 @@ struct Capability_ {
     Task *returning_tasks_tl;
     uint32_t n_returning_tasks;
 
-    // Messages, or END_TSO_QUEUE.
-    // Locks required: cap->lock
+    // How long, in spins, returning Tasks and spare workers have
+    // recently had to wait for this Capability.  See Note [Spinning for
+    // a Capability] in Capability.c.
+    uint32_t return_spins;
+    uint32_t worker_spins;
+
+    // Messages, or END_TSO_QUEUE.  Lock-free: other Capabilities push
+    // with cas(), the owner takes the lot with xchg().  See Note
+    // [Capability inbox] in Messages.c.
     Message *inbox;
 
     SparkPool *sparks;
 
+    // For each generation g, all the sparks in the pool below index
+    // spark_gen_marks[g] point into generations older than g.  See
+    // Note [Pruning the spark pool] in Sparks.c.
+    StgWord *spark_gen_marks;
+
+    // Sparks created since the last GC (see newSpark())
+    StgClosure *recent_sparks[SPARK_FILTER_SIZE];
+
+    // Threads offered to other Capabilities (+RTS -qt).  Only this
+    // Capability pushes and pops; others may steal.  See Note [Thread
+    // stealing] in Schedule.c.
+    WSDeque *steal_queue;
+
     // Stats on spark creation/conversion
     SparkCounters spark_stats;
+
+    // Number of threads schedulePushWork() has given away to
+    // capabilities on each NUMA node.
+    StgWord64 thread_migrations[MAX_NUMA_NODES];
 #if !defined(mingw32_HOST_OS)
     // IO manager for this cap
     int io_manager_control_wr_fd;
@@ -154,6 +214,10 @@ struct Capability_ {
     StgTRecChunk *free_trec_chunks;
     StgTRecHeader *free_trec_headers;
     uint32_t transaction_tokens;
+
+    // Executable memory for adjustors, allocated on first use.  See
+    // Note [Adjustor pool] in AdjustorPool.c.
+    AdjustorPool *adjustor_pool;
 } // typedef Capability is defined in RtsAPI.h
   // We never want a Capability to overlap a cache line with anything
   // else, so round it up to a cache line size:
@@ -185,15 +249,31 @@ struct Capability_ {
 #define ASSERT_RETURNING_TASKS(cap,task) /* nothing */
 #endif
 
+// Each run queue is either empty or has both ends, and n_run_queue is
+// zero only if they are all empty.
+INLINE_HEADER rtsBool
+runQueueEndsOK (Capability *cap)
+{
+    uint32_t p;
+    rtsBool empty = rtsTrue;
+
+    for (p = 0; p < N_THREAD_PRIORITIES; p++) {
+        if ((cap->run_queue_hd[p] == END_TSO_QUEUE) !=
+            (cap->run_queue_tl[p] == END_TSO_QUEUE)) {
+            return rtsFalse;
+        }
+        if (cap->run_queue_hd[p] != END_TSO_QUEUE) empty = rtsFalse;
+    }
+    return empty == (cap->n_run_queue == 0);
+}
+
 // Sometimes a Task holds a Capability, but the Task is not associated
 // with that Capability (ie. task->cap != cap).  This happens when
 // (a) a Task holds multiple Capabilities, and (b) when the current
 // Task is bound, its thread has just blocked, and it may have been
 // moved to another Capability.
 #define ASSERT_PARTIAL_CAPABILITY_INVARIANTS(cap,task)                  \
-  ASSERT(cap->run_queue_hd == END_TSO_QUEUE ?                           \
-            cap->run_queue_tl == END_TSO_QUEUE && cap->n_run_queue == 0 \
-         : 1);                                                          \
+  ASSERT(runQueueEndsOK(cap));                                          \
   ASSERT(cap->suspended_ccalls == NULL ? cap->n_suspended_ccalls == 0 : 1); \
   ASSERT(myTask() == task);                                             \
   ASSERT_TASK_ID(task);
@@ -283,6 +363,13 @@ extern PendingSync * volatile pending_sync;
 //
 void waitForCapability (Capability **cap/*in/out*/, Task *task);
 
+#if defined(THREADED_RTS)
+// Waits for a worker or bound Task to be given a Capability, see
+// startSpareWorkerTask().
+//
+Capability * waitForWorkerCapability (Task *task);
+#endif
+
 EXTERN_INLINE void recordMutableCap (const StgClosure *p, Capability *cap,
                                         uint32_t gen);
 
@@ -342,8 +429,9 @@ extern void grabCapability (Capability **pCap);
 //
 void shutdownCapabilities(Task *task, rtsBool wait_foreign);
 
-// cause all capabilities to context switch as soon as possible.
-void contextSwitchAllCapabilities(void);
+// cause the capabilities whose thread has used up its time slice to
+// context switch as soon as possible.
+void preemptCapabilities(Time now);
 INLINE_HEADER void contextSwitchCapability(Capability *cap);
 
 // cause all capabilities to stop running Haskell code and return to
@@ -459,7 +547,7 @@ contextSwitchCapability (Capability *cap)
 
 INLINE_HEADER rtsBool emptyInbox(Capability *cap)
 {
-    return (cap->inbox == (Message*)END_TSO_QUEUE);
+    return ((Message*)VOLATILE_LOAD(&cap->inbox) == (Message*)END_TSO_QUEUE);
 }
 
 #endif
@@ -12,12 +12,13 @@
 #include "Rts.h"
 
 #include "RtsUtils.h"
-#include "Hash.h"
 #include "LinkerInternals.h"
 #include "CheckUnload.h"
 #include "sm/Storage.h"
 #include "sm/GCThread.h"
 
+#include <stdlib.h> // for qsort()
+
 //
 // Code that we unload may be referenced from:
 //   - info pointers in heap objects and stack frames
@@ -31,37 +32,133 @@
 // traversal: we look at the header of every object, but not its
 // contents.
 //
-// On the assumption that there aren't many different info pointers in
-// a typical heap, we insert addresses into a hash table.  The
-// first time we see an address, we check it against the pending
-// unloadable objects and if it lies within any of them, we mark that
-// object as referenced so that it won't get unloaded in this round.
+// See Note [Searching for references to unloaded code] for how the
+// addresses are classified, and how the work is shared between the GC
+// threads.
 //
 
-static void checkAddress (HashTable *addrs, const void *addr)
-{
+/* Note [Searching for references to unloaded code]
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+   Every address we look at has to be checked against the sections of
+   every object on unloaded_objects.  There may be hundreds of those
+   (e.g. a program that keeps reloading plugins), so at the start of a
+   major GC prepareUnloadCheck() collects the sections into
+   unload_ranges, sorted by start address, and checkAddress() does a
+   binary search.  Most addresses are info pointers of code that is
+   not being unloaded at all, and most of those are rejected by
+   comparing against the lowest and highest address in unload_ranges.
+   (Sections of different objects never overlap, so the last range
+   starting at or below an address is the only one that can contain
+   it.)
+
+   The search is done by all the GC threads, once the heap has been
+   fully marked but before they are shut down:
+
+     - each GC thread searches the static objects it evacuated and the
+       block it was copying into (ws->todo_bd, which is filled up to
+       ws->todo_free rather than bd->free);
+
+     - the other blocks of the heap are collected into unload_blocks by
+       the main GC thread in markUnloadReferences(), and the GC threads
+       claim them UNLOAD_CHUNK at a time.
+
+   Marking an object as referenced is a plain store of 1, so it doesn't
+   matter if several threads do it at once.  Freeing the unreferenced
+   objects is left to checkUnload(), after the GC has unlocked the
+   StablePtr table.
+
+   If the oldest generation is compacted or swept, its live objects are
+   still in place in from-space at this point, and we can't walk those
+   blocks.  In that case the heap is searched by checkUnload() alone,
+   after the GC has finished, as it always used to be.
+*/
+
+typedef struct {
+    W_ start;
+    W_ end;
     ObjectCode *oc;
-    int i;
+} UnloadRange;
 
-    if (!lookupHashTable(addrs, (W_)addr)) {
-        insertHashTable(addrs, (W_)addr, addr);
-
-        for (oc = unloaded_objects; oc; oc = oc->next) {
-            for (i = 0; i < oc->n_sections; i++) {
-                if (oc->sections[i].kind != SECTIONKIND_OTHER) {
-                    if ((W_)addr >= (W_)oc->sections[i].start &&
-                        (W_)addr <  (W_)oc->sections[i].start
-                                    + oc->sections[i].size) {
-                        oc->referenced = 1;
-                        return;
-                    }
-                }
-            }
+// Are we checking for unloadable objects in this GC?
+static rtsBool unload_check = rtsFalse;
+
+// Must the heap be searched by checkUnload(), rather than during GC?
+static rtsBool unload_search_after_gc = rtsFalse;
+
+static UnloadRange *unload_ranges = NULL;
+static uint32_t n_unload_ranges = 0;
+static uint32_t unload_ranges_size = 0;
+static W_ unload_lo, unload_hi;
+
+static bdescr **unload_blocks = NULL;
+static StgWord n_unload_blocks = 0;
+static StgWord unload_blocks_size = 0;
+
+/* The GC threads claim unload_blocks UNLOAD_CHUNK blocks at a time,
+ * once the main GC thread has set unload_blocks_ready. */
+#define UNLOAD_CHUNK 32
+static volatile StgWord unload_next = 0;
+static volatile StgWord unload_blocks_ready = 0;
+
+static void checkAddress (const void *addr)
+{
+    uint32_t lo, hi, mid;
+
+    if ((W_)addr < unload_lo || (W_)addr >= unload_hi) return;
+
+    // find the last range that starts at or below addr
+    lo = 0;
+    hi = n_unload_ranges;
+    while (hi - lo > 1) {
+        mid = lo + (hi - lo) / 2;
+        if (unload_ranges[mid].start <= (W_)addr) {
+            lo = mid;
+        } else {
+            hi = mid;
         }
     }
+
+    if ((W_)addr < unload_ranges[lo].end) {
+        unload_ranges[lo].oc->referenced = 1;
+    }
+}
+
+static int cmpUnloadRange (const void *a, const void *b)
+{
+    W_ x = ((const UnloadRange *)a)->start;
+    W_ y = ((const UnloadRange *)b)->start;
+    return (x > y) - (x < y);
+}
+
+static void addUnloadRange (ObjectCode *oc, Section *s)
+{
+    if (n_unload_ranges == unload_ranges_size) {
+        unload_ranges_size = stg_max(2 * unload_ranges_size, 64);
+        unload_ranges = stgReallocBytes(unload_ranges,
+                                        unload_ranges_size * sizeof(UnloadRange),
+                                        "addUnloadRange");
+    }
+    unload_ranges[n_unload_ranges].start = (W_)s->start;
+    unload_ranges[n_unload_ranges].end   = (W_)s->start + s->size;
+    unload_ranges[n_unload_ranges].oc    = oc;
+    n_unload_ranges++;
 }
 
-static void searchStackChunk (HashTable *addrs, StgPtr sp, StgPtr stack_end)
+static void addUnloadBlocks (bdescr *bd)
+{
+    for (; bd != NULL; bd = bd->link) {
+        if (n_unload_blocks == unload_blocks_size) {
+            unload_blocks_size = stg_max(2 * unload_blocks_size, 1024);
+            unload_blocks = stgReallocBytes(unload_blocks,
+                                            unload_blocks_size * sizeof(bdescr *),
+                                            "addUnloadBlocks");
+        }
+        unload_blocks[n_unload_blocks++] = bd;
+    }
+}
+
+static void searchStackChunk (StgPtr sp, StgPtr stack_end)
 {
     StgPtr p;
     const StgRetInfoTable *info;
@@ -73,7 +170,7 @@ static void searchStackChunk (HashTable *addrs, StgPtr sp, StgPtr stack_end)
         switch (info->i.type) {
         case RET_SMALL:
         case RET_BIG:
-            checkAddress(addrs, (const void*)info);
+            checkAddress((const void*)info);
             break;
 
         default:
@@ -85,163 +182,181 @@ static void searchStackChunk (HashTable *addrs, StgPtr sp, StgPtr stack_end)
 }
 
 
-static void searchHeapBlocks (HashTable *addrs, bdescr *bd)
+// Search the objects in bd up to (but not including) end.
+static void searchHeapBlock (bdescr *bd, StgPtr end)
 {
     StgPtr p;
     const StgInfoTable *info;
     uint32_t size;
     rtsBool prim;
 
-    for (; bd != NULL; bd = bd->link) {
+    if (bd->flags & BF_PINNED) {
+        // Assume that objects in PINNED blocks cannot refer to
+        return;
+    }
+
+    p = bd->start;
+    while (p < end) {
+        info = get_itbl((StgClosure *)p);
+        prim = rtsFalse;
+
+        switch (info->type) {
+
+        case THUNK:
+            size = thunk_sizeW_fromITBL(info);
+            break;
+
+        case THUNK_1_1:
+        case THUNK_0_2:
+        case THUNK_2_0:
+            size = sizeofW(StgThunkHeader) + 2;
+            break;
+
+        case THUNK_1_0:
+        case THUNK_0_1:
+        case THUNK_SELECTOR:
+            size = sizeofW(StgThunkHeader) + 1;
+            break;
+
+        case CONSTR:
+        case FUN:
+        case FUN_1_0:
+        case FUN_0_1:
+        case FUN_1_1:
+        case FUN_0_2:
+        case FUN_2_0:
+        case CONSTR_1_0:
+        case CONSTR_0_1:
+        case CONSTR_1_1:
+        case CONSTR_0_2:
+        case CONSTR_2_0:
+            size = sizeW_fromITBL(info);
+            break;
 
-        if (bd->flags & BF_PINNED) {
-            // Assume that objects in PINNED blocks cannot refer to
-            continue;
+        case BLACKHOLE:
+        case BLOCKING_QUEUE:
+            prim = rtsTrue;
+            size = sizeW_fromITBL(info);
+            break;
+
+        case IND:
+            // Special case/Delicate Hack: INDs don't normally
+            // appear, since we're doing this heap census right
+            // after GC.  However, GarbageCollect() also does
+            // resurrectThreads(), which can update some
+            // blackholes when it calls raiseAsync() on the
+            // resurrected threads.  So we know that any IND will
+            // be the size of a BLACKHOLE.
+            prim = rtsTrue;
+            size = BLACKHOLE_sizeW();
+            break;
+
+        case BCO:
+            prim = rtsTrue;
+            size = bco_sizeW((StgBCO *)p);
+            break;
+
+        case MVAR_CLEAN:
+        case MVAR_DIRTY:
+        case TVAR:
+        case WEAK:
+        case PRIM:
+        case MUT_PRIM:
+        case MUT_VAR_CLEAN:
+        case MUT_VAR_DIRTY:
+            prim = rtsTrue;
+            size = sizeW_fromITBL(info);
+            break;
+
+        case AP:
+            prim = rtsTrue;
+            size = ap_sizeW((StgAP *)p);
+            break;
+
+        case PAP:
+            prim = rtsTrue;
+            size = pap_sizeW((StgPAP *)p);
+            break;
+
+        case AP_STACK:
+        {
+            StgAP_STACK *ap = (StgAP_STACK *)p;
+            prim = rtsTrue;
+            size = ap_stack_sizeW(ap);
+            searchStackChunk((StgPtr)ap->payload,
+                             (StgPtr)ap->payload + ap->size);
+            break;
         }
 
-        p = bd->start;
-        while (p < bd->free) {
-            info = get_itbl((StgClosure *)p);
-            prim = rtsFalse;
-
-            switch (info->type) {
-
-            case THUNK:
-                size = thunk_sizeW_fromITBL(info);
-                break;
-
-            case THUNK_1_1:
-            case THUNK_0_2:
-            case THUNK_2_0:
-                size = sizeofW(StgThunkHeader) + 2;
-                break;
-
-            case THUNK_1_0:
-            case THUNK_0_1:
-            case THUNK_SELECTOR:
-                size = sizeofW(StgThunkHeader) + 1;
-                break;
-
-            case CONSTR:
-            case FUN:
-            case FUN_1_0:
-            case FUN_0_1:
-            case FUN_1_1:
-            case FUN_0_2:
-            case FUN_2_0:
-            case CONSTR_1_0:
-            case CONSTR_0_1:
-            case CONSTR_1_1:
-            case CONSTR_0_2:
-            case CONSTR_2_0:
-                size = sizeW_fromITBL(info);
-                break;
-
-            case BLACKHOLE:
-            case BLOCKING_QUEUE:
-                prim = rtsTrue;
-                size = sizeW_fromITBL(info);
-                break;
-
-            case IND:
-                // Special case/Delicate Hack: INDs don't normally
-                // appear, since we're doing this heap census right
-                // after GC.  However, GarbageCollect() also does
-                // resurrectThreads(), which can update some
-                // blackholes when it calls raiseAsync() on the
-                // resurrected threads.  So we know that any IND will
-                // be the size of a BLACKHOLE.
-                prim = rtsTrue;
-                size = BLACKHOLE_sizeW();
-                break;
-
-            case BCO:
-                prim = rtsTrue;
-                size = bco_sizeW((StgBCO *)p);
-                break;
-
-            case MVAR_CLEAN:
-            case MVAR_DIRTY:
-            case TVAR:
-            case WEAK:
-            case PRIM:
-            case MUT_PRIM:
-            case MUT_VAR_CLEAN:
-            case MUT_VAR_DIRTY:
-                prim = rtsTrue;
-                size = sizeW_fromITBL(info);
-                break;
-
-            case AP:
-                prim = rtsTrue;
-                size = ap_sizeW((StgAP *)p);
-                break;
-
-            case PAP:
-                prim = rtsTrue;
-                size = pap_sizeW((StgPAP *)p);
-                break;
-
-            case AP_STACK:
-            {
-                StgAP_STACK *ap = (StgAP_STACK *)p;
-                prim = rtsTrue;
-                size = ap_stack_sizeW(ap);
-                searchStackChunk(addrs, (StgPtr)ap->payload,
-                                 (StgPtr)ap->payload + ap->size);
-                break;
-            }
+        case ARR_WORDS:
+            prim = rtsTrue;
+            size = arr_words_sizeW((StgArrBytes*)p);
+            break;
 
-            case ARR_WORDS:
-                prim = rtsTrue;
-                size = arr_words_sizeW((StgArrBytes*)p);
-                break;
-
-            case MUT_ARR_PTRS_CLEAN:
-            case MUT_ARR_PTRS_DIRTY:
-            case MUT_ARR_PTRS_FROZEN:
-            case MUT_ARR_PTRS_FROZEN0:
-                prim = rtsTrue;
-                size = mut_arr_ptrs_sizeW((StgMutArrPtrs *)p);
-                break;
-
-            case SMALL_MUT_ARR_PTRS_CLEAN:
-            case SMALL_MUT_ARR_PTRS_DIRTY:
-            case SMALL_MUT_ARR_PTRS_FROZEN:
-            case SMALL_MUT_ARR_PTRS_FROZEN0:
-                prim = rtsTrue;
-                size = small_mut_arr_ptrs_sizeW((StgSmallMutArrPtrs *)p);
-                break;
-
-            case TSO:
-                prim = rtsTrue;
-                size = sizeofW(StgTSO);
-                break;
-
-            case STACK: {
-                StgStack *stack = (StgStack*)p;
-                prim = rtsTrue;
-                searchStackChunk(addrs, stack->sp,
-                                 stack->stack + stack->stack_size);
-                size = stack_sizeW(stack);
-                break;
-            }
+        case MUT_ARR_PTRS_CLEAN:
+        case MUT_ARR_PTRS_DIRTY:
+        case MUT_ARR_PTRS_FROZEN:
+        case MUT_ARR_PTRS_FROZEN0:
+            prim = rtsTrue;
+            size = mut_arr_ptrs_sizeW((StgMutArrPtrs *)p);
+            break;
+
+        case SMALL_MUT_ARR_PTRS_CLEAN:
+        case SMALL_MUT_ARR_PTRS_DIRTY:
+        case SMALL_MUT_ARR_PTRS_FROZEN:
+        case SMALL_MUT_ARR_PTRS_FROZEN0:
+            prim = rtsTrue;
+            size = small_mut_arr_ptrs_sizeW((StgSmallMutArrPtrs *)p);
+            break;
 
-            case TREC_CHUNK:
-                prim = rtsTrue;
-                size = sizeofW(StgTRecChunk);
-                break;
+        case TSO:
+            prim = rtsTrue;
+            size = sizeofW(StgTSO);
+            break;
 
-            default:
-                barf("heapCensus, unknown object: %d", info->type);
-            }
+        case STACK: {
+            StgStack *stack = (StgStack*)p;
+            prim = rtsTrue;
+            searchStackChunk(stack->sp,
+                             stack->stack + stack->stack_size);
+            size = stack_sizeW(stack);
+            break;
+        }
 
-            if (!prim) {
-                checkAddress(addrs,info);
-            }
+        case TREC_CHUNK:
+            prim = rtsTrue;
+            size = sizeofW(StgTRecChunk);
+            break;
+
+        default:
+            barf("heapCensus, unknown object: %d", info->type);
+        }
 
-            p += size;
+        if (!prim) {
+            checkAddress(info);
         }
+
+        p += size;
+    }
+}
+
+static void searchHeapBlocks (bdescr *bd)
+{
+    for (; bd != NULL; bd = bd->link) {
+        searchHeapBlock(bd, bd->free);
+    }
+}
+
+static void searchStaticObjects (StgClosure *static_objects)
+{
+    StgClosure *p, *link;
+    const StgInfoTable *info;
+
+    for (p = static_objects; p != END_OF_STATIC_OBJECT_LIST; p = link) {
+        p = UNTAG_STATIC_LIST_PTR(p);
+        checkAddress(p);
+        info = get_itbl(p);
+        link = *STATIC_LINK(info, p);
     }
 }
 
@@ -250,89 +365,210 @@ static void searchHeapBlocks (HashTable *addrs, bdescr *bd)
 // Do not unload the object if the CCS tree refers to a CCS or CC which
 // originates in the object.
 //
-static void searchCostCentres (HashTable *addrs, CostCentreStack *ccs)
+static void searchCostCentres (CostCentreStack *ccs)
 {
     IndexTable *i;
 
-    checkAddress(addrs, ccs);
-    checkAddress(addrs, ccs->cc);
+    checkAddress(ccs);
+    checkAddress(ccs->cc);
     for (i = ccs->indexTable; i != NULL; i = i->next) {
         if (!i->back_edge) {
-            searchCostCentres(addrs, i->ccs);
+            searchCostCentres(i->ccs);
         }
     }
 }
 #endif
 
 //
-// Check whether we can unload any object code.  This is called at the
-// appropriate point during a GC, where all the heap data is nice and
-// packed together and we have a linked list of the static objects.
-//
-// The check involves a complete heap traversal, but you only pay for
-// this (a) when you have called unloadObj(), and (b) at a major GC,
-// which is much more expensive than the traversal we're doing here.
+// Called by the main GC thread before the other GC threads are woken
+// up, so that they can see whether there is an unload check to do in
+// this GC.
 //
-void checkUnload (StgClosure *static_objects)
+void prepareUnloadCheck (rtsBool major_gc)
 {
-  uint32_t g, n;
-  HashTable *addrs;
-  StgClosure* p;
-  const StgInfoTable *info;
-  ObjectCode *oc, *prev, *next;
-  gen_workspace *ws;
-  StgClosure* link;
+    ObjectCode *oc;
+    int i;
 
-  if (unloaded_objects == NULL) return;
+    unload_check = rtsFalse;
+    unload_next = 0;
+    unload_blocks_ready = 0;
+    n_unload_blocks = 0;
+
+    if (!major_gc || unloaded_objects == NULL) return;
+
+    ACQUIRE_LOCK(&linker_unloaded_mutex);
+
+    // Mark every unloadable object as unreferenced initially
+    n_unload_ranges = 0;
+    for (oc = unloaded_objects; oc; oc = oc->next) {
+        IF_DEBUG(linker, debugBelch("Checking whether to unload %" PATH_FMT "\n",
+                                    oc->fileName));
+        oc->referenced = rtsFalse;
+        for (i = 0; i < oc->n_sections; i++) {
+            if (oc->sections[i].kind != SECTIONKIND_OTHER &&
+                oc->sections[i].size > 0) {
+                addUnloadRange(oc, &oc->sections[i]);
+            }
+        }
+    }
 
-  ACQUIRE_LOCK(&linker_unloaded_mutex);
+    if (n_unload_ranges > 0) {
+        qsort(unload_ranges, n_unload_ranges, sizeof(UnloadRange),
+              cmpUnloadRange);
+        unload_lo = unload_ranges[0].start;
+        unload_hi = 0;
+        for (i = 0; i < (int)n_unload_ranges; i++) {
+            unload_hi = stg_max(unload_hi, unload_ranges[i].end);
+        }
+    } else {
+        // nothing can be referenced
+        unload_lo = 1;
+        unload_hi = 0;
+    }
 
-  // Mark every unloadable object as unreferenced initially
-  for (oc = unloaded_objects; oc; oc = oc->next) {
-      IF_DEBUG(linker, debugBelch("Checking whether to unload %" PATH_FMT "\n",
-                                  oc->fileName));
-      oc->referenced = rtsFalse;
-  }
+    unload_search_after_gc = oldest_gen->mark != 0;
+    unload_check = rtsTrue;
+}
 
-  addrs = allocHashTable();
+static void searchUnloadBlocks (void)
+{
+    StgWord i, start, end;
+
+    for (;;) {
+        start = atomic_inc(&unload_next, UNLOAD_CHUNK) - UNLOAD_CHUNK;
+        if (start >= n_unload_blocks) break;
+        end = stg_min(start + UNLOAD_CHUNK, n_unload_blocks);
+        for (i = start; i < end; i++) {
+            searchHeapBlock(unload_blocks[i], unload_blocks[i]->free);
+        }
+    }
+}
 
-  for (p = static_objects; p != END_OF_STATIC_OBJECT_LIST; p = link) {
-      p = UNTAG_STATIC_LIST_PTR(p);
-      checkAddress(addrs, p);
-      info = get_itbl(p);
-      link = *STATIC_LINK(info, p);
-  }
+// The part of the search that each GC thread does for itself.
+static void searchGcThread (gc_thread *t)
+{
+    uint32_t g;
+    gen_workspace *ws;
 
-  // CAFs on revertible_caf_list are not on static_objects
-  for (p = (StgClosure*)revertible_caf_list;
-       p != END_OF_CAF_LIST;
-       p = ((StgIndStatic *)p)->static_link) {
-      p = UNTAG_STATIC_LIST_PTR(p);
-      checkAddress(addrs, p);
-  }
+    searchStaticObjects(t->scavenged_static_objects);
 
-  for (g = 0; g < RtsFlags.GcFlags.generations; g++) {
-      searchHeapBlocks (addrs, generations[g].blocks);
-      searchHeapBlocks (addrs, generations[g].large_objects);
+    if (unload_search_after_gc) return;
 
-      for (n = 0; n < n_capabilities; n++) {
-          ws = &gc_threads[n]->gens[g];
-          searchHeapBlocks(addrs, ws->todo_bd);
-          searchHeapBlocks(addrs, ws->part_list);
-          searchHeapBlocks(addrs, ws->scavd_list);
-      }
-  }
+    for (g = 0; g < RtsFlags.GcFlags.generations; g++) {
+        ws = &t->gens[g];
+        searchHeapBlock(ws->todo_bd, ws->todo_free);
+    }
+}
+
+//
+// Called by the main GC thread once the heap has been fully marked,
+// but before shutdown_gc_threads(), so that the other GC threads can
+// take part (see checkUnloadWorker()).
+//
+void markUnloadReferences (gc_thread *me)
+{
+    uint32_t g, n;
+    StgClosure *p;
+    gen_workspace *ws;
+
+    if (!unload_check) return;
+
+    if (!unload_search_after_gc) {
+        for (g = 0; g < RtsFlags.GcFlags.generations; g++) {
+            addUnloadBlocks(generations[g].blocks);
+            addUnloadBlocks(generations[g].scavenged_large_objects);
+            // the workspaces of GC threads that aren't taking part are
+            // empty (see prepare_collected_gen())
+            for (n = 0; n < n_capabilities; n++) {
+                ws = &gc_threads[n]->gens[g];
+                addUnloadBlocks(ws->part_list);
+                addUnloadBlocks(ws->scavd_list);
+            }
+        }
+    }
+
+    write_barrier();
+    unload_blocks_ready = 1;
+
+    searchGcThread(me);
+    searchUnloadBlocks();
+
+    // CAFs on revertible_caf_list are not on static_objects
+    for (p = (StgClosure*)revertible_caf_list;
+         p != END_OF_CAF_LIST;
+         p = ((StgIndStatic *)p)->static_link) {
+        p = UNTAG_STATIC_LIST_PTR(p);
+        checkAddress(p);
+    }
 
 #ifdef PROFILING
-  /* Traverse the cost centre tree, calling checkAddress on each CCS/CC */
-  searchCostCentres(addrs, CCS_MAIN);
+    /* Traverse the cost centre tree, calling checkAddress on each CCS/CC */
+    searchCostCentres(CCS_MAIN);
 
-  /* Also check each cost centre in the CC_LIST */
-  CostCentre *cc;
-  for (cc = CC_LIST; cc != NULL; cc = cc->link) {
-      checkAddress(addrs, cc);
-  }
+    /* Also check each cost centre in the CC_LIST */
+    CostCentre *cc;
+    for (cc = CC_LIST; cc != NULL; cc = cc->link) {
+        checkAddress(cc);
+    }
 #endif /* PROFILING */
+}
+
+#ifdef THREADED_RTS
+//
+// Called by the other GC threads when they have finished scavenging.
+//
+void checkUnloadWorker (gc_thread *me)
+{
+    uint32_t spins = 0;
+
+    if (!unload_check) return;
+
+    searchGcThread(me);
+
+    while (unload_blocks_ready == 0) {
+        busy_wait_nop();
+        if (++spins == 1000) {
+            yieldThread();
+            spins = 0;
+        }
+    }
+    load_load_barrier();
+    searchUnloadBlocks();
+}
+#endif
+
+//
+// Unload any object code that markUnloadReferences() found no
+// references to.  This is called at the end of a major GC, after the
+// StablePtr table has been unlocked, because freeing an object may free
+// StablePtrs.
+//
+// The check involves a complete heap traversal, but you only pay for
+// this (a) when you have called unloadObj(), and (b) at a major GC,
+// which is much more expensive than the traversal we're doing here.
+//
+void checkUnload (void)
+{
+  uint32_t g, n;
+  ObjectCode *oc, *prev, *next;
+  gen_workspace *ws;
+
+  if (!unload_check) return;
+
+  if (unload_search_after_gc) {
+      // See Note [Searching for references to unloaded code]
+      for (g = 0; g < RtsFlags.GcFlags.generations; g++) {
+          searchHeapBlocks (generations[g].blocks);
+          searchHeapBlocks (generations[g].large_objects);
+
+          for (n = 0; n < n_capabilities; n++) {
+              ws = &gc_threads[n]->gens[g];
+              searchHeapBlocks(ws->todo_bd);
+              searchHeapBlocks(ws->part_list);
+              searchHeapBlocks(ws->scavd_list);
+          }
+      }
+  }
 
   // Look through the unloadable objects, and any object that is still
   // marked as unreferenced can be physically unloaded, because we
@@ -356,7 +592,7 @@ void checkUnload (StgClosure *static_objects)
       }
   }
 
-  freeHashTable(addrs, NULL);
+  unload_check = rtsFalse;
 
   RELEASE_LOCK(&linker_unloaded_mutex);
 }
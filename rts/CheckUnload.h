@@ -13,7 +13,15 @@
 
 #include "BeginPrivate.h"
 
-void checkUnload (StgClosure *static_objects);
+struct gc_thread_;
+
+// See Note [Searching for references to unloaded code] in CheckUnload.c
+void prepareUnloadCheck   (rtsBool major_gc);
+void markUnloadReferences (struct gc_thread_ *me);
+#ifdef THREADED_RTS
+void checkUnloadWorker    (struct gc_thread_ *me);
+#endif
+void checkUnload          (void);
 
 #include "EndPrivate.h"
 
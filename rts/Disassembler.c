@@ -244,6 +244,19 @@ disInstr ( StgBCO *bco, int pc )
       case bci_ENTER:
          debugBelch("ENTER\n");
          break;
+      case bci_PUSH_L_ENTER:
+         debugBelch("PUSH_L_ENTER %d\n", instrs[pc] );
+         pc += 1; break;
+      case bci_PUSH_G_ENTER:
+         debugBelch("PUSH_G_ENTER " ); printPtr( ptrs[BCO_GET_LARGE_ARG] );
+         debugBelch("\n" );
+         break;
+      case bci_SLIDE_ENTER:
+         debugBelch("SLIDE_ENTER %d down by %d\n", instrs[pc], instrs[pc+1] );
+         pc += 2; break;
+      case bci_PUSH_APPLY_PTRS_L:
+         debugBelch("PUSH_APPLY_PTRS_L %d %d\n", instrs[pc], instrs[pc+1] );
+         pc += 2; break;
 
       case bci_RETURN:
          debugBelch("RETURN\n" );
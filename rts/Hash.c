@@ -428,3 +428,277 @@ int keyCountHashTable (HashTable *table)
 {
     return table->kcount;
 }
+
+/* -----------------------------------------------------------------------------
+ * Open-addressing hash tables
+ *
+ * Note [Open-addressing hash tables]
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A HashTable keyed by strings is slow when it gets big: every lookup
+ * hashes the key a byte at a time, follows a chain of HashList cells
+ * scattered over the heap, and calls strcmp() on each of them.  The
+ * linker's symbol table has hundreds of thousands of entries in a
+ * large GHCi session, so this shows up in startup time.
+ *
+ * An OpenHashTable keeps its entries in a single array, whose size is
+ * a power of two, and resolves collisions by linear probing.  Each
+ * entry records the full hash of its key, so a probe only calls the
+ * comparison function when the hashes match, and growing the table
+ * doesn't need to hash the keys again.  An entry whose hash is zero is
+ * empty; a key that hashes to zero is stored with hash 1 instead.
+ *
+ * Removal shifts the following entries of the cluster back rather than
+ * leaving a tombstone, so lookups never probe further than necessary.
+ *
+ * Like a HashTable, an OpenHashTable may hold the same key more than
+ * once, and lookupOpenHashTable() returns the most recently inserted
+ * one.  insertOpenHashTable() keeps equal keys in the order newest
+ * first by swapping the new entry with each equal one it passes on its
+ * way to an empty slot.
+ *
+ * hashStrWords() hashes a string a word at a time (with hashBytes()).
+ * The string is measured with strlen() first, so that we never read
+ * past its end, and the words are read with memcpy(), so that the hash
+ * doesn't depend on the alignment of the string.
+ * -------------------------------------------------------------------------- */
+
+#define OHMINSIZE   64      /* Initial size of an OpenHashTable */
+
+typedef struct {
+    StgWord hash;           /* 0 if the entry is empty */
+    StgWord key;
+    const void *data;
+} OpenHashEntry;
+
+struct openhashtable {
+    OpenHashEntry *entries;
+    StgWord mask;           /* number of entries - 1 */
+    int kcount;             /* Number of keys */
+    OpenHashFunction *hash;
+    CompareFunction *compare;
+};
+
+#if SIZEOF_VOID_P == 8
+#define HASH_MULTIPLIER 0x9e3779b97f4a7c15
+#else
+#define HASH_MULTIPLIER 0x9e3779b9
+#endif
+
+#define ROTL(x,n) ((x) << (n) | (x) >> (sizeof(StgWord) * 8 - (n)))
+
+StgWord
+hashStrWords(const char *key)
+{
+    return hashBytes(key, strlen(key));
+}
+
+StgWord
+hashBytes(const void *p, size_t len)
+{
+    const char *s = p, *end = s + len;
+    StgWord h = len, w;
+
+    for (; s + sizeof(StgWord) <= end; s += sizeof(StgWord)) {
+        memcpy(&w, s, sizeof(StgWord));
+        h = (ROTL(h, 5) ^ w) * HASH_MULTIPLIER;
+    }
+    if (s < end) {
+        w = 0;
+        memcpy(&w, s, end - s);
+        h = (ROTL(h, 5) ^ w) * HASH_MULTIPLIER;
+    }
+
+    /* Mix the high bits, which the multiplications have affected most,
+       into the low bits, which choose the slot */
+    h ^= h >> (sizeof(StgWord) * 4);
+    h *= HASH_MULTIPLIER;
+    h ^= h >> (sizeof(StgWord) * 4);
+    return h;
+}
+
+static StgWord
+openHash(const OpenHashTable *table, StgWord key)
+{
+    StgWord h = table->hash(key);
+    return h == 0 ? 1 : h;
+}
+
+static void
+growOpenHashTable(OpenHashTable *table)
+{
+    OpenHashEntry *old = table->entries, *e;
+    StgWord start, n, i, j, oldsize = table->mask + 1;
+
+    table->mask = 2 * oldsize - 1;
+    table->entries = stgCallocBytes(2 * oldsize, sizeof(OpenHashEntry),
+                                    "growOpenHashTable");
+
+    /* Equal keys must keep their order, so we move each cluster in probe
+       order, starting after an empty entry in case one wraps around the
+       end of the array.  There is always an empty entry, since the load
+       is below 3/4. */
+    for (start = 0; old[start].hash != 0; start++);
+
+    for (n = 1; n <= oldsize; n++) {
+        i = (start + n) & (oldsize - 1);
+        if (old[i].hash == 0) continue;
+        for (j = old[i].hash & table->mask; ; j = (j + 1) & table->mask) {
+            e = &table->entries[j];
+            if (e->hash == 0) {
+                *e = old[i];
+                break;
+            }
+        }
+    }
+
+    stgFree(old);
+}
+
+void *
+lookupOpenHashTable(const OpenHashTable *table, StgWord key)
+{
+    StgWord h, i;
+    const OpenHashEntry *e;
+
+    h = openHash(table, key);
+    for (i = h & table->mask; ; i = (i + 1) & table->mask) {
+        e = &table->entries[i];
+        if (e->hash == 0) {
+            return NULL;
+        }
+        if (e->hash == h && table->compare(e->key, key)) {
+            return (void *) e->data;
+        }
+    }
+}
+
+void
+insertOpenHashTable(OpenHashTable *table, StgWord key, const void *data)
+{
+    OpenHashEntry new, tmp, *e;
+    StgWord i;
+
+    /* Keep the load below 3/4 */
+    if (4 * (StgWord)(table->kcount + 1) > 3 * (table->mask + 1)) {
+        growOpenHashTable(table);
+    }
+    table->kcount++;
+
+    new.hash = openHash(table, key);
+    new.key  = key;
+    new.data = data;
+
+    for (i = new.hash & table->mask; ; i = (i + 1) & table->mask) {
+        e = &table->entries[i];
+        if (e->hash == 0) {
+            *e = new;
+            return;
+        }
+        /* newest first: see Note [Open-addressing hash tables] */
+        if (e->hash == new.hash && table->compare(e->key, key)) {
+            tmp = *e;
+            *e = new;
+            new = tmp;
+        }
+    }
+}
+
+void *
+removeOpenHashTable(OpenHashTable *table, StgWord key, const void *data)
+{
+    StgWord h, i, j, home;
+    OpenHashEntry *e;
+    const void *found;
+
+    h = openHash(table, key);
+    for (i = h & table->mask; ; i = (i + 1) & table->mask) {
+        e = &table->entries[i];
+        if (e->hash == 0) {
+            /* It's not there */
+            ASSERT(data == NULL);
+            return NULL;
+        }
+        if (e->hash == h && table->compare(e->key, key)
+            && (data == NULL || e->data == data)) {
+            break;
+        }
+    }
+
+    found = table->entries[i].data;
+    table->kcount--;
+
+    /* Shift back the rest of the cluster, except for the entries whose
+       home slot lies after the hole */
+    for (j = (i + 1) & table->mask;
+         table->entries[j].hash != 0;
+         j = (j + 1) & table->mask) {
+        home = table->entries[j].hash & table->mask;
+        if (((j - home) & table->mask) >= ((j - i) & table->mask)) {
+            table->entries[i] = table->entries[j];
+            i = j;
+        }
+    }
+    table->entries[i].hash = 0;
+
+    return (void *) found;
+}
+
+int
+keysOpenHashTable(OpenHashTable *table, StgWord keys[], int szKeys)
+{
+    StgWord i;
+    int k = 0;
+
+    for (i = 0; i <= table->mask && k < szKeys; i++) {
+        if (table->entries[i].hash != 0) {
+            keys[k++] = table->entries[i].key;
+        }
+    }
+    return k;
+}
+
+int
+keyCountOpenHashTable(OpenHashTable *table)
+{
+    return table->kcount;
+}
+
+void
+freeOpenHashTable(OpenHashTable *table, void (*freeDataFun)(void *))
+{
+    StgWord i;
+
+    if (freeDataFun != NULL) {
+        for (i = 0; i <= table->mask; i++) {
+            if (table->entries[i].hash != 0) {
+                (*freeDataFun)((void *) table->entries[i].data);
+            }
+        }
+    }
+    stgFree(table->entries);
+    stgFree(table);
+}
+
+OpenHashTable *
+allocOpenHashTable(OpenHashFunction *hash, CompareFunction *compare)
+{
+    OpenHashTable *table;
+
+    table = stgMallocBytes(sizeof(OpenHashTable), "allocOpenHashTable");
+    table->entries = stgCallocBytes(OHMINSIZE, sizeof(OpenHashEntry),
+                                    "allocOpenHashTable");
+    table->mask = OHMINSIZE - 1;
+    table->kcount = 0;
+    table->hash = hash;
+    table->compare = compare;
+
+    return table;
+}
+
+OpenHashTable *
+allocStrOpenHashTable(void)
+{
+    return allocOpenHashTable((OpenHashFunction *)hashStrWords,
+                              (CompareFunction *)compareStr);
+}
@@ -59,6 +59,45 @@ int hashStr(const HashTable *table, char *key);
  */
 void freeHashTable ( HashTable *table, void (*freeDataFun)(void *) );
 
+/* Open-addressing hash tables, which keep the full hash of each key
+ * alongside it (see Note [Open-addressing hash tables] in Hash.c).
+ * They have the same interface as HashTable, but the hash function
+ * returns a full-width hash instead of a bucket number.  Better for
+ * large tables whose keys are expensive to hash and compare, such as
+ * strings.
+ */
+typedef struct openhashtable OpenHashTable; /* abstract */
+
+typedef StgWord OpenHashFunction(StgWord key);
+
+OpenHashTable * allocOpenHashTable ( OpenHashFunction *hash,
+                                     CompareFunction *compare );
+void   insertOpenHashTable ( OpenHashTable *table, StgWord key,
+                             const void *data );
+void * lookupOpenHashTable ( const OpenHashTable *table, StgWord key );
+void * removeOpenHashTable ( OpenHashTable *table, StgWord key,
+                             const void *data );
+int    keyCountOpenHashTable ( OpenHashTable *table );
+int    keysOpenHashTable ( OpenHashTable *table, StgWord keys[], int szKeys );
+void   freeOpenHashTable ( OpenHashTable *table,
+                           void (*freeDataFun)(void *) );
+
+/* Open-addressing tables keyed by C strings, with the same caveats as
+ * allocStrHashTable().
+ */
+OpenHashTable * allocStrOpenHashTable ( void );
+StgWord hashStrWords ( const char *key );
+StgWord hashBytes ( const void *p, size_t len );
+
+#define lookupStrOpenHashTable(table, key)  \
+   (lookupOpenHashTable(table, (StgWord)key))
+
+#define insertStrOpenHashTable(table, key, data)  \
+   (insertOpenHashTable(table, (StgWord)key, data))
+
+#define removeStrOpenHashTable(table, key, data) \
+   (removeOpenHashTable(table, (StgWord)key, data))
+
 void exitHashTable ( void );
 
 #include "EndPrivate.h"
@@ -26,6 +26,10 @@
 #include <unistd.h>
 #endif
 
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
 
 /* This is the runtime support for the Haskell Program Coverage (hpc) toolkit,
  * inside GHC.
@@ -43,6 +47,45 @@ static HashTable * moduleHash = NULL;   // module name -> HpcModuleInfo
 HpcModuleInfo *modules = 0;
 
 static char *tixFilename = NULL;
+static rtsBool tixBinary = rtsFalse;    // write a binary .tix file at exit
+
+/* Note [Binary .tix files]
+   ~~~~~~~~~~~~~~~~~~~~~~~~
+   Reading and writing the textual .tix format a character at a time
+   takes seconds when there are millions of tick boxes.  So the RTS can
+   also use a binary format, which it reads by mapping the file and
+   copying each module's tick array in one go, and writes with one
+   fwrite() per module.  Aggregating runs is cheap either way: like the
+   textual format, the counts in the .tix file we read at startup carry
+   on being incremented, and the totals are written at exit.
+
+   The format is selected by HPCTIXFORMAT=text or HPCTIXFORMAT=binary.
+   If that isn't set, we write the .tix file in the format we read it
+   in, or as text if there wasn't one.  The hpc tool reads both formats.
+
+   The file is in the byte order of the machine that wrote it:
+
+     header:  "HPCTIX01"                 8 bytes
+              TIX_BYTE_ORDER             StgWord32
+              number of modules          StgWord32
+
+   followed by, for each module:
+
+              hash                       StgWord32
+              number of tick boxes (n)   StgWord32
+              length of the name         StgWord32
+              0                          StgWord32
+              the name                   padded with 0s to 8-byte multiple
+              tick counts                StgWord64[n]
+
+   We can't map the file as the live counters themselves: the code
+   generator increments the tick boxes of a module in a static array
+   that belongs to the module (see hs_hpc_module()).
+*/
+
+#define TIX_MAGIC       "HPCTIX01"
+#define TIX_MAGIC_LEN   8
+#define TIX_BYTE_ORDER  0x01020304
 
 static void GNU_ATTRIBUTE(__noreturn__)
 failure(char *msg) {
@@ -103,11 +146,49 @@ static StgWord64 expectWord64(void) {
   return tmp;
 }
 
+/* Add a module read from the .tix file, with its own modName and
+ * tixArr.  If the module has been registered already, its tick counts
+ * are copied into the real tixArr and tmpModule is freed.
+ */
+static void
+addTixModule(HpcModuleInfo *tmpModule) {
+  const HpcModuleInfo *lookup;
+  unsigned int i;
+
+  lookup = lookupHashTable(moduleHash, (StgWord)tmpModule->modName);
+  if (lookup == NULL) {
+      debugTrace(DEBUG_hpc,"readTix: new HpcModuleInfo for %s",
+                 tmpModule->modName);
+      insertHashTable(moduleHash, (StgWord)tmpModule->modName, tmpModule);
+  } else {
+      ASSERT(lookup->tixArr != 0);
+      ASSERT(!strcmp(tmpModule->modName, lookup->modName));
+      debugTrace(DEBUG_hpc,"readTix: existing HpcModuleInfo for %s",
+                 tmpModule->modName);
+      if (tmpModule->hashNo != lookup->hashNo) {
+          fprintf(stderr,"in module '%s'\n",tmpModule->modName);
+          failure("module mismatch with .tix/.mix file hash number");
+          if (tixFilename != NULL) {
+              fprintf(stderr,"(perhaps remove %s ?)\n",tixFilename);
+          }
+          stg_exit(EXIT_FAILURE);
+      }
+      if (tmpModule->tickCount != lookup->tickCount) {
+          failure("inconsistent number of tick boxes");
+      }
+      for (i=0; i < tmpModule->tickCount; i++) {
+          lookup->tixArr[i] = tmpModule->tixArr[i];
+      }
+      stgFree(tmpModule->tixArr);
+      stgFree(tmpModule->modName);
+      stgFree(tmpModule);
+  }
+}
+
 static void
 readTix(void) {
   unsigned int i;
   HpcModuleInfo *tmpModule;
-  const HpcModuleInfo *lookup;
 
   ws();
   expect('T');
@@ -151,31 +232,7 @@ readTix(void) {
     expect(']');
     ws();
 
-    lookup = lookupHashTable(moduleHash, (StgWord)tmpModule->modName);
-    if (lookup == NULL) {
-        debugTrace(DEBUG_hpc,"readTix: new HpcModuleInfo for %s",
-                   tmpModule->modName);
-        insertHashTable(moduleHash, (StgWord)tmpModule->modName, tmpModule);
-    } else {
-        ASSERT(lookup->tixArr != 0);
-        ASSERT(!strcmp(tmpModule->modName, lookup->modName));
-        debugTrace(DEBUG_hpc,"readTix: existing HpcModuleInfo for %s",
-                   tmpModule->modName);
-        if (tmpModule->hashNo != lookup->hashNo) {
-            fprintf(stderr,"in module '%s'\n",tmpModule->modName);
-            failure("module mismatch with .tix/.mix file hash number");
-            if (tixFilename != NULL) {
-                fprintf(stderr,"(perhaps remove %s ?)\n",tixFilename);
-            }
-            stg_exit(EXIT_FAILURE);
-        }
-        for (i=0; i < tmpModule->tickCount; i++) {
-            lookup->tixArr[i] = tmpModule->tixArr[i];
-        }
-        stgFree(tmpModule->tixArr);
-        stgFree(tmpModule->modName);
-        stgFree(tmpModule);
-    }
+    addTixModule(tmpModule);
 
     if (tix_ch == ',') {
       expect(',');
@@ -186,11 +243,96 @@ readTix(void) {
   fclose(tixFile);
 }
 
+static rtsBool
+isBinaryTix(FILE *f) {
+  char magic[TIX_MAGIC_LEN];
+
+  return fread(magic, 1, TIX_MAGIC_LEN, f) == TIX_MAGIC_LEN &&
+         memcmp(magic, TIX_MAGIC, TIX_MAGIC_LEN) == 0;
+}
+
+/* Read a binary .tix file (Note [Binary .tix files]) */
+static void
+readBinaryTix(FILE *f) {
+  StgWord8 *buf;
+  size_t size, off, name_len, name_size, ticks_size;
+  StgWord32 hdr[4], n_modules, i;
+  HpcModuleInfo *tmpModule;
+
+  if (fseek(f, 0, SEEK_END) != 0) {
+    failure("can't read .tix file");
+  }
+  size = (size_t)ftell(f);
+  if (size < TIX_MAGIC_LEN + 2 * sizeof(StgWord32)) {
+    failure("truncated .tix file");
+  }
+
+#ifdef HAVE_SYS_MMAN_H
+  buf = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+  if (buf == MAP_FAILED) {
+    failure("can't map .tix file");
+  }
+#else
+  buf = stgMallocBytes(size, "Hpc.readBinaryTix");
+  rewind(f);
+  if (fread(buf, 1, size, f) != size) {
+    failure("can't read .tix file");
+  }
+#endif
+
+  memcpy(hdr, buf + TIX_MAGIC_LEN, 2 * sizeof(StgWord32));
+  if (hdr[0] != TIX_BYTE_ORDER) {
+    failure(".tix file was written on a machine with a different byte order");
+  }
+  n_modules = hdr[1];
+
+  off = TIX_MAGIC_LEN + 2 * sizeof(StgWord32);
+  for (i = 0; i < n_modules; i++) {
+    if (size - off < sizeof(hdr)) {
+      failure("truncated .tix file");
+    }
+    memcpy(hdr, buf + off, sizeof(hdr));
+    off += sizeof(hdr);
+
+    name_len = hdr[2];
+    name_size = (name_len + 7) & ~(size_t)7;
+    ticks_size = (size_t)hdr[1] * sizeof(StgWord64);
+    if (size - off < name_size + ticks_size) {
+      failure("truncated .tix file");
+    }
+
+    tmpModule = (HpcModuleInfo *)stgMallocBytes(sizeof(HpcModuleInfo),
+                                                "Hpc.readBinaryTix");
+    tmpModule->from_file = rtsTrue;
+    tmpModule->hashNo = hdr[0];
+    tmpModule->tickCount = hdr[1];
+    tmpModule->modName = stgMallocBytes(name_len + 1, "Hpc.readBinaryTix");
+    memcpy(tmpModule->modName, buf + off, name_len);
+    tmpModule->modName[name_len] = '\0';
+    off += name_size;
+
+    tmpModule->tixArr = (StgWord64 *)calloc(tmpModule->tickCount,sizeof(StgWord64));
+    memcpy(tmpModule->tixArr, buf + off, ticks_size);
+    off += ticks_size;
+
+    addTixModule(tmpModule);
+  }
+
+#ifdef HAVE_SYS_MMAN_H
+  munmap(buf, size);
+#else
+  stgFree(buf);
+#endif
+  fclose(f);
+}
+
 void
 startupHpc(void)
 {
   char *hpc_tixdir;
   char *hpc_tixfile;
+  char *hpc_tixformat;
+  FILE *f;
 
   if (moduleHash == NULL) {
       // no modules were registered with hs_hpc_module, so don't bother
@@ -233,8 +375,30 @@ startupHpc(void)
     sprintf(tixFilename, "%s.tix", prog_name);
   }
 
-  if (init_open(fopen(tixFilename,"r"))) {
-    readTix();
+  hpc_tixformat = getenv("HPCTIXFORMAT");
+
+  f = fopen(tixFilename,"rb");
+  if (f != NULL) {
+    if (isBinaryTix(f)) {
+      readBinaryTix(f);
+      tixBinary = rtsTrue;
+    } else {
+      fclose(f);
+      if (init_open(fopen(tixFilename,"r"))) {
+        readTix();
+      }
+    }
+  }
+
+  if (hpc_tixformat != NULL) {
+    if (strcmp(hpc_tixformat, "binary") == 0) {
+      tixBinary = rtsTrue;
+    } else if (strcmp(hpc_tixformat, "text") == 0) {
+      tixBinary = rtsFalse;
+    } else {
+      errorBelch("HPCTIXFORMAT should be text or binary, not %s",
+                 hpc_tixformat);
+    }
   }
 }
 
@@ -361,6 +525,54 @@ writeTix(FILE *f) {
   fclose(f);
 }
 
+/* Write a binary .tix file (Note [Binary .tix files]) */
+static void
+writeBinaryTix(FILE *f) {
+  HpcModuleInfo *tmpModule;
+  StgWord32 hdr[4];
+  StgWord64 zero = 0;
+  size_t name_len;
+  unsigned int i;
+
+  if (f == 0) {
+    return;
+  }
+
+  hdr[0] = TIX_BYTE_ORDER;
+  hdr[1] = 0;
+  for (tmpModule = modules; tmpModule != 0; tmpModule = tmpModule->next) {
+    hdr[1]++;
+  }
+  fwrite(TIX_MAGIC, 1, TIX_MAGIC_LEN, f);
+  fwrite(hdr, sizeof(StgWord32), 2, f);
+
+  for (tmpModule = modules; tmpModule != 0; tmpModule = tmpModule->next) {
+    name_len = strlen(tmpModule->modName);
+    hdr[0] = tmpModule->hashNo;
+    hdr[1] = tmpModule->tickCount;
+    hdr[2] = (StgWord32)name_len;
+    hdr[3] = 0;
+    debugTrace(DEBUG_hpc,"%s: %u (hash=%u)\n",
+               tmpModule->modName,
+               (uint32_t)tmpModule->tickCount,
+               (uint32_t)tmpModule->hashNo);
+
+    fwrite(hdr, sizeof(StgWord32), 4, f);
+    fwrite(tmpModule->modName, 1, name_len, f);
+    fwrite(&zero, 1, ((name_len + 7) & ~(size_t)7) - name_len, f);
+
+    if (tmpModule->tixArr) {
+      fwrite(tmpModule->tixArr, sizeof(StgWord64), tmpModule->tickCount, f);
+    } else {
+      for (i = 0; i < tmpModule->tickCount; i++) {
+        fwrite(&zero, sizeof(StgWord64), 1, f);
+      }
+    }
+  }
+
+  fclose(f);
+}
+
 static void
 freeHpcModuleInfo (HpcModuleInfo *mod)
 {
@@ -387,8 +599,11 @@ exitHpc(void) {
   // not clober the .tix file.
 
   if (hpc_pid == getpid()) {
-    FILE *f = fopen(tixFilename,"w");
-    writeTix(f);
+    if (tixBinary) {
+      writeBinaryTix(fopen(tixFilename,"wb"));
+    } else {
+      writeTix(fopen(tixFilename,"w"));
+    }
   }
 
   freeHashTable(moduleHash, (void (*)(void *))freeHpcModuleInfo);
@@ -75,6 +75,37 @@
 #define BCO_PTR(n)    (W_)ptrs[n]
 #define BCO_LIT(n)    literals[n]
 
+/* Note [Threaded dispatch]
+   ~~~~~~~~~~~~~~~~~~~~~~~~
+   Compilers that support GCC's "labels as values" extension let us
+   jump from the end of each instruction straight to the code for the
+   next one, through dispatch_table, instead of going back to the top
+   of the switch (NEXT_INSN).  Each instruction then ends in its own
+   indirect jump, which the branch predictor can learn separately,
+   rather than all instructions sharing the switch's single jump; and
+   the range check of the switch goes away too.
+
+   Each instruction's code is labelled with INSTR(op), which is both its
+   case label and the label its dispatch_table entry points to.  DEBUG
+   and INTERP_STATS builds keep using the switch, so that every
+   instruction goes through nextInsn, where they trace and count it.
+
+   See also Note [Superinstructions] in ByteCodeAsm, which cuts down the
+   number of instructions we dispatch in the first place.
+*/
+#if defined(__GNUC__) && !defined(DEBUG) && !defined(INTERP_STATS)
+#define THREADED_DISPATCH 1
+#endif
+
+#if defined(THREADED_DISPATCH)
+#define INSTR(op)   case op: lbl_##op
+#define NEXT_INSN   do { bci = BCO_NEXT;                                \
+                         goto *dispatch_table[bci & 0xFF]; } while (0)
+#else
+#define INSTR(op)   case op
+#define NEXT_INSN   goto nextInsn
+#endif
+
 #define LOAD_STACK_POINTERS                                     \
     Sp = cap->r.rCurrentTSO->stackobj->sp;                      \
     /* We don't change this ... */                              \
@@ -236,6 +267,76 @@ interpretBCO (Capability* cap)
     register StgClosure   *tagged_obj = 0, *obj;
     uint32_t n, m;
 
+#if defined(THREADED_DISPATCH)
+    // See Note [Threaded dispatch].  The bytecode comes from our own
+    // assembler, so every opcode we meet is in the table.
+    static const void *const dispatch_table[256] = {
+        // the opcodes we don't use, which the switch sends to default:
+        [0]                          = &&lbl_bad_opcode,
+        [25]                         = &&lbl_bad_opcode,
+        [bci_PUSH_APPLY_PTRS_L + 1 ... 255] = &&lbl_bad_opcode,
+        [bci_BRK_FUN]                = &&lbl_bci_BRK_FUN,
+        [bci_STKCHECK]               = &&lbl_bci_STKCHECK,
+        [bci_PUSH_L]                 = &&lbl_bci_PUSH_L,
+        [bci_PUSH_LL]                = &&lbl_bci_PUSH_LL,
+        [bci_PUSH_LLL]               = &&lbl_bci_PUSH_LLL,
+        [bci_PUSH_G]                 = &&lbl_bci_PUSH_G,
+        [bci_PUSH_ALTS]              = &&lbl_bci_PUSH_ALTS,
+        [bci_PUSH_ALTS_P]            = &&lbl_bci_PUSH_ALTS_P,
+        [bci_PUSH_ALTS_N]            = &&lbl_bci_PUSH_ALTS_N,
+        [bci_PUSH_ALTS_F]            = &&lbl_bci_PUSH_ALTS_F,
+        [bci_PUSH_ALTS_D]            = &&lbl_bci_PUSH_ALTS_D,
+        [bci_PUSH_ALTS_L]            = &&lbl_bci_PUSH_ALTS_L,
+        [bci_PUSH_ALTS_V]            = &&lbl_bci_PUSH_ALTS_V,
+        [bci_PUSH_APPLY_N]           = &&lbl_bci_PUSH_APPLY_N,
+        [bci_PUSH_APPLY_V]           = &&lbl_bci_PUSH_APPLY_V,
+        [bci_PUSH_APPLY_F]           = &&lbl_bci_PUSH_APPLY_F,
+        [bci_PUSH_APPLY_D]           = &&lbl_bci_PUSH_APPLY_D,
+        [bci_PUSH_APPLY_L]           = &&lbl_bci_PUSH_APPLY_L,
+        [bci_PUSH_APPLY_P]           = &&lbl_bci_PUSH_APPLY_P,
+        [bci_PUSH_APPLY_PP]          = &&lbl_bci_PUSH_APPLY_PP,
+        [bci_PUSH_APPLY_PPP]         = &&lbl_bci_PUSH_APPLY_PPP,
+        [bci_PUSH_APPLY_PPPP]        = &&lbl_bci_PUSH_APPLY_PPPP,
+        [bci_PUSH_APPLY_PPPPP]       = &&lbl_bci_PUSH_APPLY_PPPPP,
+        [bci_PUSH_APPLY_PPPPPP]      = &&lbl_bci_PUSH_APPLY_PPPPPP,
+        [bci_PUSH_UBX]               = &&lbl_bci_PUSH_UBX,
+        [bci_SLIDE]                  = &&lbl_bci_SLIDE,
+        [bci_PUSH_L_ENTER]           = &&lbl_bci_PUSH_L_ENTER,
+        [bci_PUSH_G_ENTER]           = &&lbl_bci_PUSH_G_ENTER,
+        [bci_SLIDE_ENTER]            = &&lbl_bci_SLIDE_ENTER,
+        [bci_PUSH_APPLY_PTRS_L]      = &&lbl_bci_PUSH_APPLY_PTRS_L,
+        [bci_ALLOC_AP]               = &&lbl_bci_ALLOC_AP,
+        [bci_ALLOC_AP_NOUPD]         = &&lbl_bci_ALLOC_AP_NOUPD,
+        [bci_ALLOC_PAP]              = &&lbl_bci_ALLOC_PAP,
+        [bci_MKAP]                   = &&lbl_bci_MKAP,
+        [bci_MKPAP]                  = &&lbl_bci_MKPAP,
+        [bci_UNPACK]                 = &&lbl_bci_UNPACK,
+        [bci_PACK]                   = &&lbl_bci_PACK,
+        [bci_TESTLT_P]               = &&lbl_bci_TESTLT_P,
+        [bci_TESTEQ_P]               = &&lbl_bci_TESTEQ_P,
+        [bci_TESTLT_I]               = &&lbl_bci_TESTLT_I,
+        [bci_TESTEQ_I]               = &&lbl_bci_TESTEQ_I,
+        [bci_TESTLT_W]               = &&lbl_bci_TESTLT_W,
+        [bci_TESTEQ_W]               = &&lbl_bci_TESTEQ_W,
+        [bci_TESTLT_D]               = &&lbl_bci_TESTLT_D,
+        [bci_TESTEQ_D]               = &&lbl_bci_TESTEQ_D,
+        [bci_TESTLT_F]               = &&lbl_bci_TESTLT_F,
+        [bci_TESTEQ_F]               = &&lbl_bci_TESTEQ_F,
+        [bci_ENTER]                  = &&lbl_bci_ENTER,
+        [bci_RETURN]                 = &&lbl_bci_RETURN,
+        [bci_RETURN_P]               = &&lbl_bci_RETURN_P,
+        [bci_RETURN_N]               = &&lbl_bci_RETURN_N,
+        [bci_RETURN_F]               = &&lbl_bci_RETURN_F,
+        [bci_RETURN_D]               = &&lbl_bci_RETURN_D,
+        [bci_RETURN_L]               = &&lbl_bci_RETURN_L,
+        [bci_RETURN_V]               = &&lbl_bci_RETURN_V,
+        [bci_SWIZZLE]                = &&lbl_bci_SWIZZLE,
+        [bci_CCALL]                  = &&lbl_bci_CCALL,
+        [bci_JMP]                    = &&lbl_bci_JMP,
+        [bci_CASEFAIL]               = &&lbl_bci_CASEFAIL,
+    };
+#endif
+
     LOAD_THREAD_STATE();
 
     cap->r.rHpLim = (P_)1; // HpLim is the context-switch flag; when it
@@ -887,7 +988,9 @@ run_BCO:
         it_lastopc = 0; /* no opcode */
 #endif
 
+#if !defined(THREADED_DISPATCH)
     nextInsn:
+#endif
         ASSERT(bciPtr < bcoSize);
         IF_DEBUG(interpreter,
                  //if (do_print_stack) {
@@ -922,10 +1025,14 @@ run_BCO:
      * currently allocated */
     ASSERT((bci & 0xFF00) == (bci & 0x8000));
 
+#if defined(THREADED_DISPATCH)
+    goto *dispatch_table[bci & 0xFF];
+#endif
+
     switch (bci & 0xFF) {
 
         /* check for a breakpoint on the beginning of a let binding */
-        case bci_BRK_FUN:
+        INSTR(bci_BRK_FUN):
         {
             int arg1_brk_array, arg2_array_index, arg3_module_uniq;
 #ifdef PROFILING
@@ -1042,10 +1149,10 @@ run_BCO:
             cap->r.rCurrentTSO->flags &= ~TSO_STOPPED_ON_BREAKPOINT;
 
             // continue normal execution of the byte code instructions
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_STKCHECK: {
+        INSTR(bci_STKCHECK): {
             // Explicit stack check at the beginning of a function
             // *only* (stack checks in case alternatives are
             // propagated to the enclosing function).
@@ -1056,27 +1163,27 @@ run_BCO:
                 Sp[0] = (W_)&stg_apply_interp_info;
                 RETURN_TO_SCHEDULER(ThreadInterpret, StackOverflow);
             } else {
-                goto nextInsn;
+                NEXT_INSN;
             }
         }
 
-        case bci_PUSH_L: {
+        INSTR(bci_PUSH_L): {
             int o1 = BCO_NEXT;
             Sp[-1] = Sp[o1];
             Sp--;
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_PUSH_LL: {
+        INSTR(bci_PUSH_LL): {
             int o1 = BCO_NEXT;
             int o2 = BCO_NEXT;
             Sp[-1] = Sp[o1];
             Sp[-2] = Sp[o2];
             Sp -= 2;
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_PUSH_LLL: {
+        INSTR(bci_PUSH_LLL): {
             int o1 = BCO_NEXT;
             int o2 = BCO_NEXT;
             int o3 = BCO_NEXT;
@@ -1084,17 +1191,17 @@ run_BCO:
             Sp[-2] = Sp[o2];
             Sp[-3] = Sp[o3];
             Sp -= 3;
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_PUSH_G: {
+        INSTR(bci_PUSH_G): {
             int o1 = BCO_GET_LARGE_ARG;
             Sp[-1] = BCO_PTR(o1);
             Sp -= 1;
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_PUSH_ALTS: {
+        INSTR(bci_PUSH_ALTS): {
             int o_bco  = BCO_GET_LARGE_ARG;
             Sp -= 2;
             Sp[1] = BCO_PTR(o_bco);
@@ -1104,10 +1211,10 @@ run_BCO:
             Sp[1] = (W_)cap->r.rCCCS;
             Sp[0] = (W_)&stg_restore_cccs_info;
 #endif
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_PUSH_ALTS_P: {
+        INSTR(bci_PUSH_ALTS_P): {
             int o_bco  = BCO_GET_LARGE_ARG;
             Sp[-2] = (W_)&stg_ctoi_R1unpt_info;
             Sp[-1] = BCO_PTR(o_bco);
@@ -1117,10 +1224,10 @@ run_BCO:
             Sp[1] = (W_)cap->r.rCCCS;
             Sp[0] = (W_)&stg_restore_cccs_info;
 #endif
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_PUSH_ALTS_N: {
+        INSTR(bci_PUSH_ALTS_N): {
             int o_bco  = BCO_GET_LARGE_ARG;
             Sp[-2] = (W_)&stg_ctoi_R1n_info;
             Sp[-1] = BCO_PTR(o_bco);
@@ -1130,10 +1237,10 @@ run_BCO:
             Sp[1] = (W_)cap->r.rCCCS;
             Sp[0] = (W_)&stg_restore_cccs_info;
 #endif
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_PUSH_ALTS_F: {
+        INSTR(bci_PUSH_ALTS_F): {
             int o_bco  = BCO_GET_LARGE_ARG;
             Sp[-2] = (W_)&stg_ctoi_F1_info;
             Sp[-1] = BCO_PTR(o_bco);
@@ -1143,10 +1250,10 @@ run_BCO:
             Sp[1] = (W_)cap->r.rCCCS;
             Sp[0] = (W_)&stg_restore_cccs_info;
 #endif
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_PUSH_ALTS_D: {
+        INSTR(bci_PUSH_ALTS_D): {
             int o_bco  = BCO_GET_LARGE_ARG;
             Sp[-2] = (W_)&stg_ctoi_D1_info;
             Sp[-1] = BCO_PTR(o_bco);
@@ -1156,10 +1263,10 @@ run_BCO:
             Sp[1] = (W_)cap->r.rCCCS;
             Sp[0] = (W_)&stg_restore_cccs_info;
 #endif
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_PUSH_ALTS_L: {
+        INSTR(bci_PUSH_ALTS_L): {
             int o_bco  = BCO_GET_LARGE_ARG;
             Sp[-2] = (W_)&stg_ctoi_L1_info;
             Sp[-1] = BCO_PTR(o_bco);
@@ -1169,10 +1276,10 @@ run_BCO:
             Sp[1] = (W_)cap->r.rCCCS;
             Sp[0] = (W_)&stg_restore_cccs_info;
 #endif
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_PUSH_ALTS_V: {
+        INSTR(bci_PUSH_ALTS_V): {
             int o_bco  = BCO_GET_LARGE_ARG;
             Sp[-2] = (W_)&stg_ctoi_V_info;
             Sp[-1] = BCO_PTR(o_bco);
@@ -1182,44 +1289,44 @@ run_BCO:
             Sp[1] = (W_)cap->r.rCCCS;
             Sp[0] = (W_)&stg_restore_cccs_info;
 #endif
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_PUSH_APPLY_N:
+        INSTR(bci_PUSH_APPLY_N):
             Sp--; Sp[0] = (W_)&stg_ap_n_info;
-            goto nextInsn;
-        case bci_PUSH_APPLY_V:
+            NEXT_INSN;
+        INSTR(bci_PUSH_APPLY_V):
             Sp--; Sp[0] = (W_)&stg_ap_v_info;
-            goto nextInsn;
-        case bci_PUSH_APPLY_F:
+            NEXT_INSN;
+        INSTR(bci_PUSH_APPLY_F):
             Sp--; Sp[0] = (W_)&stg_ap_f_info;
-            goto nextInsn;
-        case bci_PUSH_APPLY_D:
+            NEXT_INSN;
+        INSTR(bci_PUSH_APPLY_D):
             Sp--; Sp[0] = (W_)&stg_ap_d_info;
-            goto nextInsn;
-        case bci_PUSH_APPLY_L:
+            NEXT_INSN;
+        INSTR(bci_PUSH_APPLY_L):
             Sp--; Sp[0] = (W_)&stg_ap_l_info;
-            goto nextInsn;
-        case bci_PUSH_APPLY_P:
+            NEXT_INSN;
+        INSTR(bci_PUSH_APPLY_P):
             Sp--; Sp[0] = (W_)&stg_ap_p_info;
-            goto nextInsn;
-        case bci_PUSH_APPLY_PP:
+            NEXT_INSN;
+        INSTR(bci_PUSH_APPLY_PP):
             Sp--; Sp[0] = (W_)&stg_ap_pp_info;
-            goto nextInsn;
-        case bci_PUSH_APPLY_PPP:
+            NEXT_INSN;
+        INSTR(bci_PUSH_APPLY_PPP):
             Sp--; Sp[0] = (W_)&stg_ap_ppp_info;
-            goto nextInsn;
-        case bci_PUSH_APPLY_PPPP:
+            NEXT_INSN;
+        INSTR(bci_PUSH_APPLY_PPPP):
             Sp--; Sp[0] = (W_)&stg_ap_pppp_info;
-            goto nextInsn;
-        case bci_PUSH_APPLY_PPPPP:
+            NEXT_INSN;
+        INSTR(bci_PUSH_APPLY_PPPPP):
             Sp--; Sp[0] = (W_)&stg_ap_ppppp_info;
-            goto nextInsn;
-        case bci_PUSH_APPLY_PPPPPP:
+            NEXT_INSN;
+        INSTR(bci_PUSH_APPLY_PPPPPP):
             Sp--; Sp[0] = (W_)&stg_ap_pppppp_info;
-            goto nextInsn;
+            NEXT_INSN;
 
-        case bci_PUSH_UBX: {
+        INSTR(bci_PUSH_UBX): {
             int i;
             int o_lits = BCO_GET_LARGE_ARG;
             int n_words = BCO_NEXT;
@@ -1227,10 +1334,10 @@ run_BCO:
             for (i = 0; i < n_words; i++) {
                 Sp[i] = (W_)BCO_LIT(o_lits+i);
             }
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_SLIDE: {
+        INSTR(bci_SLIDE): {
             int n  = BCO_NEXT;
             int by = BCO_NEXT;
             /* a_1, .. a_n, b_1, .. b_by, s => a_1, .. a_n, s */
@@ -1239,10 +1346,47 @@ run_BCO:
             }
             Sp += by;
             INTERP_TICK(it_slides);
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_ALLOC_AP: {
+        // Superinstructions: see Note [Superinstructions] in ByteCodeAsm
+
+        INSTR(bci_PUSH_L_ENTER): {
+            int o1 = BCO_NEXT;
+            Sp[-1] = Sp[o1];
+            Sp--;
+            goto do_enter;
+        }
+
+        INSTR(bci_PUSH_G_ENTER): {
+            int o1 = BCO_GET_LARGE_ARG;
+            Sp[-1] = BCO_PTR(o1);
+            Sp--;
+            goto do_enter;
+        }
+
+        INSTR(bci_SLIDE_ENTER): {
+            int n  = BCO_NEXT;
+            int by = BCO_NEXT;
+            while(--n >= 0) {
+                Sp[n+by] = Sp[n];
+            }
+            Sp += by;
+            INTERP_TICK(it_slides);
+            goto do_enter;
+        }
+
+        INSTR(bci_PUSH_APPLY_PTRS_L): {
+            int n_ptrs = BCO_NEXT;
+            int o1     = BCO_NEXT;
+            ASSERT(n_ptrs >= 1 && n_ptrs <= 6);
+            Sp--; Sp[0] = app_ptrs_itbl[n_ptrs-1];
+            Sp[-1] = Sp[o1];
+            Sp--;
+            NEXT_INSN;
+        }
+
+        INSTR(bci_ALLOC_AP): {
             StgAP* ap;
             int n_payload = BCO_NEXT;
             ap = (StgAP*)allocate(cap, AP_sizeW(n_payload));
@@ -1250,10 +1394,10 @@ run_BCO:
             ap->n_args = n_payload;
             SET_HDR(ap, &stg_AP_info, cap->r.rCCCS)
             Sp --;
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_ALLOC_AP_NOUPD: {
+        INSTR(bci_ALLOC_AP_NOUPD): {
             StgAP* ap;
             int n_payload = BCO_NEXT;
             ap = (StgAP*)allocate(cap, AP_sizeW(n_payload));
@@ -1261,10 +1405,10 @@ run_BCO:
             ap->n_args = n_payload;
             SET_HDR(ap, &stg_AP_NOUPD_info, cap->r.rCCCS)
             Sp --;
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_ALLOC_PAP: {
+        INSTR(bci_ALLOC_PAP): {
             StgPAP* pap;
             int arity = BCO_NEXT;
             int n_payload = BCO_NEXT;
@@ -1274,10 +1418,10 @@ run_BCO:
             pap->arity = arity;
             SET_HDR(pap, &stg_PAP_info, cap->r.rCCCS)
             Sp --;
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_MKAP: {
+        INSTR(bci_MKAP): {
             int i;
             int stkoff = BCO_NEXT;
             int n_payload = BCO_NEXT;
@@ -1297,10 +1441,10 @@ run_BCO:
                      debugBelch("\tBuilt ");
                      printObj((StgClosure*)ap);
                 );
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_MKPAP: {
+        INSTR(bci_MKPAP): {
             int i;
             int stkoff = BCO_NEXT;
             int n_payload = BCO_NEXT;
@@ -1323,10 +1467,10 @@ run_BCO:
                      debugBelch("\tBuilt ");
                      printObj((StgClosure*)pap);
                 );
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_UNPACK: {
+        INSTR(bci_UNPACK): {
             /* Unpack N ptr words from t.o.s constructor */
             int i;
             int n_words = BCO_NEXT;
@@ -1335,10 +1479,10 @@ run_BCO:
             for (i = 0; i < n_words; i++) {
                 Sp[i] = (W_)con->payload[i];
             }
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_PACK: {
+        INSTR(bci_PACK): {
             int i;
             int o_itbl         = BCO_GET_LARGE_ARG;
             int n_words        = BCO_NEXT;
@@ -1358,40 +1502,40 @@ run_BCO:
                      debugBelch("\tBuilt ");
                      printObj((StgClosure*)con);
                 );
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_TESTLT_P: {
+        INSTR(bci_TESTLT_P): {
             unsigned int discr  = BCO_NEXT;
             int failto = BCO_GET_LARGE_ARG;
             StgClosure* con = (StgClosure*)Sp[0];
             if (GET_TAG(con) >= discr) {
                 bciPtr = failto;
             }
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_TESTEQ_P: {
+        INSTR(bci_TESTEQ_P): {
             unsigned int discr  = BCO_NEXT;
             int failto = BCO_GET_LARGE_ARG;
             StgClosure* con = (StgClosure*)Sp[0];
             if (GET_TAG(con) != discr) {
                 bciPtr = failto;
             }
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_TESTLT_I: {
+        INSTR(bci_TESTLT_I): {
             // There should be an Int at Sp[1], and an info table at Sp[0].
             int discr   = BCO_GET_LARGE_ARG;
             int failto  = BCO_GET_LARGE_ARG;
             I_ stackInt = (I_)Sp[1];
             if (stackInt >= (I_)BCO_LIT(discr))
                 bciPtr = failto;
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_TESTEQ_I: {
+        INSTR(bci_TESTEQ_I): {
             // There should be an Int at Sp[1], and an info table at Sp[0].
             int discr   = BCO_GET_LARGE_ARG;
             int failto  = BCO_GET_LARGE_ARG;
@@ -1399,20 +1543,20 @@ run_BCO:
             if (stackInt != (I_)BCO_LIT(discr)) {
                 bciPtr = failto;
             }
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_TESTLT_W: {
+        INSTR(bci_TESTLT_W): {
             // There should be an Int at Sp[1], and an info table at Sp[0].
             int discr   = BCO_GET_LARGE_ARG;
             int failto  = BCO_GET_LARGE_ARG;
             W_ stackWord = (W_)Sp[1];
             if (stackWord >= (W_)BCO_LIT(discr))
                 bciPtr = failto;
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_TESTEQ_W: {
+        INSTR(bci_TESTEQ_W): {
             // There should be an Int at Sp[1], and an info table at Sp[0].
             int discr   = BCO_GET_LARGE_ARG;
             int failto  = BCO_GET_LARGE_ARG;
@@ -1420,10 +1564,10 @@ run_BCO:
             if (stackWord != (W_)BCO_LIT(discr)) {
                 bciPtr = failto;
             }
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_TESTLT_D: {
+        INSTR(bci_TESTLT_D): {
             // There should be a Double at Sp[1], and an info table at Sp[0].
             int discr   = BCO_GET_LARGE_ARG;
             int failto  = BCO_GET_LARGE_ARG;
@@ -1433,10 +1577,10 @@ run_BCO:
             if (stackDbl >= discrDbl) {
                 bciPtr = failto;
             }
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_TESTEQ_D: {
+        INSTR(bci_TESTEQ_D): {
             // There should be a Double at Sp[1], and an info table at Sp[0].
             int discr   = BCO_GET_LARGE_ARG;
             int failto  = BCO_GET_LARGE_ARG;
@@ -1446,10 +1590,10 @@ run_BCO:
             if (stackDbl != discrDbl) {
                 bciPtr = failto;
             }
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_TESTLT_F: {
+        INSTR(bci_TESTLT_F): {
             // There should be a Float at Sp[1], and an info table at Sp[0].
             int discr   = BCO_GET_LARGE_ARG;
             int failto  = BCO_GET_LARGE_ARG;
@@ -1459,10 +1603,10 @@ run_BCO:
             if (stackFlt >= discrFlt) {
                 bciPtr = failto;
             }
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_TESTEQ_F: {
+        INSTR(bci_TESTEQ_F): {
             // There should be a Float at Sp[1], and an info table at Sp[0].
             int discr   = BCO_GET_LARGE_ARG;
             int failto  = BCO_GET_LARGE_ARG;
@@ -1472,11 +1616,12 @@ run_BCO:
             if (stackFlt != discrFlt) {
                 bciPtr = failto;
             }
-            goto nextInsn;
+            NEXT_INSN;
         }
 
         // Control-flow ish things
-        case bci_ENTER:
+        INSTR(bci_ENTER):
+        do_enter:
             // Context-switch check.  We put it here to ensure that
             // the interpreter has done at least *some* work before
             // context switching: sometimes the scheduler can invoke
@@ -1488,44 +1633,44 @@ run_BCO:
             }
             goto eval;
 
-        case bci_RETURN:
+        INSTR(bci_RETURN):
             tagged_obj = (StgClosure *)Sp[0];
             Sp++;
             goto do_return;
 
-        case bci_RETURN_P:
+        INSTR(bci_RETURN_P):
             Sp--;
             Sp[0] = (W_)&stg_ret_p_info;
             goto do_return_unboxed;
-        case bci_RETURN_N:
+        INSTR(bci_RETURN_N):
             Sp--;
             Sp[0] = (W_)&stg_ret_n_info;
             goto do_return_unboxed;
-        case bci_RETURN_F:
+        INSTR(bci_RETURN_F):
             Sp--;
             Sp[0] = (W_)&stg_ret_f_info;
             goto do_return_unboxed;
-        case bci_RETURN_D:
+        INSTR(bci_RETURN_D):
             Sp--;
             Sp[0] = (W_)&stg_ret_d_info;
             goto do_return_unboxed;
-        case bci_RETURN_L:
+        INSTR(bci_RETURN_L):
             Sp--;
             Sp[0] = (W_)&stg_ret_l_info;
             goto do_return_unboxed;
-        case bci_RETURN_V:
+        INSTR(bci_RETURN_V):
             Sp--;
             Sp[0] = (W_)&stg_ret_v_info;
             goto do_return_unboxed;
 
-        case bci_SWIZZLE: {
+        INSTR(bci_SWIZZLE): {
             int stkoff = BCO_NEXT;
             signed short n = (signed short)(BCO_NEXT);
             Sp[stkoff] += (W_)n;
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_CCALL: {
+        INSTR(bci_CCALL): {
             void *tok;
             int stk_offset            = BCO_NEXT;
             int o_itbl                = BCO_GET_LARGE_ARG;
@@ -1653,21 +1798,24 @@ run_BCO:
             // most 2 words large, and resides at arguments[0].
             memcpy(Sp, ret, sizeof(W_) * stg_min(stk_offset,ret_size));
 
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_JMP: {
+        INSTR(bci_JMP): {
             /* BCO_NEXT modifies bciPtr, so be conservative. */
             int nextpc = BCO_GET_LARGE_ARG;
             bciPtr     = nextpc;
-            goto nextInsn;
+            NEXT_INSN;
         }
 
-        case bci_CASEFAIL:
+        INSTR(bci_CASEFAIL):
             barf("interpretBCO: hit a CASEFAIL");
 
             // Errors
         default:
+#if defined(THREADED_DISPATCH)
+        lbl_bad_opcode:
+#endif
             barf("interpretBCO: unknown or unimplemented opcode %d",
                  (int)(bci & 0xFF));
 
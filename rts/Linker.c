@@ -200,7 +200,7 @@ typedef struct _RtsSymbolInfo {
    2) The number of duplicate symbols, since now only symbols that are
       true duplicates will display the error.
  */
-static /*Str*/HashTable *symhash;
+static OpenHashTable *symhash;
 
 /* List of currently loaded objects */
 ObjectCode *objects = NULL;     /* initially empty */
@@ -221,6 +221,51 @@ Mutex linker_mutex;
 Mutex linker_unloaded_mutex;
 #endif
 
+/* Relocating objects on several threads is only supported where
+   relocation touches no global linker state; see Note [Parallel
+   relocation]. */
+#if defined(THREADED_RTS) && defined(OBJFORMAT_ELF) \
+    && (defined(x86_64_HOST_ARCH) || defined(i386_HOST_ARCH))
+#define PARALLEL_RESOLVE 1
+
+static void deferOcLoad (ObjectCode *oc);
+
+/* Set by resolveObjsInParallel() while the other threads are relocating */
+static rtsBool resolving_in_parallel = rtsFalse;
+
+static Mutex resolve_mutex;
+static Condition resolve_done_cond;     // signalled when a thread finishes
+#endif
+
+/* Archives are indexed from their symbol table and their members loaded
+   on demand; see Note [Lazy archive members]. */
+#if defined(OBJFORMAT_ELF) && RTS_LINKER_USE_MMAP
+#define LAZY_ARCHIVES 1
+
+struct _LazyArchive;
+static int loadLazyMember (ObjectCode *oc);
+static void releaseLazyArchive (struct _LazyArchive *ar);
+#endif
+
+/* With --linker-cache, relocated objects are saved and mapped back in
+   when they are loaded again; see Note [Prelinked object cache]. */
+#if defined(OBJFORMAT_ELF) && defined(x86_64_HOST_ARCH) && RTS_LINKER_USE_MMAP
+#define PRELINK_CACHE 1
+
+typedef struct _Prelinked {
+    char      *region;      // the sections and symbol extras
+    StgWord    size;
+    StgWord    used;        // bytes handed out by prelinkAlloc()
+    rtsBool    cached;      // region was mapped from the cache
+    HashTable *deps;        // symbol name -> address, while relocating
+    pathchar  *path;        // the cache entry for this object
+} Prelinked;
+
+static void ocPrelink_ELF (ObjectCode *oc);
+static void *prelinkAlloc (Prelinked *p, StgWord size, StgWord align);
+static void freePrelinked (Prelinked *p);
+#endif
+
 /* Type of the initializer */
 typedef void (*init_t) (int argc, char **argv, char **env);
 
@@ -314,6 +359,9 @@ static int ocVerifyImage_ELF    ( ObjectCode* oc );
 static int ocGetNames_ELF       ( ObjectCode* oc );
 static int ocResolve_ELF        ( ObjectCode* oc );
 static int ocRunInit_ELF        ( ObjectCode* oc );
+#if defined(LAZY_ARCHIVES) && defined(PARALLEL_RESOLVE)
+static int ocLoadLazyMembers_ELF ( ObjectCode* oc );
+#endif
 #if NEED_SYMBOL_EXTRAS
 static int ocAllocateSymbolExtras_ELF ( ObjectCode* oc );
 #endif
@@ -506,12 +554,12 @@ static void freeProddableBlocks (ObjectCode *oc);
 static void *mmap_32bit_base = (void *)MMAP_32BIT_BASE_DEFAULT;
 #endif
 
-static void ghciRemoveSymbolTable(HashTable *table, const SymbolName* key,
+static void ghciRemoveSymbolTable(OpenHashTable *table, const SymbolName* key,
     ObjectCode *owner)
 {
-    RtsSymbolInfo *pinfo = lookupStrHashTable(table, key);
+    RtsSymbolInfo *pinfo = lookupStrOpenHashTable(table, key);
     if (!pinfo || owner != pinfo->owner) return;
-    removeStrHashTable(table, key, NULL);
+    removeStrOpenHashTable(table, key, NULL);
     stgFree(pinfo);
 }
 
@@ -538,20 +586,20 @@ static void ghciRemoveSymbolTable(HashTable *table, const SymbolName* key,
  */
 static int ghciInsertSymbolTable(
    pathchar* obj_name,
-   HashTable *table,
+   OpenHashTable *table,
    const SymbolName* key,
    SymbolAddr* data,
    HsBool weak,
    ObjectCode *owner)
 {
-   RtsSymbolInfo *pinfo = lookupStrHashTable(table, key);
+   RtsSymbolInfo *pinfo = lookupStrOpenHashTable(table, key);
    if (!pinfo) /* new entry */
    {
       pinfo = stgMallocBytes(sizeof (*pinfo), "ghciInsertToSymbolTable");
       pinfo->value = data;
       pinfo->owner = owner;
       pinfo->weak = weak;
-      insertStrHashTable(table, key, pinfo);
+      insertStrOpenHashTable(table, key, pinfo);
       return 1;
    }
    else if (weak && data && pinfo->weak && !pinfo->value)
@@ -649,10 +697,10 @@ static int ghciInsertSymbolTable(
 * Returns: 0 on failure and result is not set,
 *          nonzero on success and result set to nonzero pointer
 */
-static HsBool ghciLookupSymbolInfo(HashTable *table,
+static HsBool ghciLookupSymbolInfo(OpenHashTable *table,
     const SymbolName* key, RtsSymbolInfo **result)
 {
-    RtsSymbolInfo *pinfo = lookupStrHashTable(table, key);
+    RtsSymbolInfo *pinfo = lookupStrOpenHashTable(table, key);
     if (!pinfo) {
         *result = NULL;
         return HS_BOOL_FALSE;
@@ -721,9 +769,13 @@ initLinker_ (int retain_cafs)
 #if defined(OBJFORMAT_ELF) || defined(OBJFORMAT_MACHO)
     initMutex(&dl_mutex);
 #endif
+#if defined(PARALLEL_RESOLVE)
+    initMutex(&resolve_mutex);
+    initCondition(&resolve_done_cond);
+#endif
 #endif
 
-    symhash = allocStrHashTable();
+    symhash = allocStrOpenHashTable();
 
     /* populate the symbol table with stuff from the RTS */
     for (sym = rtsSyms; sym->lbl != NULL; sym++) {
@@ -820,11 +872,17 @@ exitLinker( void ) {
    }
 #endif
    if (linker_init_done == 1) {
-       freeHashTable(symhash, free);
+       freeOpenHashTable(symhash, free);
    }
 #ifdef THREADED_RTS
    closeMutex(&linker_mutex);
 #endif
+#if defined(PARALLEL_RESOLVE)
+   if (linker_init_done == 1) {
+       closeMutex(&resolve_mutex);
+       closeCondition(&resolve_done_cond);
+   }
+#endif
 }
 
 /* -----------------------------------------------------------------------------
@@ -1339,6 +1397,27 @@ static SymbolAddr* lookupSymbol_ (SymbolName* lbl)
     ASSERT(symhash != NULL);
     RtsSymbolInfo *pinfo;
 
+#if defined(LAZY_ARCHIVES)
+    /* The symbol is defined by an archive member that we haven't loaded
+       yet.  See Note [Lazy archive members] */
+    if (ghciLookupSymbolInfo(symhash, lbl, &pinfo)
+        && pinfo->owner && pinfo->owner->lazy) {
+#if defined(PARALLEL_RESOLVE)
+        // resolveObjsInParallel() loads these members beforehand
+        if (resolving_in_parallel) {
+            errorBelch("Could not on-demand load symbol '%s'\n", lbl);
+            return NULL;
+        }
+#endif
+        IF_DEBUG(linker, debugBelch("lookupSymbol: loading the archive member "
+                                    "defining '%s'\n", lbl));
+        if (!loadLazyMember(pinfo->owner)) {
+            errorBelch("Could not on-demand load symbol '%s'\n", lbl);
+            return NULL;
+        }
+    }
+#endif
+
     if (!ghciLookupSymbolInfo(symhash, lbl, &pinfo)) {
         IF_DEBUG(linker, debugBelch("lookupSymbol: symbol not found\n"));
 
@@ -1391,6 +1470,12 @@ static SymbolAddr* lookupSymbol_ (SymbolName* lbl)
         /* Symbol can be found during linking, but hasn't been relocated. Do so now.
            See Note [runtime-linker-phases] */
         if (oc && oc->status == OBJECT_LOADED) {
+#if defined(PARALLEL_RESOLVE)
+            if (resolving_in_parallel) {
+                deferOcLoad(oc);
+                return val;
+            }
+#endif
             oc->status = OBJECT_NEEDED;
             IF_DEBUG(linker, debugBelch("lookupSymbol: on-demand loading symbol '%s'\n", lbl));
             r = ocTryLoad(oc);
@@ -1696,7 +1781,11 @@ void freeObjectCode (ObjectCode *oc)
      * alongside the image, so we don't need to free. */
 #if NEED_SYMBOL_EXTRAS && (!defined(x86_64_HOST_ARCH) || !defined(mingw32_HOST_OS))
     if (RTS_LINKER_USE_MMAP) {
-        if (!USE_CONTIGUOUS_MMAP && oc->symbol_extras != NULL) {
+        if (!USE_CONTIGUOUS_MMAP && oc->symbol_extras != NULL
+#if defined(PRELINK_CACHE)
+            && oc->prelinked == NULL
+#endif
+           ) {
             m32_free(oc->symbol_extras,
                     sizeof(SymbolExtra) * oc->n_symbol_extras);
         }
@@ -1706,6 +1795,18 @@ void freeObjectCode (ObjectCode *oc)
     }
 #endif
 
+#if defined(LAZY_ARCHIVES)
+    if (oc->archive != NULL) {
+        releaseLazyArchive(oc->archive);
+    }
+#endif
+
+#if defined(PRELINK_CACHE)
+    if (oc->prelinked != NULL) {
+        freePrelinked(oc->prelinked);
+    }
+#endif
+
     stgFree(oc->fileName);
     stgFree(oc->archiveMemberName);
 
@@ -1768,6 +1869,11 @@ mkOc( pathchar *path, char *image, int imageSize,
    oc->misalignment      = misalignment;
    oc->extraInfos        = NULL;
 
+   oc->archive           = NULL;
+   oc->archiveOffset     = 0;
+   oc->lazy              = 0;
+   oc->prelinked         = NULL;
+
    /* chain it onto the list of objects */
    oc->next              = NULL;
 
@@ -1792,6 +1898,365 @@ isAlreadyLoaded( pathchar *path )
     return 0; /* not loaded yet */
 }
 
+#if defined(LAZY_ARCHIVES)
+/* Note [Lazy archive members]
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+   Loading an archive eagerly means reading every member into memory and
+   running ocGetNames on it, although a program typically needs only a
+   few of the members of a big library (see Note [runtime-linker-phases]).
+   Instead, loadArchiveLazily() maps the archive into memory once, finds
+   the members by walking their headers, and reads the archive symbol
+   table (the GNU "/" or "/SYM64/" member, or the BSD "__.SYMDEF") to
+   find out which symbols each member defines.  For each object member
+   that defines a symbol it makes an ObjectCode with no image, marked
+   lazy, whose symbols are inserted into symhash as placeholders with a
+   NULL value.
+
+   When lookupSymbol_() finds a placeholder, loadLazyMember() copies the
+   member out of the archive and loads it as loadArchive_() would have,
+   replacing the placeholders with the real symbols.  From then on the
+   member is an ordinary archive member in state OBJECT_LOADED, which
+   lookupSymbol_() goes on to resolve on demand.  Members that nothing
+   refers to are never read from the archive.
+
+   The placeholders are keyed by the names in the archive symbol table,
+   so the mapping lives until all the ObjectCodes of the archive have
+   been freed (LazyArchive.refs).
+
+   resolveObjsInParallel() can't load members while the relocating
+   threads are looking up symbols, so before each round it loads the
+   lazy members that define the undefined symbols of the objects in the
+   round (ocLoadLazyMembers_ELF()).
+
+   We only do this for ordinary (not thin) archives with a symbol table
+   that is consistent with the members; anything else is loaded eagerly
+   by loadArchive_().
+*/
+
+typedef struct _LazyArchive {
+    char   *image;              // the whole archive, mmap()'d read-only
+    size_t  size;
+    StgWord refs;               // ObjectCodes for members of the archive
+} LazyArchive;
+
+typedef struct {
+    size_t      header;         // offset of the member's header
+    size_t      offset;         // offset of the member's contents
+    size_t      size;
+    rtsBool     isObject;
+    char       *name;
+    size_t      nameLen;
+    uint32_t    n_symbols;      // entries of the symbol table for it
+    ObjectCode *oc;
+} ArchiveMember;
+
+typedef struct {
+    SymbolName *name;
+    uint32_t    member;         // index into the ArchiveMembers
+} ArchiveSymbol;
+
+static void releaseLazyArchive (LazyArchive *ar)
+{
+    if (atomic_dec(&ar->refs) == 0) {
+        munmap(ar->image, ar->size);
+        stgFree(ar);
+    }
+}
+
+// The numeric fields of a member header are padded with spaces
+static size_t arDecimal (const char *p, int len)
+{
+    size_t n = 0;
+    int i;
+    for (i = 0; i < len && isdigit((unsigned char)p[i]); i++) {
+        n = n * 10 + (p[i] - '0');
+    }
+    return n;
+}
+
+static uint64_t arBigEndian (const char *p, int len)
+{
+    uint64_t n = 0;
+    int i;
+    for (i = 0; i < len; i++) {
+        n = (n << 8) | (unsigned char)p[i];
+    }
+    return n;
+}
+
+static int isObjectName (const char *name, size_t len)
+{
+    return (len >= 2 && strncmp(name + len - 2, ".o"  , 2) == 0)
+        || (len >= 4 && strncmp(name + len - 4, ".p_o", 4) == 0);
+}
+
+// Returns the index of the member whose header is at offset header, or
+// -1 if there isn't one.
+static int findArchiveMember (ArchiveMember *members, uint32_t n,
+                              size_t header)
+{
+    uint32_t lo = 0, hi = n;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (members[mid].header == header) return mid;
+        if (members[mid].header < header) lo = mid + 1; else hi = mid;
+    }
+    return -1;
+}
+
+/* Read an archive symbol table: w is 4 or 8 for the GNU formats (big
+ * endian offsets), or 0 for the BSD one (host byte order).
+ *
+ * Returns: the number of symbols, or -1 if the table is corrupt or
+ * refers to a member that doesn't exist.
+ */
+static int readArmap (char *armap, size_t size, int w,
+                      ArchiveMember *members, uint32_t n_members,
+                      ArchiveSymbol **syms_out)
+{
+    ArchiveSymbol *syms;
+    char *strings, *end = armap + size;
+    uint64_t n, i;
+    uint32_t ranlibSize, strx, off;
+    int m;
+
+    if (w != 0) {
+        if (size < (size_t)w) return -1;
+        n = arBigEndian(armap, w);
+        if (n > (size - w) / w) return -1;
+        strings = armap + w + n * w;
+    } else {
+        if (size < 8) return -1;
+        memcpy(&ranlibSize, armap, 4);
+        if (ranlibSize > size - 8 || ranlibSize % 8 != 0) return -1;
+        n = ranlibSize / 8;
+        strings = armap + 4 + ranlibSize + 4;
+    }
+
+    syms = stgMallocBytes(stg_max(n, 1) * sizeof(ArchiveSymbol), "readArmap");
+    for (i = 0; i < n; i++) {
+        if (w != 0) {
+            off = arBigEndian(armap + w + i * w, w);
+            syms[i].name = strings;
+            strings += strnlen(strings, end - strings) + 1;
+            if (strings > end) goto fail;
+        } else {
+            memcpy(&strx, armap + 4 + i * 8, 4);
+            memcpy(&off,  armap + 4 + i * 8 + 4, 4);
+            if (strx >= (size_t)(end - strings)
+                || strnlen(strings + strx, end - strings - strx)
+                   == (size_t)(end - strings - strx)) {
+                goto fail;
+            }
+            syms[i].name = strings + strx;
+        }
+        m = findArchiveMember(members, n_members, off);
+        if (m < 0) goto fail;
+        syms[i].member = m;
+        members[m].n_symbols++;
+    }
+
+    *syms_out = syms;
+    return n;
+
+fail:
+    stgFree(syms);
+    return -1;
+}
+
+/* Index the archive at path without loading its members.
+ * See Note [Lazy archive members].
+ *
+ * Returns: 1 if ok, -1 if the archive must be loaded eagerly instead.
+ */
+static HsInt loadArchiveLazily (pathchar *path)
+{
+    struct_stat st;
+    int fd, w = -1, n_syms = -1;
+    char *image, *hdr, *longNames = NULL, *armap = NULL;
+    size_t size, off, data, memberSize, nameLen, longNamesSize = 0;
+    size_t armapSize = 0, i;
+    ArchiveMember *members = NULL;
+    uint32_t n_members = 0, members_size = 0;
+    ArchiveSymbol *syms = NULL;
+    LazyArchive *ar;
+    ObjectCode *oc;
+    char *archiveMemberName;
+    HsInt r = -1;
+
+    if (pathstat(path, &st) == -1 || st.st_size < 8) return -1;
+    size = st.st_size;
+
+#if defined(openbsd_HOST_OS)
+    fd = open(path, O_RDONLY, S_IRUSR);
+#else
+    fd = open(path, O_RDONLY);
+#endif
+    if (fd == -1) return -1;
+    image = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) return -1;
+
+    // thin archives, and anything else, are left to loadArchive_()
+    if (memcmp(image, "!<arch>\n", 8) != 0) goto done;
+
+    for (off = 8; off + 60 <= size; off = data + memberSize + (memberSize & 1)) {
+        hdr = image + off;
+        if (memcmp(hdr + 58, "\x60\x0A", 2) != 0) goto done;
+        memberSize = arDecimal(hdr + 48, 10);
+        data = off + 60;
+        if (memberSize > size - data) goto done;
+
+        char *name = hdr;
+        nameLen = 0;
+
+        if (0 == strncmp(hdr, "/ ", 2)) {
+            armap = image + data; armapSize = memberSize; w = 4;
+        }
+        else if (0 == strncmp(hdr, "/SYM64/", 7)) {
+            armap = image + data; armapSize = memberSize; w = 8;
+        }
+        else if (0 == strncmp(hdr, "//", 2)) {
+            longNames = image + data; longNamesSize = memberSize;
+        }
+        else if (hdr[0] == '/' && isdigit((unsigned char)hdr[1])) {
+            size_t n = arDecimal(hdr + 1, 15);
+            if (longNames == NULL || n >= longNamesSize) goto done;
+            name = longNames + n;
+            while (n + nameLen < longNamesSize
+                   && name[nameLen] != '/' && name[nameLen] != '\n') {
+                nameLen++;
+            }
+        }
+        else if (0 == strncmp(hdr, "#1/", 3)) {
+            size_t n = arDecimal(hdr + 3, 13);
+            if (n > memberSize) goto done;
+            name = image + data;
+            nameLen = strnlen(name, n);
+            data += n;
+            memberSize -= n;
+        }
+        else {
+            while (nameLen < 16 && hdr[nameLen] != '/') nameLen++;
+            if (nameLen == 16) {
+                for (nameLen = 0; nameLen < 16 && hdr[nameLen] != ' '; nameLen++);
+            }
+        }
+
+        if (nameLen >= 9 && strncmp(name, "__.SYMDEF", 9) == 0) {
+            // __.SYMDEF_64 has 64-bit entries, which we don't read
+            if (nameLen > 9 && name[9] != ' ') goto done;
+            armap = image + data; armapSize = memberSize; w = 0;
+            nameLen = 0;
+        }
+
+        if (n_members == members_size) {
+            members_size = stg_max(2 * members_size, 64);
+            members = stgReallocBytes(members,
+                                      members_size * sizeof(ArchiveMember),
+                                      "loadArchiveLazily");
+        }
+        members[n_members].header    = off;
+        members[n_members].offset    = data;
+        members[n_members].size      = memberSize;
+        members[n_members].isObject  = isObjectName(name, nameLen);
+        members[n_members].name      = name;
+        members[n_members].nameLen   = nameLen;
+        members[n_members].n_symbols = 0;
+        members[n_members].oc        = NULL;
+        n_members++;
+    }
+
+    if (armap == NULL) goto done;
+    n_syms = readArmap(armap, armapSize, w, members, n_members, &syms);
+    if (n_syms < 0) {
+        IF_DEBUG(linker, debugBelch("loadArchiveLazily: bad symbol table in "
+                                    "`%" PATH_FMT "'\n", path));
+        goto done;
+    }
+
+    IF_DEBUG(linker, debugBelch("loadArchiveLazily: %d symbols in %d members\n",
+                                n_syms, (int)n_members));
+
+    ar = stgMallocBytes(sizeof(LazyArchive), "loadArchiveLazily");
+    ar->image = image;
+    ar->size  = size;
+    ar->refs  = 0;
+
+    for (i = 0; i < n_members; i++) {
+        if (!members[i].isObject || members[i].n_symbols == 0) continue;
+
+        archiveMemberName = stgMallocBytes(pathlen(path) + members[i].nameLen + 3,
+                                           "loadArchiveLazily");
+        sprintf(archiveMemberName, "%" PATH_FMT "(%.*s)",
+                path, (int)members[i].nameLen, members[i].name);
+        oc = mkOc(path, NULL, members[i].size, rtsFalse, archiveMemberName, 0);
+        stgFree(archiveMemberName);
+
+        oc->archive       = ar;
+        oc->archiveOffset = members[i].offset;
+        oc->lazy          = 1;
+        oc->symbols = stgCallocBytes(members[i].n_symbols, sizeof(SymbolName*),
+                                     "loadArchiveLazily");
+        oc->n_symbols = 0;
+        ar->refs++;
+
+        oc->next = objects;
+        objects = oc;
+        members[i].oc = oc;
+    }
+
+    for (i = 0; i < (size_t)n_syms; i++) {
+        oc = members[syms[i].member].oc;
+        if (oc == NULL) continue;
+        oc->symbols[oc->n_symbols++] = syms[i].name;
+        // never fails: the owner is OBJECT_LOADED
+        ghciInsertSymbolTable(path, symhash, syms[i].name, NULL,
+                              HS_BOOL_FALSE, oc);
+    }
+
+    if (ar->refs == 0) {
+        stgFree(ar);
+        munmap(image, size);
+    }
+    image = NULL;
+    r = 1;
+
+done:
+    if (image != NULL) {
+        munmap(image, size);
+    }
+    stgFree(syms);
+    stgFree(members);
+    IF_DEBUG(linker, debugBelch("loadArchiveLazily: %" PATH_FMT ": %s\n", path,
+                                r == 1 ? "indexed" : "loading eagerly"));
+    return r;
+}
+
+// Load an archive member indexed by loadArchiveLazily()
+static int loadLazyMember (ObjectCode *oc)
+{
+    LazyArchive *ar = oc->archive;
+
+    IF_DEBUG(linker, debugBelch("loadLazyMember: %s\n", oc->archiveMemberName));
+
+    // drop the placeholders, loadOc() adds the real symbols
+    removeOcSymbols(oc);
+    oc->n_symbols = 0;
+    oc->lazy = 0;
+
+    oc->image = stgMallocBytes(oc->fileSize, "loadLazyMember(image)");
+    memcpy(oc->image, ar->image + oc->archiveOffset, oc->fileSize);
+
+    if (!loadOc(oc)) {
+        removeOcSymbols(oc);
+        return 0;
+    }
+    return 1;
+}
+#endif /* LAZY_ARCHIVES */
+
 static HsInt loadArchive_ (pathchar *path)
 {
     ObjectCode* oc;
@@ -1842,6 +2307,11 @@ static HsInt loadArchive_ (pathchar *path)
         return 1; /* success */
     }
 
+#if defined(LAZY_ARCHIVES)
+    HsInt r = loadArchiveLazily(path);
+    if (r >= 0) return r;
+#endif
+
     gnuFileIndex = NULL;
     gnuFileIndexSize = 0;
 
@@ -2477,6 +2947,10 @@ static HsInt loadOc (ObjectCode* oc)
        return r;
    }
 
+#if defined(PRELINK_CACHE)
+   ocPrelink_ELF ( oc );
+#endif
+
 #if NEED_SYMBOL_EXTRAS
 #  if defined(OBJFORMAT_MACHO)
    r = ocAllocateSymbolExtras_MachO ( oc );
@@ -2518,28 +2992,25 @@ static HsInt loadOc (ObjectCode* oc)
 }
 
 /* -----------------------------------------------------------------------------
-* try to load and initialize an ObjectCode into memory
-*
-* Returns: 1 if ok, 0 on error.
-*/
-int ocTryLoad (ObjectCode* oc) {
-    int r;
-
-    if (oc->status != OBJECT_NEEDED) {
-        return 1;
-    }
+ * The steps of ocTryLoad(), which resolveObjsInParallel() performs
+ * separately.
+ *
+ * Each returns: 1 if ok, 0 on error.
+ */
 
-    /*  Check for duplicate symbols by looking into `symhash`.
-        Duplicate symbols are any symbols which exist
-        in different ObjectCodes that have both been loaded, or
-        are to be loaded by this call.
+/*  Check for duplicate symbols by looking into `symhash`.
+    Duplicate symbols are any symbols which exist
+    in different ObjectCodes that have both been loaded, or
+    are to be loaded by this call.
 
-        This call is intended to have no side-effects when a non-duplicate
-        symbol is re-inserted.
+    This call is intended to have no side-effects when a non-duplicate
+    symbol is re-inserted.
 
-        We set the Address to NULL since that is not used to distinguish
-        symbols. Duplicate symbols are distinguished by name and oc.
-    */
+    We set the Address to NULL since that is not used to distinguish
+    symbols. Duplicate symbols are distinguished by name and oc.
+*/
+static int ocCheckSymbols (ObjectCode* oc)
+{
     int x;
     SymbolName* symbol;
     for (x = 0; x < oc->n_symbols; x++) {
@@ -2549,39 +3020,285 @@ int ocTryLoad (ObjectCode* oc) {
             return 0;
         }
     }
+    return 1;
+}
 
+static int ocResolve (ObjectCode* oc)
+{
 #           if defined(OBJFORMAT_ELF)
-        r = ocResolve_ELF ( oc );
+    return ocResolve_ELF ( oc );
 #           elif defined(OBJFORMAT_PEi386)
-        r = ocResolve_PEi386 ( oc );
+    return ocResolve_PEi386 ( oc );
 #           elif defined(OBJFORMAT_MACHO)
-        r = ocResolve_MachO ( oc );
+    return ocResolve_MachO ( oc );
 #           else
     barf("ocTryLoad: not implemented on this platform");
 #           endif
-        if (!r) { return r; }
+}
 
-        // run init/init_array/ctors/mod_init_func
+// run init/init_array/ctors/mod_init_func
+static int ocRunInit (ObjectCode* oc)
+{
+    int r;
 
-        loading_obj = oc; // tells foreignExportStablePtr what to do
+    loading_obj = oc; // tells foreignExportStablePtr what to do
 #if defined(OBJFORMAT_ELF)
-        r = ocRunInit_ELF ( oc );
+    r = ocRunInit_ELF ( oc );
 #elif defined(OBJFORMAT_PEi386)
-        r = ocRunInit_PEi386 ( oc );
+    r = ocRunInit_PEi386 ( oc );
 #elif defined(OBJFORMAT_MACHO)
-        r = ocRunInit_MachO ( oc );
+    r = ocRunInit_MachO ( oc );
 #else
     barf("ocTryLoad: initializers not implemented on this platform");
 #endif
-        loading_obj = NULL;
+    loading_obj = NULL;
+
+    return r;
+}
+
+/* -----------------------------------------------------------------------------
+* try to load and initialize an ObjectCode into memory
+*
+* Returns: 1 if ok, 0 on error.
+*/
+int ocTryLoad (ObjectCode* oc) {
+    int r;
 
-        if (!r) { return r; }
+    if (oc->status != OBJECT_NEEDED) {
+        return 1;
+    }
+
+    r = ocCheckSymbols(oc);
+    if (!r) { return r; }
+
+    r = ocResolve(oc);
+    if (!r) { return r; }
+
+    r = ocRunInit(oc);
+    if (!r) { return r; }
 
     oc->status = OBJECT_RESOLVED;
 
     return 1;
 }
 
+#if defined(PARALLEL_RESOLVE)
+/* -----------------------------------------------------------------------------
+ * Note [Parallel relocation]
+ *
+ * Relocating an object is mostly a matter of looking up each of its
+ * undefined symbols in symhash and patching the object's own image, so
+ * with +RTS -xl<n> resolveObjs() relocates the objects on n threads.
+ * This works in rounds:
+ *
+ *   - First, serially, the symbols of every object in the round are
+ *     checked for duplicates (ocCheckSymbols()), which may update
+ *     symhash.
+ *
+ *   - Then the threads take objects from resolve_queue one at a time
+ *     and relocate them (ocResolve()).  Nothing is inserted into
+ *     symhash while they do, so they can all look symbols up.
+ *
+ *   - A lookup may find a symbol of an archive member that hasn't been
+ *     loaded yet (OBJECT_LOADED).  Serially, lookupSymbol_() would load
+ *     it there and then, but that would modify symhash under the feet
+ *     of the other threads.  Instead deferOcLoad() marks the member as
+ *     OBJECT_NEEDED and adds it to resolve_needed: the address of the
+ *     symbol is already known, and the member makes up the next round.
+ *
+ * When no more objects are needed, their initialisers are run
+ * serially, the last round first, so that (as when loading on demand)
+ * an object's initialisers run after those of the members it needs.
+ *
+ * This is only done where relocation doesn't touch any other global
+ * state (see PARALLEL_RESOLVE).  The only other shared thing a lookup
+ * writes is RtsSymbolInfo.weak, which it always sets to false.
+ * -------------------------------------------------------------------------- */
+
+// resolve_mutex (declared at the top) protects all of these
+
+static ObjectCode **resolve_queue = NULL;  // objects in this round
+static uint32_t n_resolve_queue = 0;
+static uint32_t resolve_queue_size = 0;
+static uint32_t resolve_next = 0;          // next object to relocate
+
+static ObjectCode **resolve_needed = NULL; // objects for the next round
+static uint32_t n_resolve_needed = 0;
+static uint32_t resolve_needed_size = 0;
+
+static rtsBool resolve_failed = rtsFalse;
+static uint32_t resolve_threads_running = 0;
+
+static void pushObject (ObjectCode ***objs, uint32_t *n, uint32_t *size,
+                        ObjectCode *oc)
+{
+    if (*n == *size) {
+        *size = stg_max(2 * *size, 64);
+        *objs = stgReallocBytes(*objs, *size * sizeof(ObjectCode *),
+                                "pushObject");
+    }
+    (*objs)[(*n)++] = oc;
+}
+
+// Called by lookupSymbol_() instead of loading oc on demand.
+static void deferOcLoad (ObjectCode *oc)
+{
+    ACQUIRE_LOCK(&resolve_mutex);
+    if (oc->status == OBJECT_LOADED) {
+        IF_DEBUG(linker, debugBelch("deferOcLoad: %" PATH_FMT " is needed\n",
+                                    oc->fileName));
+        oc->status = OBJECT_NEEDED;
+        pushObject(&resolve_needed, &n_resolve_needed, &resolve_needed_size,
+                   oc);
+    }
+    RELEASE_LOCK(&resolve_mutex);
+}
+
+static void resolveQueuedObjects (void)
+{
+    ObjectCode *oc;
+
+    for (;;) {
+        ACQUIRE_LOCK(&resolve_mutex);
+        if (resolve_failed || resolve_next == n_resolve_queue) {
+            RELEASE_LOCK(&resolve_mutex);
+            return;
+        }
+        oc = resolve_queue[resolve_next++];
+        RELEASE_LOCK(&resolve_mutex);
+
+        if (!ocResolve(oc)) {
+            ACQUIRE_LOCK(&resolve_mutex);
+            resolve_failed = rtsTrue;
+            RELEASE_LOCK(&resolve_mutex);
+        }
+    }
+}
+
+static void OSThreadProcAttr
+resolveThreadStart (void *arg STG_UNUSED)
+{
+    resolveQueuedObjects();
+
+    ACQUIRE_LOCK(&resolve_mutex);
+    resolve_threads_running--;
+    signalCondition(&resolve_done_cond);
+    RELEASE_LOCK(&resolve_mutex);
+}
+
+// Relocate the objects in resolve_queue, using up to
+// RtsFlags.MiscFlags.linkerThreads threads (including this one).
+static void resolveRound (void)
+{
+    uint32_t i, n_threads;
+    OSThreadId tid;
+
+    resolve_next = 0;
+    resolve_failed = rtsFalse;
+    resolve_threads_running = 0;
+
+    n_threads = stg_min(RtsFlags.MiscFlags.linkerThreads, n_resolve_queue);
+    for (i = 1; i < n_threads; i++) {
+        ACQUIRE_LOCK(&resolve_mutex);
+        resolve_threads_running++;
+        RELEASE_LOCK(&resolve_mutex);
+        if (createOSThread(&tid, "ghc_linker",
+                           (OSThreadProc *)resolveThreadStart, NULL) != 0) {
+            // never mind, we'll do the work with fewer threads
+            ACQUIRE_LOCK(&resolve_mutex);
+            resolve_threads_running--;
+            RELEASE_LOCK(&resolve_mutex);
+            break;
+        }
+    }
+
+    resolveQueuedObjects();
+
+    ACQUIRE_LOCK(&resolve_mutex);
+    while (resolve_threads_running > 0) {
+        waitCondition(&resolve_done_cond, &resolve_mutex);
+    }
+    RELEASE_LOCK(&resolve_mutex);
+}
+
+static HsInt resolveObjsInParallel (void)
+{
+    ObjectCode *oc;
+    ObjectCode **resolved = NULL;       // all the rounds, in order
+    uint32_t n_resolved = 0, resolved_size = 0;
+    uint32_t *round_ends = NULL;        // where each round ends in resolved
+    uint32_t n_rounds = 0, i;
+    HsInt r = 0;
+
+    n_resolve_queue = 0;
+    n_resolve_needed = 0;
+    for (oc = objects; oc; oc = oc->next) {
+        if (oc->status == OBJECT_NEEDED) {
+            pushObject(&resolve_queue, &n_resolve_queue, &resolve_queue_size,
+                       oc);
+        }
+    }
+
+    while (n_resolve_queue > 0) {
+        IF_DEBUG(linker, debugBelch("resolveObjs: relocating %d objects\n",
+                                    n_resolve_queue));
+
+#if defined(LAZY_ARCHIVES)
+        for (i = 0; i < n_resolve_queue; i++) {
+            if (!ocLoadLazyMembers_ELF(resolve_queue[i])) goto done;
+        }
+#endif
+
+        for (i = 0; i < n_resolve_queue; i++) {
+            if (!ocCheckSymbols(resolve_queue[i])) goto done;
+        }
+
+        resolving_in_parallel = rtsTrue;
+        resolveRound();
+        resolving_in_parallel = rtsFalse;
+        if (resolve_failed) goto done;
+
+        for (i = 0; i < n_resolve_queue; i++) {
+            pushObject(&resolved, &n_resolved, &resolved_size,
+                       resolve_queue[i]);
+        }
+        round_ends = stgReallocBytes(round_ends,
+                                     (n_rounds + 1) * sizeof(uint32_t),
+                                     "resolveObjsInParallel");
+        round_ends[n_rounds++] = n_resolved;
+
+        // the objects needed by this round make up the next one
+        n_resolve_queue = 0;
+        for (i = 0; i < n_resolve_needed; i++) {
+            pushObject(&resolve_queue, &n_resolve_queue, &resolve_queue_size,
+                       resolve_needed[i]);
+        }
+        n_resolve_needed = 0;
+    }
+
+    while (n_rounds > 0) {
+        n_rounds--;
+        for (i = n_rounds == 0 ? 0 : round_ends[n_rounds-1];
+             i < round_ends[n_rounds]; i++) {
+            oc = resolved[i];
+            if (!ocRunInit(oc)) goto done;
+            oc->status = OBJECT_RESOLVED;
+        }
+    }
+
+    r = 1;
+
+done:
+    // on failure, the objects we didn't get to are left OBJECT_NEEDED,
+    // as ocTryLoad() would leave them
+    resolving_in_parallel = rtsFalse;
+    n_resolve_needed = 0;
+    stgFree(resolved);
+    stgFree(round_ends);
+    return r;
+}
+#endif /* PARALLEL_RESOLVE */
+
 /* -----------------------------------------------------------------------------
  * resolve all the currently unlinked objects in memory
  *
@@ -2594,6 +3311,12 @@ static HsInt resolveObjs_ (void)
 
     IF_DEBUG(linker, debugBelch("resolveObjs: start\n"));
 
+#if defined(PARALLEL_RESOLVE)
+    if (RtsFlags.MiscFlags.linkerThreads > 1) {
+        r = resolveObjsInParallel();
+        if (!r) return r;
+    } else
+#endif
     for (oc = objects; oc; oc = oc->next) {
         r = ocTryLoad(oc);
         if (!r)
@@ -2693,6 +3416,14 @@ HsInt purgeObj (pathchar *path)
     return r;
 }
 
+void getLinkerMemStats (LinkerMemStats *stats)
+{
+    memset(stats, 0, sizeof(LinkerMemStats));
+    if (RTS_LINKER_USE_MMAP) {
+        m32_get_stats(stats);
+    }
+}
+
 /* -----------------------------------------------------------------------------
  * Sanity checking.  For each ObjectCode, maintain a list of address ranges
  * which may be prodded during relocation, and abort if we try and write
@@ -2817,10 +3548,18 @@ static int ocAllocateSymbolExtras( ObjectCode* oc, int count, int first )
       }
   }
   else if( count > 0 ) {
+#if defined(PRELINK_CACHE)
+    if (oc->prelinked != NULL) {
+        oc->symbol_extras = prelinkAlloc(oc->prelinked,
+                                         sizeof(SymbolExtra) * count, 8);
+    }
+    else
+#endif
     if (RTS_LINKER_USE_MMAP) {
         n = roundUpToPage(oc->fileSize);
 
-        oc->symbol_extras = m32_alloc(sizeof(SymbolExtra) * count, 8);
+        oc->symbol_extras = m32_alloc(M32_CODE,
+                                      sizeof(SymbolExtra) * count, 8);
         if (oc->symbol_extras == NULL) return 0;
     }
     else {
@@ -2839,7 +3578,12 @@ static int ocAllocateSymbolExtras( ObjectCode* oc, int count, int first )
     }
   }
 
-  if (oc->symbol_extras != NULL) {
+  // a block from the prelinked object cache already holds the extras
+  if (oc->symbol_extras != NULL
+#if defined(PRELINK_CACHE)
+      && !(oc->prelinked != NULL && oc->prelinked->cached)
+#endif
+     ) {
       memset( oc->symbol_extras, 0, sizeof (SymbolExtra) * count );
   }
 
@@ -4841,6 +5585,18 @@ static int getSectionKind_ELF( Elf_Shdr *hdr, int *is_bss )
     return SECTIONKIND_OTHER;
 }
 
+/* The M32 pool to allocate a section from; see Note [M32 Allocator] */
+static M32Pool getSectionPool_ELF( Elf_Shdr *hdr )
+{
+    if (hdr->sh_flags & SHF_EXECINSTR) {
+        return M32_CODE;
+    }
+    if (hdr->sh_flags & SHF_WRITE) {
+        return M32_RWDATA;
+    }
+    return M32_RODATA;
+}
+
 static void *
 mapObjectFileSection (int fd, Elf_Word offset, Elf_Word size,
                       void **mapped_start, StgWord *mapped_size,
@@ -4909,9 +5665,17 @@ ocGetNames_ELF ( ObjectCode* oc )
          /* This is a non-empty .bss section.  Allocate zeroed space for
             it, and set its .sh_offset field such that
             ehdrC + .sh_offset == addr_of_zeroed_space.  */
-          alloc = SECTION_MALLOC;
-          start = stgCallocBytes(1, size, "ocGetNames_ELF(BSS)");
-          mapped_start = start;
+#if defined(PRELINK_CACHE)
+          if (oc->prelinked != NULL) {
+              // the block is zeroed when it is allocated
+              start = prelinkAlloc(oc->prelinked, size, shdr[i].sh_addralign);
+          } else
+#endif
+          {
+              alloc = SECTION_MALLOC;
+              start = stgCallocBytes(1, size, "ocGetNames_ELF(BSS)");
+              mapped_start = start;
+          }
          /*
          debugBelch("BSS section at 0x%x, size %d\n",
                          zspace, shdr[i].sh_size);
@@ -4924,11 +5688,19 @@ ocGetNames_ELF ( ObjectCode* oc )
               start = oc->image + offset;
               alloc = SECTION_NOMEM;
           }
+#if defined(PRELINK_CACHE)
+          else if (oc->prelinked != NULL) {
+              start = prelinkAlloc(oc->prelinked, size, shdr[i].sh_addralign);
+              if (!oc->prelinked->cached) {
+                  memcpy(start, oc->image + offset, size);
+              }
+          }
+#endif
           // use the m32 allocator if either the image is not mapped
           // (i.e. we cannot map the secions separately), or if the section
           // size is small.
           else if (!oc->imageMapped || size < getPageSize() / 3) {
-              start = m32_alloc(size, 8);
+              start = m32_alloc(getSectionPool_ELF(&shdr[i]), size, 8);
               if (start == NULL) goto fail;
               memcpy(start, oc->image + offset, size);
               alloc = SECTION_M32;
@@ -5521,6 +6293,14 @@ do_Elf_Rela_relocations ( ObjectCode* oc, char* ehdrC,
             symbol = strtab + sym.st_name;
             S_tmp = lookupSymbol_( symbol );
             S = (Elf_Addr)S_tmp;
+#if defined(PRELINK_CACHE)
+            // including symbols that resolve to 0, which a later
+            // definition would change
+            if (oc->prelinked != NULL && oc->prelinked->deps != NULL
+                && !lookupHashTable(oc->prelinked->deps, (StgWord)symbol)) {
+               insertHashTable(oc->prelinked->deps, (StgWord)symbol, S_tmp);
+            }
+#endif
 
 #ifdef ELF_FUNCTION_DESC
             /* If a function, already a function descriptor - we would
@@ -5792,6 +6572,363 @@ do_Elf_Rela_relocations ( ObjectCode* oc, char* ehdrC,
    return 1;
 }
 
+#if defined(PRELINK_CACHE)
+/* Note [Prelinked object cache]
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+   With +RTS --linker-cache=<dir>, the linker saves each object it
+   relocates in <dir>, as it is after relocation, and when it loads the
+   same object again it maps the saved copy back in instead of
+   relocating it.
+
+   Relocated code is only correct at the address it was relocated at,
+   and only as long as every symbol it refers to still has the address
+   it had then.  So:
+
+   - The symbol extras and the sections of the object are allocated
+     from one block of memory, Prelinked.region (see prelinkAlloc()),
+     instead of with the m32 allocator, so that the block can be saved
+     and mapped back as a whole.  Where things go in the block depends
+     only on the object file.
+
+   - ocPrelink_ELF() looks for the object in the cache, under a hash of
+     its contents and the -xm address.  The hash is not cryptographic,
+     and a cache may be shared by different builds, so an entry also
+     holds a copy of the object it was made from, and we only use it if
+     that is byte for byte the object we are loading.  If the entry
+     matches, ocPrelink_ELF() maps the block from it (privately, so the
+     cache file is never modified) at the address it had before; if
+     mmap() can't give us that address we treat the entry as missing
+     and allocate a fresh block.
+
+   - ocGetNames_ELF() carves the sections out of the block, copying
+     their contents from the image only if the block is fresh.
+
+   - While relocating a fresh block, do_Elf_Rela_relocations() records
+     the address of every global symbol it looks up in Prelinked.deps.
+     ocResolve_ELF() then saves the block and those addresses in the
+     cache (ocWritePrelinked_ELF()), before the initialisers of the
+     object run.
+
+   - For a block from the cache, ocResolve_ELF() looks up every symbol
+     it depends on instead of relocating (ocCheckPrelinked_ELF()); this
+     also loads the objects defining them, as relocation would.  If all
+     of them have the same address as before, there is nothing more to
+     do.  Otherwise we put the original contents of the sections back
+     and relocate the block as usual, which updates the cache entry.
+
+   Entries are written to a temporary file which is then renamed, so
+   that processes sharing a cache never see a partial entry.  Symbols in
+   shared libraries usually move from run to run because of address
+   space layout randomisation, so objects referring to them directly
+   rarely get a hit.  The cache holds code that we will run, so it must
+   be as trustworthy as the objects themselves.
+*/
+
+typedef struct {
+    char     magic[8];
+    StgWord  imageSize;
+    StgWord  memBase;       // +RTS -xm
+    StgWord  region;        // the address the block was relocated at
+    StgWord  size;
+    StgWord  n_deps;
+    StgWord  offset;        // of the block in the file, page-aligned
+} PrelinkedHeader;
+
+// The header is followed by n_deps PrelinkedDeps, then by a copy of
+// the object (imageSize bytes), then by the block at offset.
+
+typedef struct {
+    StgWord  name;          // offset of the symbol name in the image
+    StgWord  value;
+} PrelinkedDep;
+
+#define PRELINKED_MAGIC "GHCPLK02"
+
+static StgWord prelinkAlign (StgWord align)
+{
+    // the block is page-aligned
+    if (align < 8 || (align & (align - 1)) != 0) return 8;
+    if (align > getPageSize()) return getPageSize();
+    return align;
+}
+
+static void *prelinkAlloc (Prelinked *p, StgWord size, StgWord align)
+{
+    void *start;
+
+    align = prelinkAlign(align);
+    p->used = (p->used + align - 1) & ~(align - 1);
+    start = p->region + p->used;
+    p->used += size;
+    ASSERT(p->used <= p->size);
+    return start;
+}
+
+static void freePrelinked (Prelinked *p)
+{
+    munmap(p->region, p->size);
+    if (p->deps != NULL) {
+        freeHashTable(p->deps, NULL);
+    }
+    stgFree(p->path);
+    stgFree(p);
+}
+
+/* The size of the block for oc: its symbol extras and loaded sections,
+ * laid out as ocAllocateSymbolExtras_ELF() and ocGetNames_ELF() will
+ * allocate them. */
+static StgWord
+ocPrelinkedSize_ELF ( ObjectCode* oc )
+{
+   Elf_Word  i;
+   char*     ehdrC = (char*)(oc->image);
+   Elf_Ehdr* ehdr  = (Elf_Ehdr*) ehdrC;
+   Elf_Shdr* shdr  = (Elf_Shdr*) (ehdrC + ehdr->e_shoff);
+   const Elf_Word shnum = elf_shnum(ehdr);
+   StgWord size = 0, align;
+
+   for (i = 0; i < shnum; i++) {
+      if (shdr[i].sh_type == SHT_SYMTAB) {
+         size = sizeof(SymbolExtra) * (shdr[i].sh_size / sizeof(Elf_Sym));
+         break;
+      }
+   }
+
+   for (i = 0; i < shnum; i++) {
+      int is_bss = FALSE;
+      if (getSectionKind_ELF(&shdr[i], &is_bss) != SECTIONKIND_OTHER
+          && shdr[i].sh_size > 0) {
+         align = prelinkAlign(shdr[i].sh_addralign);
+         size = ((size + align - 1) & ~(align - 1)) + shdr[i].sh_size;
+      }
+   }
+
+   return size;
+}
+
+/* Map the cache entry p->path for oc, if it matches, at the address it
+ * was relocated at.  Returns rtsTrue on success. */
+static rtsBool
+mapPrelinked ( ObjectCode* oc, Prelinked *p )
+{
+   PrelinkedHeader hdr;
+   PrelinkedDep *deps = NULL;
+   char *image = NULL;
+   struct stat st;
+   void *region;
+   StgWord i;
+   int fd;
+
+   fd = open(p->path, O_RDONLY);
+   if (fd == -1) return rtsFalse;
+
+   if (read(fd, &hdr, sizeof(hdr)) != sizeof(hdr)
+       || memcmp(hdr.magic, PRELINKED_MAGIC, sizeof(hdr.magic)) != 0
+       || hdr.imageSize != (StgWord)oc->fileSize
+       || hdr.memBase != RtsFlags.MiscFlags.linkerMemBase
+       || hdr.size != p->size
+       || hdr.n_deps > (StgWord)oc->fileSize
+       || hdr.offset < sizeof(hdr) + sizeof(PrelinkedDep) * hdr.n_deps
+                       + hdr.imageSize
+       || hdr.offset != roundUpToPage(hdr.offset)
+       || fstat(fd, &st) != 0
+       || (StgWord)st.st_size < hdr.offset + hdr.size) {
+      goto fail;
+   }
+
+   deps = stgMallocBytes(sizeof(PrelinkedDep) * (hdr.n_deps + 1),
+                         "mapPrelinked");
+   if (read(fd, deps, sizeof(PrelinkedDep) * hdr.n_deps)
+       != (ssize_t)(sizeof(PrelinkedDep) * hdr.n_deps)) {
+      goto fail;
+   }
+   for (i = 0; i < hdr.n_deps; i++) {
+      if (deps[i].name >= (StgWord)oc->fileSize) goto fail;
+   }
+
+   // the entry must have been made from this very object
+   image = stgMallocBytes(hdr.imageSize, "mapPrelinked");
+   if (read(fd, image, hdr.imageSize) != (ssize_t)hdr.imageSize
+       || memcmp(image, oc->image, hdr.imageSize) != 0) {
+      IF_DEBUG(linker, debugBelch("mapPrelinked: %s is for another object\n",
+                                  p->path));
+      goto fail;
+   }
+   stgFree(image);
+   image = NULL;
+
+   region = mmap((void*)hdr.region, hdr.size, PROT_EXEC|PROT_READ|PROT_WRITE,
+                 MAP_PRIVATE, fd, hdr.offset);
+   if (region == MAP_FAILED) goto fail;
+   if (region != (void*)hdr.region) {
+      munmap(region, hdr.size);
+      goto fail;
+   }
+   close(fd);
+
+   p->region = region;
+   p->cached = rtsTrue;
+   p->deps   = allocHashTable();
+   for (i = 0; i < hdr.n_deps; i++) {
+      insertHashTable(p->deps, (StgWord)(oc->image + deps[i].name),
+                      (void*)deps[i].value);
+   }
+   stgFree(deps);
+   return rtsTrue;
+
+fail:
+   close(fd);
+   if (deps != NULL) stgFree(deps);
+   if (image != NULL) stgFree(image);
+   return rtsFalse;
+}
+
+/* Set up the block for oc's sections, from the cache if possible.  If
+ * no block can be allocated, oc is loaded as usual. */
+static void
+ocPrelink_ELF ( ObjectCode* oc )
+{
+   const char *dir = RtsFlags.MiscFlags.linkerCacheDir;
+   Prelinked *p;
+   StgWord size;
+
+   if (dir == NULL) return;
+
+   size = ocPrelinkedSize_ELF(oc);
+   if (size == 0) return;
+
+   p = stgMallocBytes(sizeof(Prelinked), "ocPrelink_ELF");
+   p->size = size;
+   p->used = 0;
+   p->path = stgMallocBytes(strlen(dir) + 64, "ocPrelink_ELF(path)");
+   sprintf(p->path, "%s/%016" FMT_HexWord "-%" FMT_HexWord ".o", dir,
+           hashBytes(oc->image, oc->fileSize),
+           RtsFlags.MiscFlags.linkerMemBase);
+
+   if (mapPrelinked(oc, p)) {
+      IF_DEBUG(linker, debugBelch("ocPrelink_ELF: %" PATH_FMT ": mapped %s\n",
+                                  oc->fileName, p->path));
+   } else {
+      p->region = mmapForLinker(size, MAP_ANONYMOUS, -1, 0);
+      if (p->region == NULL) {
+         stgFree(p->path);
+         stgFree(p);
+         return;
+      }
+      p->cached = rtsFalse;
+      p->deps   = allocHashTable();
+   }
+
+   oc->prelinked = p;
+}
+
+/* Check that every symbol the block from the cache was relocated
+ * against still has the same address.  If not, put the original
+ * contents of the sections back, ready to be relocated afresh. */
+static rtsBool
+ocCheckPrelinked_ELF ( ObjectCode* oc )
+{
+   Prelinked *p = oc->prelinked;
+   char*     ehdrC = (char*)(oc->image);
+   Elf_Ehdr* ehdr  = (Elf_Ehdr*) ehdrC;
+   Elf_Shdr* shdr  = (Elf_Shdr*) (ehdrC + ehdr->e_shoff);
+   const Elf_Word shnum = elf_shnum(ehdr);
+   StgWord *keys;
+   int i, n;
+   rtsBool ok = rtsTrue;
+
+   n = keyCountHashTable(p->deps);
+   keys = stgMallocBytes(sizeof(StgWord) * (n + 1), "ocCheckPrelinked_ELF");
+   n = keysHashTable(p->deps, keys, n);
+   for (i = 0; i < n; i++) {
+      if (lookupSymbol_((SymbolName*)keys[i])
+          != lookupHashTable(p->deps, keys[i])) {
+         IF_DEBUG(linker, debugBelch("ocCheckPrelinked_ELF: `%s' has moved\n",
+                                     (char*)keys[i]));
+         ok = rtsFalse;
+         break;
+      }
+   }
+   stgFree(keys);
+   freeHashTable(p->deps, NULL);
+
+   if (ok) {
+      p->deps = NULL;
+      return rtsTrue;
+   }
+
+   p->deps   = allocHashTable();
+   p->cached = rtsFalse;
+   memset(p->region, 0, p->size);
+   for (i = 0; i < (int)shnum; i++) {
+      int is_bss = FALSE;
+      if (getSectionKind_ELF(&shdr[i], &is_bss) != SECTIONKIND_OTHER
+          && !is_bss && shdr[i].sh_size > 0) {
+         memcpy(oc->sections[i].start, ehdrC + shdr[i].sh_offset,
+                shdr[i].sh_size);
+      }
+   }
+   return rtsFalse;
+}
+
+/* Save oc's freshly relocated block in the cache, along with the
+ * addresses it was relocated against.  Failing to is not an error. */
+static void
+ocWritePrelinked_ELF ( ObjectCode* oc )
+{
+   Prelinked *p = oc->prelinked;
+   PrelinkedHeader hdr;
+   PrelinkedDep *deps;
+   StgWord *keys;
+   char *tmp;
+   FILE *f;
+   int i, n, ok;
+
+   n = keyCountHashTable(p->deps);
+   keys = stgMallocBytes(sizeof(StgWord) * (n + 1), "ocWritePrelinked_ELF");
+   deps = stgMallocBytes(sizeof(PrelinkedDep) * (n + 1),
+                         "ocWritePrelinked_ELF");
+   n = keysHashTable(p->deps, keys, n);
+   for (i = 0; i < n; i++) {
+      deps[i].name  = keys[i] - (StgWord)oc->image;
+      deps[i].value = (StgWord)lookupHashTable(p->deps, keys[i]);
+   }
+   stgFree(keys);
+
+   memcpy(hdr.magic, PRELINKED_MAGIC, sizeof(hdr.magic));
+   hdr.imageSize = oc->fileSize;
+   hdr.memBase   = RtsFlags.MiscFlags.linkerMemBase;
+   hdr.region    = (StgWord)p->region;
+   hdr.size      = p->size;
+   hdr.n_deps    = n;
+   hdr.offset    = roundUpToPage(sizeof(hdr) + sizeof(PrelinkedDep) * n
+                                 + oc->fileSize);
+
+   // write to a temporary file, then rename it into place
+   tmp = stgMallocBytes(strlen(p->path) + 64, "ocWritePrelinked_ELF");
+   sprintf(tmp, "%s.%d.%p", p->path, (int)getpid(), (void*)oc);
+   f = fopen(tmp, "wb");
+   ok = f != NULL
+       && fwrite(&hdr, sizeof(hdr), 1, f) == 1
+       && (n == 0 || fwrite(deps, sizeof(PrelinkedDep), n, f) == (size_t)n)
+       && fwrite(oc->image, 1, oc->fileSize, f) == (size_t)oc->fileSize
+       && fseek(f, hdr.offset, SEEK_SET) == 0
+       && fwrite(p->region, 1, p->size, f) == p->size;
+   if (f != NULL && fclose(f) != 0) {
+      ok = 0;
+   }
+   if (ok && rename(tmp, p->path) == 0) {
+      IF_DEBUG(linker, debugBelch("ocWritePrelinked_ELF: wrote %s\n",
+                                  p->path));
+   } else if (f != NULL) {
+      unlink(tmp);
+   }
+   stgFree(tmp);
+   stgFree(deps);
+}
+#endif
+
 static int
 ocResolve_ELF ( ObjectCode* oc )
 {
@@ -5802,6 +6939,15 @@ ocResolve_ELF ( ObjectCode* oc )
    Elf_Shdr* shdr  = (Elf_Shdr*) (ehdrC + ehdr->e_shoff);
    const Elf_Word shnum = elf_shnum(ehdr);
 
+#if defined(PRELINK_CACHE)
+   if (oc->prelinked != NULL && oc->prelinked->cached
+       && ocCheckPrelinked_ELF(oc)) {
+      IF_DEBUG(linker, debugBelch("ocResolve_ELF: %" PATH_FMT
+                                  ": relocated already\n", oc->fileName));
+      return 1;
+   }
+#endif
+
    /* Process the relocation sections. */
    for (i = 0; i < shnum; i++) {
       if (shdr[i].sh_type == SHT_REL) {
@@ -5819,8 +6965,60 @@ ocResolve_ELF ( ObjectCode* oc )
    ocFlushInstructionCache( oc );
 #endif
 
+#if defined(PRELINK_CACHE)
+   if (oc->prelinked != NULL && oc->prelinked->deps != NULL) {
+      ocWritePrelinked_ELF(oc);
+      freeHashTable(oc->prelinked->deps, NULL);
+      oc->prelinked->deps = NULL;
+   }
+#endif
+
+   return 1;
+}
+
+#if defined(LAZY_ARCHIVES) && defined(PARALLEL_RESOLVE)
+/* Load the lazy archive members defining the symbols that relocating oc
+ * may look up.  See Note [Lazy archive members]. */
+static int
+ocLoadLazyMembers_ELF ( ObjectCode* oc )
+{
+   Elf_Word  i;
+   int       j, nent;
+   char*     ehdrC = (char*)(oc->image);
+   Elf_Ehdr* ehdr  = (Elf_Ehdr*) ehdrC;
+   Elf_Shdr* shdr  = (Elf_Shdr*) (ehdrC + ehdr->e_shoff);
+   const Elf_Word shnum = elf_shnum(ehdr);
+   Elf_Sym*  stab;
+   char*     strtab;
+   SymbolName* nm;
+   RtsSymbolInfo *pinfo;
+
+   for (i = 0; i < shnum; i++) {
+      if (shdr[i].sh_type != SHT_SYMTAB) continue;
+
+      stab   = (Elf_Sym*) (ehdrC + shdr[i].sh_offset);
+      strtab = ehdrC + shdr[shdr[i].sh_link].sh_offset;
+      nent   = shdr[i].sh_size / sizeof(Elf_Sym);
+
+      for (j = 0; j < nent; j++) {
+         // Only symbols oc needs from elsewhere: an archive member that
+         // also defines one of oc's own symbols need not be loaded.
+         if (ELF_ST_BIND(stab[j].st_info) == STB_LOCAL) continue;
+         if (stab[j].st_shndx != SHN_UNDEF) continue;
+         nm = strtab + stab[j].st_name;
+         if (*nm == '\0') continue;
+
+         pinfo = lookupStrOpenHashTable(symhash, nm);
+         if (pinfo && pinfo->owner && pinfo->owner->lazy
+             && !loadLazyMember(pinfo->owner)) {
+            errorBelch("Could not on-demand load symbol '%s'\n", nm);
+            return 0;
+         }
+      }
+   }
    return 1;
 }
+#endif
 
 static int ocRunInit_ELF( ObjectCode *oc )
 {
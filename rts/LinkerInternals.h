@@ -129,6 +129,19 @@ typedef struct _ObjectCode {
     /* flag used when deciding whether to unload an object file */
     int        referenced;
 
+    /* If this object is a member of an archive that was indexed lazily,
+       the archive and the offset of the member's contents in it.  lazy
+       is non-zero until the member has been loaded from the archive.
+       See Note [Lazy archive members] in Linker.c. */
+    struct _LazyArchive *archive;
+    size_t     archiveOffset;
+    int        lazy;
+
+    /* If the sections of this object were allocated for the prelinked
+       object cache, the block they live in.  See Note [Prelinked object
+       cache] in Linker.c. */
+    struct _Prelinked *prelinked;
+
     /* record by how much image has been deliberately misaligned
        after allocation, so that we can use realloc */
     int        misalignment;
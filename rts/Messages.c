@@ -14,16 +14,37 @@
 #include "Threads.h"
 #include "RaiseAsync.h"
 #include "sm/Storage.h"
+#include "BlackHoles.h"
 
 /* ----------------------------------------------------------------------------
    Send a message to another Capability
+
+   Note [Capability inbox]
+   ~~~~~~~~~~~~~~~~~~~~~~~
+   cap->inbox is a lock-free stack of messages: any number of
+   Capabilities push onto it with a CAS in sendMessage(), and the owner
+   of cap takes the whole stack at once with an atomic exchange in
+   scheduleProcessInbox(), and then executes the batch of messages
+   without any locks held.
+
+   The invariant we have to keep is that a Capability never goes idle
+   with messages in its inbox.  The owner checks the inbox under
+   cap->lock in releaseCapability_() as the last thing before it goes
+   idle, so the sender of a message has to take cap->lock and either
+   interrupt the owner, or, if there isn't one, wake up a worker to run
+   the Capability.  But only the sender that finds the inbox empty
+   needs to do this: a message pushed on top of other messages will be
+   taken in the same exchange as the message below it, whose sender has
+   already done (or is about to do) the waking up.  So the lock and the
+   interrupt are paid once per batch of messages rather than once per
+   message, and senders to a busy Capability don't contend on its lock.
    ------------------------------------------------------------------------- */
 
 #ifdef THREADED_RTS
 
 void sendMessage(Capability *from_cap, Capability *to_cap, Message *msg)
 {
-    ACQUIRE_LOCK(&to_cap->lock);
+    Message *old;
 
 #ifdef DEBUG
     {
@@ -38,11 +59,20 @@ void sendMessage(Capability *from_cap, Capability *to_cap, Message *msg)
     }
 #endif
 
-    msg->link = to_cap->inbox;
-    to_cap->inbox = msg;
-
     recordClosureMutated(from_cap,(StgClosure*)msg);
 
+    do {
+        old = (Message*)VOLATILE_LOAD(&to_cap->inbox);
+        msg->link = old;
+    } while (cas((StgVolatilePtr)&to_cap->inbox,
+                 (StgWord)old, (StgWord)msg) != (StgWord)old);
+
+    // Someone else is already waking up to_cap for the messages below
+    // ours.  See Note [Capability inbox].
+    if (old != (Message*)END_TSO_QUEUE) return;
+
+    ACQUIRE_LOCK(&to_cap->lock);
+
     if (to_cap->running_task == NULL) {
         to_cap->running_task = myTask();
             // precond for releaseCapability_()
@@ -258,6 +288,8 @@ loop:
         debugTraceCap(DEBUG_sched, cap, "thread %d blocked on thread %d",
                       (W_)msg->tso->id, (W_)owner->id);
 
+        recordBlackHoleBlock(bh);
+
         return 1; // blocked
     }
     else if (info == &stg_BLOCKING_QUEUE_CLEAN_info ||
@@ -297,6 +329,8 @@ loop:
             promoteInRunQueue(cap, owner);
         }
 
+        recordBlackHoleBlock(bh);
+
         return 1; // blocked
     }
 
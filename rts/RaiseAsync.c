@@ -493,6 +493,20 @@ check_target:
         // and now retry, the thread should be runnable.
         goto retry;
 
+#if defined(THREADED_RTS)
+    case ThreadStealable:
+        // The thread is in our steal_queue, or another Capability has
+        // just stolen it (see Note [Thread stealing] in Schedule.c).
+        // Take our threads back, and if the target wasn't among them
+        // wait for the thief to finish taking it before we retry.
+        reclaimStealableThreads(cap);
+        while (target->why_blocked == ThreadStealable) {
+            busy_wait_nop();
+            load_load_barrier();
+        }
+        goto retry;
+#endif
+
     default:
         barf("throwTo: unrecognised why_blocked (%d)", target->why_blocked);
     }
@@ -676,6 +690,14 @@ removeFromQueues(Capability *cap, StgTSO *tso)
   case ThreadMigrating:
       return;
 
+#if defined(THREADED_RTS)
+  case ThreadStealable:
+      // We hold all the Capabilities, so we can take the thread back
+      // from the steal_queue of its Capability.
+      reclaimStealableThreads(tso->cap);
+      return;
+#endif
+
   case BlockedOnSTM:
     // Be careful: nothing to do here!  We tell the scheduler that the
     // thread is runnable and we leave it to the stack-walking code to
@@ -712,6 +734,10 @@ removeFromQueues(Capability *cap, StgTSO *tso)
   case BlockedOnWrite:
 #if defined(mingw32_HOST_OS)
   case BlockedOnDoProc:
+#endif
+#if !defined(mingw32_HOST_OS)
+      // it may have moved from blocked_queue to the epoll set
+      if (removeIOWaiter(tso)) goto done;
 #endif
       removeThreadFromDeQueue(cap, &blocked_queue_hd, &blocked_queue_tl, tso);
 #if defined(mingw32_HOST_OS)
@@ -723,7 +749,9 @@ removeFromQueues(Capability *cap, StgTSO *tso)
       goto done;
 
   case BlockedOnDelay:
-        removeThreadFromQueue(cap, &sleeping_queue, tso);
+#if !defined(mingw32_HOST_OS)
+        removeSleepingThread(tso);
+#endif
         goto done;
 #endif
 
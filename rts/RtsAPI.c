@@ -620,3 +620,21 @@ void rts_done (void)
     freeMyTask();
 }
 
+/* ----------------------------------------------------------------------------
+   Thread priorities, see Note [Thread priorities] in Schedule.c.
+
+   tid is a ThreadId (not a ThreadId#), whose only field is the TSO.
+   ------------------------------------------------------------------------- */
+
+void
+rts_setThreadPriority (Capability *cap, HaskellObj tid, HsInt priority)
+{
+    setThreadPriority(cap, (StgTSO *)UNTAG_CLOSURE(tid)->payload[0], priority);
+}
+
+HsInt
+rts_getThreadPriority (HaskellObj tid)
+{
+    return getThreadPriority((StgTSO *)UNTAG_CLOSURE(tid)->payload[0]);
+}
+
@@ -207,6 +207,7 @@ void initRtsFlagsDefaults(void)
     RtsFlags.TraceFlags.sparks_sampled= rtsFalse;
     RtsFlags.TraceFlags.sparks_full   = rtsFalse;
     RtsFlags.TraceFlags.user          = rtsFalse;
+    RtsFlags.TraceFlags.blackholes    = rtsFalse;
 #endif
 
 #ifdef PROFILING
@@ -220,10 +221,13 @@ void initRtsFlagsDefaults(void)
     RtsFlags.MiscFlags.install_signal_handlers = rtsTrue;
     RtsFlags.MiscFlags.machineReadable = rtsFalse;
     RtsFlags.MiscFlags.linkerMemBase    = 0;
+    RtsFlags.MiscFlags.linkerThreads    = 1;
+    RtsFlags.MiscFlags.linkerCacheDir   = NULL;
 
 #ifdef THREADED_RTS
     RtsFlags.ParFlags.nCapabilities     = 1;
     RtsFlags.ParFlags.migrate           = rtsTrue;
+    RtsFlags.ParFlags.stealThreads      = rtsFalse;
     RtsFlags.ParFlags.parGcEnabled      = 1;
     RtsFlags.ParFlags.parGcGen          = 0;
     RtsFlags.ParFlags.parGcLoadBalancingEnabled = rtsTrue;
@@ -231,6 +235,9 @@ void initRtsFlagsDefaults(void)
     RtsFlags.ParFlags.parGcNoSyncWithIdle   = 0;
     RtsFlags.ParFlags.parGcThreads      = 0; /* defaults to -N */
     RtsFlags.ParFlags.setAffinity       = 0;
+    RtsFlags.ParFlags.spareWorkers      = 0;
+    RtsFlags.ParFlags.maxSpins          = 1000;
+    RtsFlags.ParFlags.eagerBlackholeThreshold = 0;
 #endif
 
 #if defined(THREADED_RTS)
@@ -338,6 +345,7 @@ usage_text[] = {
 "                p    par spark events (sampled)",
 "                f    par spark events (full detail)",
 "                u    user events (emitted from Haskell code)",
+"                b    blackhole contention statistics",
 "                a    all event classes above",
 "                m    store all events in memory",
 #  ifdef DEBUG
@@ -402,6 +410,14 @@ usage_text[] = {
 "  -qn<n>    Use <n> threads for parallel GC (defaults to value of -N)",
 "  -qa       Use the OS to set thread affinity (experimental)",
 "  -qm       Don't automatically migrate threads between CPUs",
+"  -qt       Let idle CPUs steal threads from busy ones (experimental)",
+"  -qp<n>    Start <n> spare worker threads for each processor (default: 0)",
+"  -qs<n>    Spin at most <n> times before sleeping while waiting for a",
+"            processor, e.g. to return from a foreign call",
+"            (0 disables, default: 1000)",
+"  -qe<n>    Eagerly blackhole thunks compiled with -fadaptive-blackholing",
+"            once their info table has been contended <n> times",
+"            (0 disables, default: 0)",
 "  -qi<n>    If a processor has been idle for the last <n> GCs, do not",
 "            wake it up for a non-load-balancing parallel GC.",
 "            (0 disables,  default: 0)",
@@ -416,6 +432,8 @@ usage_text[] = {
 #endif
 "  --install-signal-handlers=<yes|no>",
 "            Install signal handlers (default: yes)",
+"  --linker-cache=<dir>",
+"            Cache the objects relocated by the GHCi linker in <dir>",
 #if defined(THREADED_RTS)
 "  -e<n>     Maximum number of outstanding local sparks (default: 4096)",
 #endif
@@ -423,6 +441,10 @@ usage_text[] = {
 "  -xm       Base address to mmap memory in the GHCi linker",
 "            (hex; must be <80000000)",
 #endif
+#if defined(THREADED_RTS)
+"  -xl[<n>]  Relocate objects in the GHCi linker using <n> threads",
+"            (default: 1; -xl alone uses all processors)",
+#endif
 "  -xq       The allocation limit given to a thread after it receives",
 "            an AllocationLimitExceeded exception. (default: 100k)",
 "",
@@ -749,6 +771,19 @@ error = rtsTrue;
                       OPTION_UNSAFE;
                       RtsFlags.MiscFlags.install_signal_handlers = rtsFalse;
                   }
+                  else if (!strncmp("linker-cache=",
+                                    &rts_argv[arg][2], 13)) {
+                      OPTION_UNSAFE;
+                      if (rts_argv[arg][15] == '\0') {
+                          errorBelch("%s: requires a directory",
+                                     rts_argv[arg]);
+                          error = rtsTrue;
+                      } else {
+                          RtsFlags.MiscFlags.linkerCacheDir =
+                              stgStrndup(rts_argv[arg] + 15,
+                                         strlen(rts_argv[arg] + 15));
+                      }
+                  }
                   else if (strequal("machine-readable",
                                &rts_argv[arg][2])) {
                       OPTION_UNSAFE;
@@ -1220,6 +1255,21 @@ error = rtsTrue;
                     case 'm':
                         RtsFlags.ParFlags.migrate = rtsFalse;
                         break;
+                    case 't':
+                        RtsFlags.ParFlags.stealThreads = rtsTrue;
+                        break;
+                    case 'p':
+                        RtsFlags.ParFlags.spareWorkers
+                            = strtol(rts_argv[arg]+3, (char **) NULL, 10);
+                        break;
+                    case 's':
+                        RtsFlags.ParFlags.maxSpins
+                            = strtol(rts_argv[arg]+3, (char **) NULL, 10);
+                        break;
+                    case 'e':
+                        RtsFlags.ParFlags.eagerBlackholeThreshold
+                            = strtol(rts_argv[arg]+3, (char **) NULL, 10);
+                        break;
                     case 'w':
                         // -qw was removed; accepted for backwards compat
                         break;
@@ -1320,6 +1370,25 @@ error = rtsTrue;
                     break;
 #endif
 
+                case 'l': /* linkerThreads */
+                    OPTION_UNSAFE;
+                    THREADED_BUILD_ONLY(
+                        if (rts_argv[arg][3] == '\0') {
+                            RtsFlags.MiscFlags.linkerThreads =
+                                getNumberOfProcessors();
+                        } else {
+                            int threads;
+                            threads = strtol(rts_argv[arg]+3,
+                                             (char **) NULL, 10);
+                            if (threads <= 0) {
+                                errorBelch("-xl must be 1 or greater");
+                                error = rtsTrue;
+                            } else {
+                                RtsFlags.MiscFlags.linkerThreads = threads;
+                            }
+                        }
+                        ) break;
+
                 case 'c': /* Debugging tool: show current cost centre on
                            an exception */
                     OPTION_SAFE;
@@ -1476,6 +1545,11 @@ static void normaliseRtsOpts (void)
         errorBelch("GC threads (-qn) must be between 1 and the value of -N");
         errorUsage();
     }
+
+    // -qm turns off thread stealing (-qt) too
+    if (!RtsFlags.ParFlags.migrate) {
+        RtsFlags.ParFlags.stealThreads = rtsFalse;
+    }
 #endif
 }
 
@@ -1821,6 +1895,7 @@ static void read_trace_flags(const char *arg)
             RtsFlags.TraceFlags.sparks_sampled = enabled;
             RtsFlags.TraceFlags.sparks_full    = enabled;
             RtsFlags.TraceFlags.user           = enabled;
+            RtsFlags.TraceFlags.blackholes     = enabled;
             enabled = rtsTrue;
             break;
 
@@ -1852,6 +1927,10 @@ static void read_trace_flags(const char *arg)
             RtsFlags.TraceFlags.in_memory = enabled;
             enabled = rtsTrue;
             break;
+        case 'b':
+            RtsFlags.TraceFlags.blackholes = enabled;
+            enabled = rtsTrue;
+            break;
         default:
             errorBelch("unknown trace option: %c",*c);
             break;
@@ -36,6 +36,8 @@
 #include "LinkerInternals.h"
 #include "LibdwPool.h"
 #include "sm/CNF.h"
+#include "BlackHoles.h"
+#include "AdjustorPool.h"
 
 #if defined(PROFILING)
 # include "ProfHeap.h"
@@ -184,6 +186,12 @@ hs_init_ghc(int *argc, char **argv[], RtsConfig rts_config)
     /* initialise the stable pointer table */
     initStableTables();
 
+    /* initialise blackhole contention tracking, if enabled */
+    initBlackHoles();
+
+    /* initialise the pools of adjustor memory */
+    initAdjustorPool();
+
     /* Add some GC roots for things in the base package that the RTS
      * knows about.  We don't know whether these turn out to be CAFs
      * or refer to CAFs, but we have to assume that they might.
@@ -363,6 +371,11 @@ hs_exit_(rtsBool wait_foreign)
     /* stop timing the shutdown, we're about to print stats */
     stat_endExit();
 
+    /* emit blackhole contention statistics (needs tracing) */
+    exitBlackHoles();
+
+    exitAdjustorPool();
+
     /* shutdown the hpc support (if needed) */
     exitHpc();
 
@@ -569,6 +569,7 @@
       SymI_HasProto(getOrSetLibHSghcFastStringTable)                    \
       SymI_HasProto(getGCStats)                                         \
       SymI_HasProto(getGCStatsEnabled)                                  \
+      SymI_HasProto(getLinkerMemStats)                                  \
       SymI_HasProto(genericRaise)                                       \
       SymI_HasProto(getProgArgv)                                        \
       SymI_HasProto(getFullProgArgv)                                    \
@@ -697,6 +698,9 @@
       SymI_HasProto(rts_mkWord16)                                       \
       SymI_HasProto(rts_mkWord32)                                       \
       SymI_HasProto(rts_mkWord64)                                       \
+      SymI_HasProto(rts_setCapabilityTimeSlice)                         \
+      SymI_HasProto(rts_setThreadPriority)                              \
+      SymI_HasProto(rts_getThreadPriority)                              \
       SymI_HasProto(rts_unlock)                                         \
       SymI_HasProto(rts_unsafeGetMyCapability)                          \
       SymI_HasProto(rtsSupportsBoundThreads)                            \
@@ -820,6 +824,8 @@
       SymI_HasProto(stg_takeMVarzh)                                     \
       SymI_HasProto(stg_readMVarzh)                                     \
       SymI_HasProto(stg_threadStatuszh)                                 \
+      SymI_HasProto(stg_setThreadPriorityzh)                            \
+      SymI_HasProto(stg_threadPriorityzh)                               \
       SymI_HasProto(stg_tryPutMVarzh)                                   \
       SymI_HasProto(stg_tryTakeMVarzh)                                  \
       SymI_HasProto(stg_tryReadMVarzh)                                  \
@@ -850,6 +856,7 @@
       SymI_NeedsDataProto(rts_breakpoint_io_action)                     \
       SymI_NeedsDataProto(rts_stop_next_breakpoint)                     \
       SymI_NeedsDataProto(rts_stop_on_exception)                        \
+      SymI_NeedsDataProto(eager_blackhole_table)                        \
       SymI_HasProto(stopTimer)                                          \
       SymI_HasProto(n_capabilities)                                     \
       SymI_HasProto(enabled_capabilities)                               \
@@ -39,6 +39,7 @@
 #include "RaiseAsync.h"
 #include "Threads.h"
 #include "Timer.h"
+#include "GetTime.h"
 #include "ThreadPaused.h"
 #include "Messages.h"
 #include "Stable.h"
@@ -66,10 +67,9 @@
  * -------------------------------------------------------------------------- */
 
 #if !defined(THREADED_RTS)
-// Blocked/sleeping thrads
+// Blocked threads (sleeping threads are in posix/Select.c)
 StgTSO *blocked_queue_hd = NULL;
 StgTSO *blocked_queue_tl = NULL;
-StgTSO *sleeping_queue = NULL;    // perhaps replace with a hash table?
 #endif
 
 /* Set to true when the latest garbage collection failed to reclaim
@@ -126,6 +126,8 @@ static void acquireAllCapabilities(Capability *cap, Task *task);
 static void releaseAllCapabilities(uint32_t n, Capability *cap, Task *task);
 static void startWorkerTasks (uint32_t from USED_IF_THREADS,
                                 uint32_t to USED_IF_THREADS);
+static void startSpareWorkerTasks (uint32_t from USED_IF_THREADS,
+                                   uint32_t to USED_IF_THREADS);
 #endif
 static void scheduleStartSignalHandlers (Capability *cap);
 static void scheduleCheckBlockedThreads (Capability *cap);
@@ -133,9 +135,12 @@ static void scheduleProcessInbox(Capability **cap);
 static void scheduleDetectDeadlock (Capability **pcap, Task *task);
 static void schedulePushWork(Capability *cap, Task *task);
 #if defined(THREADED_RTS)
+static uint32_t offerThreads (Capability *cap);
+static rtsBool stealThread (Capability *cap);
 static void scheduleActivateSpark(Capability *cap);
 #endif
 static void schedulePostRunThread(Capability *cap, StgTSO *t);
+static void startTimeSlice(Capability *cap, StgTSO *t);
 static rtsBool scheduleHandleHeapOverflow( Capability *cap, StgTSO *t );
 static rtsBool scheduleHandleYield( Capability *cap, StgTSO *t,
                                     uint32_t prev_what_next );
@@ -391,6 +396,7 @@ run_thread:
     // CurrentTSO is the thread to run. It might be different if we
     // loop back to run_thread, so make sure to set CurrentTSO after
     // that.
+    startTimeSlice(cap, t);
     cap->r.rCurrentTSO = t;
 
     startHeapProfTimer();
@@ -418,6 +424,8 @@ run_thread:
     dirty_TSO(cap,t);
     dirty_STACK(cap,t->stackobj);
 
+    t->flags |= TSO_HAS_RUN;
+
     switch (recent_activity)
     {
     case ACTIVITY_DONE_GC: {
@@ -442,8 +450,12 @@ run_thread:
         recent_activity = ACTIVITY_YES;
     }
 
+    // the ticker may be skipping ticks, see Note [Tickless idle]
+    wakeTimerIfIdle();
+
     traceEventRunThread(cap, t);
 
+switch_evaluator:
     switch (prev_what_next) {
 
     case ThreadKilled:
@@ -470,6 +482,14 @@ run_thread:
         barf("schedule: invalid what_next field");
     }
 
+    // See Note [Switching evaluators]
+    if (ret == ThreadYielding
+        && cap->r.rCurrentTSO->what_next != prev_what_next
+        && cap->context_switch == 0 && cap->interrupt == 0) {
+        prev_what_next = cap->r.rCurrentTSO->what_next;
+        goto switch_evaluator;
+    }
+
     cap->in_haskell = rtsFalse;
 
     // The TSO might have moved, eg. if it re-entered the RTS and a GC
@@ -561,15 +581,17 @@ run_thread:
 static void
 removeFromRunQueue (Capability *cap, StgTSO *tso)
 {
+    uint32_t p = tso->run_queue_priority;
+
     if (tso->block_info.prev == END_TSO_QUEUE) {
-        ASSERT(cap->run_queue_hd == tso);
-        cap->run_queue_hd = tso->_link;
+        ASSERT(cap->run_queue_hd[p] == tso);
+        cap->run_queue_hd[p] = tso->_link;
     } else {
         setTSOLink(cap, tso->block_info.prev, tso->_link);
     }
     if (tso->_link == END_TSO_QUEUE) {
-        ASSERT(cap->run_queue_tl == tso);
-        cap->run_queue_tl = tso->block_info.prev;
+        ASSERT(cap->run_queue_tl[p] == tso);
+        cap->run_queue_tl[p] = tso->block_info.prev;
     } else {
         setTSOPrev(cap, tso->_link, tso->block_info.prev);
     }
@@ -586,6 +608,113 @@ promoteInRunQueue (Capability *cap, StgTSO *tso)
     pushOnRunQueue(cap, tso);
 }
 
+/* -----------------------------------------------------------------------------
+ * Thread priorities
+ *
+ * Note [Thread priorities]
+ * ~~~~~~~~~~~~~~~~~~~~~~~~
+ * Each thread has a priority, tso->priority: ThreadPriorityHigh,
+ * ThreadPriorityNormal (the default) or ThreadPriorityLow.  Each
+ * Capability has a run queue for each priority (cap->run_queue_hd[p]
+ * etc.), and appendToRunQueue() and pushOnRunQueue() put a thread on
+ * the queue for its priority, so within a priority we still have
+ * round-robin scheduling, with woken-up threads at the front.
+ *
+ * popRunQueue() takes the next thread from the highest priority queue
+ * that isn't empty.  To keep lower priority threads from starving, it
+ * ages them: cap->run_queue_skipped[p] counts how many threads have
+ * been run ahead of queue p while it had threads waiting, and once it
+ * reaches PRIORITY_AGING_LIMIT the next thread comes from queue p
+ * instead.  So under load each priority gets at least a 1 in
+ * PRIORITY_AGING_LIMIT+1 share of the time slices left over by the
+ * higher priorities, and the high priority threads are never kept
+ * waiting behind more than one lower priority time slice.
+ *
+ * The priority is set with setThreadPriority() (the setThreadPriority#
+ * primop, GHC.Conc.setThreadPriority, and rts_setThreadPriority() in
+ * the C API).  A Capability can only touch its own run queues, so the
+ * new priority takes effect straight away if the thread is on our own
+ * run queue, and otherwise the next time the thread is put on a run
+ * queue, i.e. at the end of its time slice or when it wakes up.
+ * That's why a queued thread records the queue it is on in
+ * tso->run_queue_priority.
+ *
+ * New threads start at ThreadPriorityNormal.
+ * -------------------------------------------------------------------------- */
+
+void
+setThreadPriority (Capability *cap, StgTSO *tso, HsInt priority)
+{
+    StgTSO *t;
+
+    if (priority < 0 || priority >= N_THREAD_PRIORITIES) {
+        errorBelch("setThreadPriority: invalid priority %" FMT_Int,
+                   priority);
+        return;
+    }
+
+    tso->priority = (StgWord16)priority;
+
+    // Move the thread to the right run queue if it's on one of ours.
+    if (tso->cap != cap || tso->why_blocked != NotBlocked ||
+        tso->run_queue_priority == priority) {
+        return;
+    }
+    for (t = cap->run_queue_hd[tso->run_queue_priority];
+         t != END_TSO_QUEUE; t = t->_link) {
+        if (t == tso) {
+            removeFromRunQueue(cap, tso);
+            appendToRunQueue(cap, tso);
+            break;
+        }
+    }
+}
+
+HsInt
+getThreadPriority (StgTSO *tso)
+{
+    return tso->priority;
+}
+
+/* -----------------------------------------------------------------------------
+ * Time slices
+ *
+ * Note [Time slices]
+ * ~~~~~~~~~~~~~~~~~~
+ * Each Capability keeps its own time slice: when it starts running a
+ * thread other than the one the current slice belongs to, or the
+ * thread has used up its slice already, it reads the clock and starts
+ * a new slice (startTimeSlice()).  On each tick the timer context
+ * switches only the capabilities whose slice has run out
+ * (preemptCapabilities()), rather than every capability at once, so
+ * capabilities don't switch in lockstep and a thread that has only
+ * just been scheduled isn't preempted straight away.
+ *
+ * The slice length is per Capability (cap->time_slice), +RTS -C by
+ * default, and can be changed with rts_setCapabilityTimeSlice(), e.g.
+ * to give the capabilities running latency-sensitive threads shorter
+ * slices than those running batch work.  Slices are still checked on
+ * timer ticks, so they are rounded up to the tick interval (+RTS -V).
+ *
+ * With +RTS -C0 we switch on every heap check instead, and don't
+ * read the clock at all.
+ * -------------------------------------------------------------------------- */
+
+static void
+startTimeSlice (Capability *cap, StgTSO *t)
+{
+    Time now;
+
+    if (RtsFlags.ConcFlags.ctxtSwitchTicks == 0) return;
+
+    now = getProcessElapsedTime();
+    if (t->id != cap->slice_thread ||
+        now - cap->slice_start >= cap->time_slice) {
+        cap->slice_thread = t->id;
+        cap->slice_start  = now;
+    }
+}
+
 /* ----------------------------------------------------------------------------
  * Setting up the scheduler loop
  * ------------------------------------------------------------------------- */
@@ -616,6 +745,10 @@ scheduleFindWork (Capability **pcap)
     scheduleCheckBlockedThreads(*pcap);
 
 #if defined(THREADED_RTS)
+    reclaimStealableThreads(*pcap);
+    if (emptyRunQueue(*pcap) && RtsFlags.ParFlags.stealThreads) {
+        stealThread(*pcap);
+    }
     if (emptyRunQueue(*pcap)) { scheduleActivateSpark(*pcap); }
 #endif
 }
@@ -700,7 +833,7 @@ schedulePushWork(Capability *cap USED_IF_THREADS,
 #if defined(THREADED_RTS)
 
     Capability *free_caps[n_capabilities], *cap0;
-    uint32_t i, n_wanted_caps, n_free_caps;
+    uint32_t i, n_wanted_caps, n_free_caps, pass, p;
 
     uint32_t spare_threads = cap->n_run_queue > 0 ? cap->n_run_queue - 1 : 0;
 
@@ -708,31 +841,51 @@ schedulePushWork(Capability *cap USED_IF_THREADS,
     if (!RtsFlags.ParFlags.migrate) {
         spare_threads = 0;
     }
+    // with +RTS -qt we don't push threads, we offer them to be stolen
+    // and wake up free Capabilities to steal them.
+    else if (RtsFlags.ParFlags.stealThreads) {
+        spare_threads = offerThreads(cap);
+    }
 
     // Figure out how many capabilities we want to wake up.  We need at least
     // sparkPoolSize(cap) plus the number of spare threads we have.
     n_wanted_caps = sparkPoolSizeCap(cap) + spare_threads;
     if (n_wanted_caps == 0) return;
 
-    // First grab as many free Capabilities as we can.  ToDo: we should use
-    // capabilities on the same NUMA node preferably, but not exclusively.
-    for (i = (cap->no + 1) % n_capabilities, n_free_caps=0;
-         n_free_caps < n_wanted_caps && i != cap->no;
-         i = (i + 1) % n_capabilities) {
-        cap0 = capabilities[i];
-        if (cap != cap0 && !cap0->disabled && tryGrabCapability(cap0,task)) {
-            if (!emptyRunQueue(cap0)
-                || cap0->n_returning_tasks != 0
-                || cap0->inbox != (Message*)END_TSO_QUEUE) {
-                // it already has some work, we just grabbed it at
-                // the wrong moment.  Or maybe it's deadlocked!
-                releaseCapability(cap0);
-            } else {
-                free_caps[n_free_caps++] = cap0;
+    // First grab as many free Capabilities as we can.  We prefer
+    // capabilities on the same NUMA node, so that migrated threads don't
+    // have to fetch their data across the interconnect, and only look at
+    // the other nodes (on the second pass) if there aren't enough of
+    // those.
+    n_free_caps = 0;
+    for (pass = 0; pass < 2 && n_free_caps < n_wanted_caps; pass++) {
+        for (i = (cap->no + 1) % n_capabilities;
+             n_free_caps < n_wanted_caps && i != cap->no;
+             i = (i + 1) % n_capabilities) {
+            cap0 = capabilities[i];
+            if ((cap0->node == cap->node) != (pass == 0)) continue;
+            if (!cap0->disabled && tryGrabCapability(cap0,task)) {
+                if (!emptyRunQueue(cap0)
+                    || cap0->n_returning_tasks != 0
+                    || !emptyInbox(cap0)) {
+                    // it already has some work, we just grabbed it at
+                    // the wrong moment.  Or maybe it's deadlocked!
+                    releaseCapability(cap0);
+                } else {
+                    free_caps[n_free_caps++] = cap0;
+                }
             }
         }
     }
 
+    if (n_free_caps > 0 && RtsFlags.ParFlags.stealThreads) {
+        for (i = 0; i < n_free_caps; i++) {
+            task->cap = free_caps[i];
+            releaseAndWakeupCapability(free_caps[i]);
+        }
+        n_free_caps = 0;
+    }
+
     // We now have n_free_caps free capabilities stashed in
     // free_caps[].  Attempt to share our run queue equally with them.
     // This is complicated slightly by the fact that we can't move
@@ -741,14 +894,11 @@ schedulePushWork(Capability *cap USED_IF_THREADS,
     //  - threads that have TSO_LOCKED cannot migrate
     //  - a thread that is bound to the current Task cannot be migrated
     //
-    // This is about the simplest thing we could do; improvements we
-    // might want to do include:
-    //
-    //   - giving high priority to moving relatively new threads, on
-    //     the gournds that they haven't had time to build up a
-    //     working set in the cache on this CPU/Capability.
-    //
-    //   - giving low priority to moving long-lived threads
+    // We give priority to moving threads that have never run (see
+    // TSO_HAS_RUN), on the grounds that they haven't had time to build
+    // up a working set in the cache on this CPU/Capability: the first
+    // pass over the run queue only migrates those, and the second pass
+    // migrates whatever else it takes.
 
     if (n_free_caps > 0) {
         StgTSO *prev, *t, *next;
@@ -771,59 +921,76 @@ schedulePushWork(Capability *cap USED_IF_THREADS,
         // The number of threads we have left.
         uint32_t n = cap->n_run_queue;
 
-        // prev = the previous thread on this cap's run queue
-        prev = END_TSO_QUEUE;
+        // The next free_cap to give a thread to.
+        i = 0;
+
+        for (pass = 0; pass < 2 && n > keep_threads; pass++) {
+            // Give away the highest priority threads first, they
+            // will get to run sooner on the free capabilities.
+            for (p = 0; p < N_THREAD_PRIORITIES && n > keep_threads; p++) {
+                // prev = the previous thread on this cap's run queue
+                prev = END_TSO_QUEUE;
+
+                // We're going to walk through the run queue, migrating
+                // threads to other capabilities until we have only
+                // keep_threads left.  We might encounter a thread that
+                // cannot be migrated, in which case we add it to the
+                // current run queue and decrement keep_threads (once,
+                // on the first pass).
+                for (t = cap->run_queue_hd[p];
+                     t != END_TSO_QUEUE && n > keep_threads;
+                     t = next)
+                {
+                    next = t->_link;
+                    t->_link = END_TSO_QUEUE;
+
+                    // Should we keep this thread?
+                    if (t->bound == task->incall // don't move my bound thread
+                        || tsoLocked(t) // don't move a locked thread
+                        || (pass == 0 && (t->flags & TSO_HAS_RUN))
+                        ) {
+                        if (prev == END_TSO_QUEUE) {
+                            cap->run_queue_hd[p] = t;
+                        } else {
+                            setTSOLink(cap, prev, t);
+                        }
+                        setTSOPrev(cap, t, prev);
+                        prev = t;
+                        if (pass == 0
+                            && (t->bound == task->incall || tsoLocked(t))
+                            && keep_threads > 0) {
+                            keep_threads--;
+                        }
+                    }
 
-        // We're going to walk through the run queue, migrating threads to other
-        // capabilities until we have only keep_threads left.  We might
-        // encounter a thread that cannot be migrated, in which case we add it
-        // to the current run queue and decrement keep_threads.
-        for (t = cap->run_queue_hd, i = 0;
-             t != END_TSO_QUEUE && n > keep_threads;
-             t = next)
-        {
-            next = t->_link;
-            t->_link = END_TSO_QUEUE;
+                    // Or migrate it?
+                    else {
+                        appendToRunQueue(free_caps[i],t);
+                        traceEventMigrateThread (cap, t, free_caps[i]->no);
+                        cap->thread_migrations[free_caps[i]->node]++;
+
+                        if (t->bound) { t->bound->task->cap = free_caps[i]; }
+                        t->cap = free_caps[i];
+                        n--; // we have one fewer threads now
+                        i++; // move on to the next free_cap
+                        if (i == n_free_caps) i = 0;
+                    }
+                }
 
-            // Should we keep this thread?
-            if (t->bound == task->incall // don't move my bound thread
-                || tsoLocked(t) // don't move a locked thread
-                ) {
+                // Join up the beginning of the queue (prev)
+                // with the rest of the queue (t)
+                if (t == END_TSO_QUEUE) {
+                    cap->run_queue_tl[p] = prev;
+                } else {
+                    setTSOPrev(cap, t, prev);
+                }
                 if (prev == END_TSO_QUEUE) {
-                    cap->run_queue_hd = t;
+                    cap->run_queue_hd[p] = t;
                 } else {
                     setTSOLink(cap, prev, t);
                 }
-                setTSOPrev(cap, t, prev);
-                prev = t;
-                if (keep_threads > 0) keep_threads--;
-            }
-
-            // Or migrate it?
-            else {
-                appendToRunQueue(free_caps[i],t);
-                traceEventMigrateThread (cap, t, free_caps[i]->no);
-
-                if (t->bound) { t->bound->task->cap = free_caps[i]; }
-                t->cap = free_caps[i];
-                n--; // we have one fewer threads now
-                i++; // move on to the next free_cap
-                if (i == n_free_caps) i = 0;
             }
         }
-
-        // Join up the beginning of the queue (prev)
-        // with the rest of the queue (t)
-        if (t == END_TSO_QUEUE) {
-            cap->run_queue_tl = prev;
-        } else {
-            setTSOPrev(cap, t, prev);
-        }
-        if (prev == END_TSO_QUEUE) {
-            cap->run_queue_hd = t;
-        } else {
-            setTSOLink(cap, prev, t);
-        }
         cap->n_run_queue = n;
 
         IF_DEBUG(sanity, checkRunQueue(cap));
@@ -846,6 +1013,169 @@ schedulePushWork(Capability *cap USED_IF_THREADS,
 
 }
 
+/* -----------------------------------------------------------------------------
+ * Thread stealing
+ *
+ * Note [Thread stealing]
+ * ~~~~~~~~~~~~~~~~~~~~~~
+ * Normally threads are load-balanced by schedulePushWork(): a busy
+ * Capability grabs free Capabilities and pushes threads onto their
+ * run queues.  A Capability that runs out of work cannot do anything
+ * about it except wait to be given some.
+ *
+ * With +RTS -qt, a busy Capability instead offers its spare threads in
+ * cap->steal_queue, a WSDeque just like the spark pool, and idle
+ * Capabilities steal them without taking any locks.  The run queue
+ * itself stays private to the Capability.
+ *
+ *   - A thread in cap->steal_queue is not on any run queue, and has
+ *     why_blocked == ThreadStealable and tso->cap == cap.  Bound
+ *     threads and threads with TSO_LOCKED are never offered.
+ *
+ *   - Only cap pushes and pops its steal_queue.  At the start of each
+ *     iteration of the scheduler loop it takes all its offered threads
+ *     back (reclaimStealableThreads()), and then schedulePushWork()
+ *     offers the threads just behind the head of the run queue again
+ *     (offerThreads()).  So an offered thread that nobody steals runs
+ *     in the same order as it would have done anyway, and the threads
+ *     that have been waiting longest are stolen first.
+ *
+ *   - schedulePushWork() wakes up free Capabilities rather than
+ *     pushing threads to them, and a Capability whose run queue is
+ *     empty tries to steal a thread in scheduleFindWork()
+ *     (stealThread()).
+ *
+ *   - A thief sets tso->cap before it sets why_blocked to NotBlocked
+ *     and puts the thread on its own run queue.  So if a thread has
+ *     why_blocked == ThreadStealable and tso->cap == cap after cap has
+ *     emptied its steal_queue, then the thread is on its way to a
+ *     thief.  throwTo() waits for it to get there (see throwToMsg()).
+ *
+ *   - The steal_queue is a GC root (see markCapability()).  Nothing is
+ *     stolen during GC, because the GC holds all the Capabilities.
+ *
+ *   - The thief posts the EVENT_MIGRATE_THREAD for a stolen thread in
+ *     its own event buffer, because only the owner of a Capability may
+ *     write to its buffer.  So the event appears on the thief's
+ *     timeline, just before the thread first runs there, rather than
+ *     on the victim's.
+ * -------------------------------------------------------------------------- */
+
+#if defined(THREADED_RTS)
+
+static uint32_t
+offerThreads (Capability *cap)
+{
+    StgTSO *t, *next, *head;
+    uint32_t n_offered, max_offered, p;
+
+    if (cap->disabled || cap->n_run_queue <= 1 ||
+        sched_state >= SCHED_INTERRUPTING) {
+        return 0;
+    }
+
+    // There's no point in offering more threads than there are other
+    // Capabilities to steal them.
+    max_offered = stg_min(enabled_capabilities - 1,
+                          (uint32_t)cap->steal_queue->size);
+
+    // Keep the thread at the head of the run queue, we are about to
+    // run it.
+    head = peekRunQueue(cap);
+    n_offered = 0;
+    for (p = 0; p < N_THREAD_PRIORITIES && n_offered < max_offered; p++) {
+        for (t = cap->run_queue_hd[p];
+             t != END_TSO_QUEUE && n_offered < max_offered;
+             t = next)
+        {
+            next = t->_link;
+            if (t == head || t->bound || tsoLocked(t)) continue;
+
+            removeFromRunQueue(cap, t);
+            t->why_blocked = ThreadStealable;
+            if (!pushWSDeque(cap->steal_queue, t)) {
+                barf("offerThreads: steal queue overflow");
+            }
+            n_offered++;
+        }
+    }
+
+    return n_offered;
+}
+
+void
+reclaimStealableThreads (Capability *cap)
+{
+    StgTSO *t;
+
+    // popWSDeque() costs a memory barrier, avoid it in the common case
+    if (looksEmptyWSDeque(cap->steal_queue)) return;
+
+    // The steal_queue is popped from the end we pushed onto, so
+    // pushing the threads back onto the front of the run queue leaves
+    // them in their original order.
+    while ((t = popWSDeque(cap->steal_queue)) != NULL) {
+        ASSERT(t->why_blocked == ThreadStealable && t->cap == cap);
+        t->why_blocked = NotBlocked;
+        pushOnRunQueue(cap, t);
+    }
+}
+
+static rtsBool
+stealThread (Capability *cap)
+{
+    Capability *robbed;
+    StgTSO *t;
+    uint32_t i, pass;
+    rtsBool retry;
+
+    if (cap->disabled) return rtsFalse;
+
+    do {
+        retry = rtsFalse;
+
+        // Try the Capabilities on our own NUMA node first
+        for (pass = 0; pass < 2; pass++) {
+            for (i = (cap->no + 1) % n_capabilities;
+                 i != cap->no;
+                 i = (i + 1) % n_capabilities) {
+                robbed = capabilities[i];
+                if ((robbed->node == cap->node) != (pass == 0)) continue;
+                if (looksEmptyWSDeque(robbed->steal_queue)) continue;
+
+                t = stealWSDeque_(robbed->steal_queue);
+                if (t == NULL) {
+                    // we conflicted with another thief, or the owner
+                    // took its threads back; try again later.
+                    if (!looksEmptyWSDeque(robbed->steal_queue)) {
+                        retry = rtsTrue;
+                    }
+                    continue;
+                }
+
+                debugTrace(DEBUG_sched, "cap %d: stole thread %lu from cap %d",
+                           cap->no, (unsigned long)t->id, robbed->no);
+
+                ASSERT(t->why_blocked == ThreadStealable);
+                ASSERT(t->bound == NULL && !tsoLocked(t));
+                t->cap = cap;
+                // tso->cap must be visible before why_blocked, see
+                // Note [Thread stealing]
+                write_barrier();
+                t->why_blocked = NotBlocked;
+                appendToRunQueue(cap, t);
+                // See Note [Thread stealing]
+                traceEventMigrateThread(cap, t, cap->no);
+                return rtsTrue;
+            }
+        }
+    } while (retry);
+
+    return rtsFalse;
+}
+
+#endif /* THREADED_RTS */
+
 /* ----------------------------------------------------------------------------
  * Start any pending signal handlers
  * ------------------------------------------------------------------------- */
@@ -879,7 +1209,7 @@ scheduleCheckBlockedThreads(Capability *cap USED_IF_NOT_THREADS)
     // run queue is empty, and there are no other tasks running, we
     // can wait indefinitely for something to happen.
     //
-    if ( !emptyQueue(blocked_queue_hd) || !emptyQueue(sleeping_queue) )
+    if ( !EMPTY_BLOCKED_QUEUE() || !EMPTY_SLEEPING_QUEUE() )
     {
         awaitEvent (emptyRunQueue(cap));
     }
@@ -982,7 +1312,6 @@ scheduleProcessInbox (Capability **pcap USED_IF_THREADS)
 {
 #if defined(THREADED_RTS)
     Message *m, *next;
-    int r;
     Capability *cap = *pcap;
 
     while (!emptyInbox(cap)) {
@@ -992,23 +1321,10 @@ scheduleProcessInbox (Capability **pcap USED_IF_THREADS)
             cap = *pcap;
         }
 
-        // don't use a blocking acquire; if the lock is held by
-        // another thread then just carry on.  This seems to avoid
-        // getting stuck in a message ping-pong situation with other
-        // processors.  We'll check the inbox again later anyway.
-        //
-        // We should really use a more efficient queue data structure
-        // here.  The trickiness is that we must ensure a Capability
-        // never goes idle if the inbox is non-empty, which is why we
-        // use cap->lock (cap->lock is released as the last thing
-        // before going idle; see Capability.c:releaseCapability()).
-        r = TRY_ACQUIRE_LOCK(&cap->lock);
-        if (r != 0) return;
-
-        m = cap->inbox;
-        cap->inbox = (Message*)END_TSO_QUEUE;
-
-        RELEASE_LOCK(&cap->lock);
+        // Take all the messages sent so far in one go; the next
+        // message to arrive will interrupt us again.  No lock is
+        // needed, see Note [Capability inbox] in Messages.c.
+        m = (Message*)xchg((StgPtr)&cap->inbox, (StgWord)END_TSO_QUEUE);
 
         while (m != (Message*)END_TSO_QUEUE) {
             next = m->link;
@@ -1181,6 +1497,36 @@ scheduleHandleHeapOverflow( Capability *cap, StgTSO *t )
     /* actual GC is done at the end of the while loop in schedule() */
 }
 
+/* -----------------------------------------------------------------------------
+ * Switching evaluators
+ *
+ * Note [Switching evaluators]
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * The interpreter can't run compiled code, and compiled code can't run
+ * bytecode, so whenever a call crosses from one to the other the thread
+ * returns to schedule() with ThreadYielding, having set what_next to
+ * the other evaluator, and with a frame on top of the stack that says
+ * what to do next (e.g. stg_enter_info to enter a compiled closure,
+ * stg_apply_interp_info to apply a BCO).  In GHCi, an interpreted loop
+ * that calls compiled library code does this twice per iteration.
+ *
+ * Going round the scheduler loop stops and starts the thread, which
+ * emits two events, reads the clock for the time slice, and runs a
+ * memory barrier, none of which is needed when the thread is just
+ * carrying on.  So schedule() calls the other evaluator straight away,
+ * as long as there is no reason to stop the thread: the context switch
+ * and interrupt flags are clear.  The thread stays cap->r.rCurrentTSO,
+ * and counts as having run without a break.
+ *
+ * That is all this saves: each switch still returns from StgRun() or
+ * interpretBCO() and enters the other one, so it still costs a good
+ * deal more than a call within either evaluator.
+ *
+ * Anything else (a context switch, an interrupt, or a yield that isn't
+ * a switch of evaluators) goes the long way, through
+ * scheduleHandleYield(), as before.
+ * -------------------------------------------------------------------------- */
+
 /* -----------------------------------------------------------------------------
  * Handle a thread that returned to the scheduler with ThreadYielding
  * -------------------------------------------------------------------------- */
@@ -1776,6 +2122,7 @@ delete_threads_and_gc:
         ASSERT(tmp_cap->disabled);
         if (i != cap->no) {
             dest_cap = capabilities[i % enabled_capabilities];
+            reclaimStealableThreads(tmp_cap);
             while (!emptyRunQueue(tmp_cap)) {
                 tso = popRunQueue(tmp_cap);
                 migrateThread(tmp_cap, tso, dest_cap);
@@ -1800,6 +2147,7 @@ delete_threads_and_gc:
 #endif
 
     traceSparkCounters(cap);
+    traceThreadMigrationCounters(cap);
 
     switch (recent_activity) {
     case ACTIVITY_INACTIVE:
@@ -1996,6 +2344,12 @@ forkProcess(HsStablePtr *entry
         resetTracing();
 #endif
 
+#if !defined(THREADED_RTS) && !defined(mingw32_HOST_OS)
+        // Forget the parent's epoll set before we delete the threads
+        // waiting on it.
+        resetIOWaitersAfterFork();
+#endif
+
         // Now, all OS threads except the thread that forked are
         // stopped.  We need to stop all Haskell threads, including
         // those involved in foreign calls.  Also we need to delete
@@ -2202,6 +2556,9 @@ setNumCapabilities (uint32_t new_n_capabilities USED_IF_THREADS)
     // We're done: release the original Capabilities
     releaseAllCapabilities(old_n_capabilities, cap,task);
 
+    // and give the new ones their spare workers
+    startSpareWorkerTasks(old_n_capabilities, n_capabilities);
+
     // We can't free the old array until now, because we access it
     // while updating pointers in updateCapabilityRefs().
     if (old_capabilities) {
@@ -2245,8 +2602,8 @@ deleteAllThreads ( Capability *cap )
     // being GC'd, and we don't want the "main thread has been GC'd" panic.
 
 #if !defined(THREADED_RTS)
-    ASSERT(blocked_queue_hd == END_TSO_QUEUE);
-    ASSERT(sleeping_queue == END_TSO_QUEUE);
+    ASSERT(EMPTY_BLOCKED_QUEUE());
+    ASSERT(EMPTY_SLEEPING_QUEUE());
 #endif
 }
 
@@ -2414,8 +2771,13 @@ resumeThread (void *task_)
         }
     }
 
+    startTimeSlice(cap, tso);
     cap->r.rCurrentTSO = tso;
     cap->in_haskell = rtsTrue;
+
+    // the ticker may be skipping ticks, see Note [Tickless idle]
+    wakeTimerIfIdle();
+
     errno = saved_errno;
 #if mingw32_HOST_OS
     SetLastError(saved_winerror);
@@ -2549,6 +2911,27 @@ startWorkerTasks (uint32_t from USED_IF_THREADS, uint32_t to USED_IF_THREADS)
 #endif
 }
 
+// Start the pool of spare workers (+RTS -qp) on each of the given
+// Capabilities.  See Note [Spinning for a Capability] in Capability.c.
+static void
+startSpareWorkerTasks (uint32_t from USED_IF_THREADS,
+                       uint32_t to USED_IF_THREADS)
+{
+#if defined(THREADED_RTS)
+    uint32_t i, n;
+    Capability *cap;
+
+    for (i = from; i < to; i++) {
+        cap = capabilities[i];
+        ACQUIRE_LOCK(&cap->lock);
+        for (n = 0; n < RtsFlags.ParFlags.spareWorkers; n++) {
+            startSpareWorkerTask(cap);
+        }
+        RELEASE_LOCK(&cap->lock);
+    }
+#endif
+}
+
 /* ---------------------------------------------------------------------------
  * initScheduler()
  *
@@ -2564,7 +2947,6 @@ initScheduler(void)
 #if !defined(THREADED_RTS)
   blocked_queue_hd  = END_TSO_QUEUE;
   blocked_queue_tl  = END_TSO_QUEUE;
-  sleeping_queue    = END_TSO_QUEUE;
 #endif
 
   sched_state    = SCHED_RUNNING;
@@ -2593,6 +2975,7 @@ initScheduler(void)
    * worker task hogging it.
    */
   startWorkerTasks(1, n_capabilities);
+  startSpareWorkerTasks(0, n_capabilities);
 
   RELEASE_LOCK(&sched_mutex);
 
@@ -2641,6 +3024,10 @@ freeScheduler( void )
     if (still_running == 0) {
         freeCapabilities();
     }
+#if !defined(THREADED_RTS) && !defined(mingw32_HOST_OS)
+    freeSleepingThreads();
+    freeIOWaiters();
+#endif
     RELEASE_LOCK(&sched_mutex);
 #if defined(THREADED_RTS)
     closeMutex(&sched_mutex);
@@ -2653,7 +3040,10 @@ void markScheduler (evac_fn evac USED_IF_NOT_THREADS,
 #if !defined(THREADED_RTS)
     evac(user, (StgClosure **)(void *)&blocked_queue_hd);
     evac(user, (StgClosure **)(void *)&blocked_queue_tl);
-    evac(user, (StgClosure **)(void *)&sleeping_queue);
+#if !defined(mingw32_HOST_OS)
+    markSleepingThreads(evac, user);
+    markIOWaiters(evac, user);
+#endif
 #endif
 }
 
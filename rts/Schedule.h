@@ -13,6 +13,9 @@
 #include "rts/OSThreads.h"
 #include "Capability.h"
 #include "Trace.h"
+#if !defined(THREADED_RTS) && !defined(mingw32_HOST_OS)
+#include "posix/Select.h"
+#endif
 
 #include "BeginPrivate.h"
 
@@ -98,7 +101,6 @@ extern volatile StgWord recent_activity;
  */
 #if !defined(THREADED_RTS)
 extern  StgTSO *blocked_queue_hd, *blocked_queue_tl;
-extern  StgTSO *sleeping_queue;
 #endif
 
 extern rtsBool heap_overflow;
@@ -120,6 +122,10 @@ void resurrectThreads (StgTSO *);
 
 /* END_TSO_QUEUE and friends now defined in includes/stg/MiscClosures.h */
 
+/* The run queue is really one queue per priority, see Note [Thread
+ * priorities] in Schedule.c.
+ */
+
 /* Add a thread to the end of the run queue.
  * NOTE: tso->link should be END_TSO_QUEUE before calling this macro.
  * ASSUMES: cap->running_task is the current task.
@@ -130,15 +136,20 @@ appendToRunQueue (Capability *cap, StgTSO *tso);
 EXTERN_INLINE void
 appendToRunQueue (Capability *cap, StgTSO *tso)
 {
+    uint32_t p = tso->priority;
+
     ASSERT(tso->_link == END_TSO_QUEUE);
-    if (cap->run_queue_hd == END_TSO_QUEUE) {
-        cap->run_queue_hd = tso;
+    ASSERT(p < N_THREAD_PRIORITIES);
+    tso->run_queue_priority = p;
+    if (cap->run_queue_hd[p] == END_TSO_QUEUE) {
+        cap->run_queue_hd[p] = tso;
+        cap->run_queue_skipped[p] = 0;
         tso->block_info.prev = END_TSO_QUEUE;
     } else {
-        setTSOLink(cap, cap->run_queue_tl, tso);
-        setTSOPrev(cap, tso, cap->run_queue_tl);
+        setTSOLink(cap, cap->run_queue_tl[p], tso);
+        setTSOPrev(cap, tso, cap->run_queue_tl[p]);
     }
-    cap->run_queue_tl = tso;
+    cap->run_queue_tl[p] = tso;
     cap->n_run_queue++;
 }
 
@@ -151,45 +162,99 @@ pushOnRunQueue (Capability *cap, StgTSO *tso);
 EXTERN_INLINE void
 pushOnRunQueue (Capability *cap, StgTSO *tso)
 {
-    setTSOLink(cap, tso, cap->run_queue_hd);
+    uint32_t p = tso->priority;
+
+    ASSERT(p < N_THREAD_PRIORITIES);
+    tso->run_queue_priority = p;
+    setTSOLink(cap, tso, cap->run_queue_hd[p]);
     tso->block_info.prev = END_TSO_QUEUE;
-    if (cap->run_queue_hd != END_TSO_QUEUE) {
-        setTSOPrev(cap, cap->run_queue_hd, tso);
+    if (cap->run_queue_hd[p] != END_TSO_QUEUE) {
+        setTSOPrev(cap, cap->run_queue_hd[p], tso);
     }
-    cap->run_queue_hd = tso;
-    if (cap->run_queue_tl == END_TSO_QUEUE) {
-        cap->run_queue_tl = tso;
+    cap->run_queue_hd[p] = tso;
+    if (cap->run_queue_tl[p] == END_TSO_QUEUE) {
+        cap->run_queue_tl[p] = tso;
+        cap->run_queue_skipped[p] = 0;
     }
     cap->n_run_queue++;
 }
 
+/* The priority of the queue to take the next thread from: the highest
+ * priority queue that isn't empty, unless a lower priority queue has
+ * been passed over PRIORITY_AGING_LIMIT times.  N_THREAD_PRIORITIES if
+ * the run queue is empty.
+ */
+#define PRIORITY_AGING_LIMIT 8
+
+INLINE_HEADER uint32_t
+nextRunQueuePriority (Capability *cap)
+{
+    uint32_t p, first = N_THREAD_PRIORITIES;
+
+    for (p = 0; p < N_THREAD_PRIORITIES; p++) {
+        if (cap->run_queue_hd[p] == END_TSO_QUEUE) continue;
+        if (first == N_THREAD_PRIORITIES) {
+            first = p;
+        } else if (cap->run_queue_skipped[p] >= PRIORITY_AGING_LIMIT) {
+            return p;
+        }
+    }
+    return first;
+}
+
 /* Pop the first thread off the runnable queue.
  */
 INLINE_HEADER StgTSO *
 popRunQueue (Capability *cap)
 {
-    StgTSO *t = cap->run_queue_hd;
-    ASSERT(t != END_TSO_QUEUE);
-    cap->run_queue_hd = t->_link;
+    uint32_t p, q;
+    StgTSO *t;
+
+    p = nextRunQueuePriority(cap);
+    ASSERT(p < N_THREAD_PRIORITIES);
+    t = cap->run_queue_hd[p];
+    cap->run_queue_hd[p] = t->_link;
     if (t->_link != END_TSO_QUEUE) {
         t->_link->block_info.prev = END_TSO_QUEUE;
     }
     t->_link = END_TSO_QUEUE; // no write barrier req'd
-    if (cap->run_queue_hd == END_TSO_QUEUE) {
-        cap->run_queue_tl = END_TSO_QUEUE;
+    if (cap->run_queue_hd[p] == END_TSO_QUEUE) {
+        cap->run_queue_tl[p] = END_TSO_QUEUE;
     }
     cap->n_run_queue--;
+
+    // age the lower priority threads that we passed over
+    cap->run_queue_skipped[p] = 0;
+    for (q = p + 1; q < N_THREAD_PRIORITIES; q++) {
+        if (cap->run_queue_hd[q] != END_TSO_QUEUE) {
+            cap->run_queue_skipped[q]++;
+        }
+    }
     return t;
 }
 
+/* The thread that popRunQueue() would return, or END_TSO_QUEUE.
+ */
 INLINE_HEADER StgTSO *
 peekRunQueue (Capability *cap)
 {
-    return cap->run_queue_hd;
+    uint32_t p = nextRunQueuePriority(cap);
+    return p < N_THREAD_PRIORITIES ? cap->run_queue_hd[p] : END_TSO_QUEUE;
 }
 
 void promoteInRunQueue (Capability *cap, StgTSO *tso);
 
+// Thread priorities, see Note [Thread priorities] in Schedule.c
+void  setThreadPriority (Capability *cap, StgTSO *tso, HsInt priority);
+HsInt getThreadPriority (StgTSO *tso);
+
+#if defined(THREADED_RTS)
+// Move the threads cap has offered for stealing back onto its run
+// queue.  Must be called by the owner of cap, or with all
+// Capabilities held.  See Note [Thread stealing] in Schedule.c.
+void reclaimStealableThreads (Capability *cap);
+#endif
+
 /* Add a thread to the end of the blocked queue.
  */
 #if !defined(THREADED_RTS)
@@ -223,14 +288,24 @@ emptyRunQueue(Capability *cap)
 INLINE_HEADER void
 truncateRunQueue(Capability *cap)
 {
-    cap->run_queue_hd = END_TSO_QUEUE;
-    cap->run_queue_tl = END_TSO_QUEUE;
+    uint32_t p;
+    for (p = 0; p < N_THREAD_PRIORITIES; p++) {
+        cap->run_queue_hd[p] = END_TSO_QUEUE;
+        cap->run_queue_tl[p] = END_TSO_QUEUE;
+        cap->run_queue_skipped[p] = 0;
+    }
     cap->n_run_queue = 0;
 }
 
 #if !defined(THREADED_RTS)
+#if !defined(mingw32_HOST_OS)
+#define EMPTY_BLOCKED_QUEUE()  (emptyQueue(blocked_queue_hd) && !anyIOWaiters())
+#define EMPTY_SLEEPING_QUEUE() (!anySleepingThreads())
+#else
 #define EMPTY_BLOCKED_QUEUE()  (emptyQueue(blocked_queue_hd))
-#define EMPTY_SLEEPING_QUEUE() (emptyQueue(sleeping_queue))
+// threadDelay uses the blocked_queue on Windows
+#define EMPTY_SLEEPING_QUEUE() rtsTrue
+#endif
 #endif
 
 INLINE_HEADER rtsBool
@@ -59,9 +59,15 @@ newSpark (StgRegTable *reg, StgClosure *p)
 {
     Capability *cap = regTableToCapability(reg);
     SparkPool *pool = cap->sparks;
+    StgClosure **recent = &cap->recent_sparks[SPARK_FILTER_INDEX(p)];
 
-    if (!fizzledSpark(p)) {
+    // Sparking the same closure twice is as useless as sparking one
+    // that has already been evaluated, so we count both as duds.  The
+    // filter only catches duplicates that were sparked recently (since
+    // the last GC), but it costs next to nothing.
+    if (!fizzledSpark(p) && *recent != p) {
         if (pushWSDeque(pool,p)) {
+            *recent = p;
             cap->spark_stats.created++;
             traceEventSparkCreate(cap);
         } else {
@@ -79,9 +85,35 @@ newSpark (StgRegTable *reg, StgClosure *p)
 
 /* --------------------------------------------------------------------------
  * Remove all sparks from the spark queues which should not spark any
- * more.  Called after GC. We assume exclusive access to the structure
- * and replace  all sparks in the queue, see explanation below. At exit,
- * the spark pool only contains sparkable closures.
+ * more.  Called after GC. We assume exclusive access to the structure,
+ * see Note [Pruning the spark pool].  At exit, all the sparks that
+ * point into the generations just collected are sparkable closures.
+ *
+ * Note [Pruning the spark pool]
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * Sparks are not roots: after GC we discard the sparks whose closures
+ * died, and also those that have been evaluated (fizzled) meanwhile.
+ * Looking at every spark on every GC is expensive for programs that
+ * have millions of sparks, so we only look at the sparks that may
+ * point into the generations we just collected.  A spark pointing
+ * into an older generation cannot have died, and if it has fizzled
+ * findSpark() will notice and discard it anyway.
+ *
+ * New sparks are pushed at the bottom of the pool, and the GC
+ * compacts the sparks it keeps in place, so the pool is ordered by
+ * the time the sparks were last pruned.  cap->spark_gen_marks[g]
+ * records the index below which every spark points into a
+ * generation older than g (or to a static closure), so the GC of
+ * generations 0..N only has to look at the sparks from
+ * spark_gen_marks[N] to the bottom of the pool.  Stealing only moves
+ * top up past the marks, so we clamp them to the live part of the
+ * pool before use.
+ *
+ * We don't sort the sparks we keep by generation, so the marks only
+ * move to the bottom of the pool for generations younger than all of
+ * those sparks; with the default two generations that is precise.
+ * To stop fizzled sparks in old generations from filling up the pool,
+ * we look at the whole pool when it is more than half full.
  * -------------------------------------------------------------------------- */
 
 void
@@ -90,13 +122,20 @@ pruneSparkQueue (Capability *cap)
     SparkPool *pool;
     StgClosurePtr spark, tmp, *elements;
     uint32_t n, pruned_sparks; // stats only
-    StgWord botInd,oldBotInd,currInd; // indices in array (always < size)
+    uint32_t g, min_gen;
+    StgWord *marks, start, currInd, botInd, offset;
     const StgInfoTable *info;
 
     n = 0;
     pruned_sparks = 0;
 
     pool = cap->sparks;
+    marks = cap->spark_gen_marks;
+
+    // The addresses in the filter mean nothing after GC
+    for (g = 0; g < SPARK_FILTER_SIZE; g++) {
+        cap->recent_sparks[g] = NULL;
+    }
 
     // it is possible that top > bottom, indicating an empty pool.  We
     // fix that here; this is only necessary because the loop below
@@ -107,10 +146,19 @@ pruneSparkQueue (Capability *cap)
     // Take this opportunity to reset top/bottom modulo the size of
     // the array, to avoid overflow.  This is only possible because no
     // stealing is happening during GC.
-    pool->bottom  -= pool->top & ~pool->moduloSize;
+    offset = pool->top & ~pool->moduloSize;
+    pool->bottom  -= offset;
     pool->top     &= pool->moduloSize;
     pool->topBound = pool->top;
 
+    for (g = 0; g < RtsFlags.GcFlags.generations; g++) {
+        if (marks[g] < offset + pool->top) {
+            marks[g] = pool->top;
+        } else {
+            marks[g] = stg_min(marks[g] - offset, pool->bottom);
+        }
+    }
+
     debugTrace(DEBUG_sparks,
                "markSparkQueue: current spark queue len=%ld; (hd=%ld; tl=%ld)",
                sparkPoolSize(pool), pool->bottom, pool->top);
@@ -119,52 +167,33 @@ pruneSparkQueue (Capability *cap)
 
     elements = (StgClosurePtr *)pool->elements;
 
-    /* We have exclusive access to the structure here, so we can reset
-       bottom and top counters, and prune invalid sparks. Contents are
-       copied in-place if they are valuable, otherwise discarded. The
-       routine uses "real" indices t and b, starts by computing them
-       as the modulus size of top and bottom,
-
-       Copying:
-
-       At the beginning, the pool structure can look like this:
-       ( bottom % size >= top % size , no wrap-around)
-                  t          b
-       ___________***********_________________
-
-       or like this ( bottom % size < top % size, wrap-around )
-                  b         t
-       ***********__________******************
-       As we need to remove useless sparks anyway, we make one pass
-       between t and b, moving valuable content to b and subsequent
-       cells (wrapping around when the size is reached).
-
-                     b      t
-       ***********OOO_______XX_X__X?**********
-                     ^____move?____/
-
-       After this movement, botInd becomes the new bottom, and old
-       bottom becomes the new top index, both as indices in the array
-       size range.
-    */
-    // starting here
-    currInd = (pool->top) & (pool->moduloSize); // mod
+    if (major_gc || sparkPoolSize(pool) > (long)(pool->size / 2)) {
+        start = pool->top;
+    } else {
+        start = marks[N];
+    }
 
-    // copies of evacuated closures go to space from botInd on
-    // we keep oldBotInd to know when to stop
-    oldBotInd = botInd = (pool->bottom) & (pool->moduloSize); // mod
+    /* We have exclusive access to the structure here, so we can move
+       sparks around.  We make one pass over the sparks from start to
+       bottom, moving the valuable ones down to botInd (and
+       subsequent cells) and discarding the rest; the indices wrap
+       around the array modulo its size.  The sparks between top and
+       start are left alone.
 
-    // on entry to loop, we are within the bounds
-    ASSERT( currInd < pool->size && botInd  < pool->size );
+                  t      s           b
+       ___________*******XX_X__X?****_________
+                         ^___move?__/
+
+       Afterwards, botInd is the new bottom.
+    */
+    min_gen = oldest_gen->no;
+    botInd = start;
 
-    while (currInd != oldBotInd ) {
-      /* must use != here, wrap-around at size
-         subtle: loop not entered if queue empty
-       */
+    for (currInd = start; currInd != pool->bottom; currInd++) {
 
       /* check element at currInd. if valuable, evacuate and move to
          botInd, otherwise move on */
-      spark = elements[currInd];
+      spark = elements[currInd & pool->moduloSize];
 
       // We have to be careful here: in the parallel GC, another
       // thread might evacuate this closure while we're looking at it,
@@ -179,68 +208,67 @@ pruneSparkQueue (Capability *cap)
           pruned_sparks++;
           cap->spark_stats.fizzled++;
           traceEventSparkFizzle(cap);
-      } else {
-          info = spark->header.info;
-          if (IS_FORWARDING_PTR(info)) {
-              tmp = (StgClosure*)UN_FORWARDING_PTR(info);
-              /* if valuable work: shift inside the pool */
-              if (closure_SHOULD_SPARK(tmp)) {
-                  elements[botInd] = tmp; // keep entry (new address)
-                  botInd++;
-                  n++;
-              } else {
-                  pruned_sparks++; // discard spark
-                  cap->spark_stats.fizzled++;
-                  traceEventSparkFizzle(cap);
-              }
-          } else if (HEAP_ALLOCED(spark)) {
-              if ((Bdescr((P_)spark)->flags & BF_EVACUATED)) {
-                  if (closure_SHOULD_SPARK(spark)) {
-                      elements[botInd] = spark; // keep entry (new address)
-                      botInd++;
-                      n++;
-                  } else {
-                      pruned_sparks++; // discard spark
-                      cap->spark_stats.fizzled++;
-                      traceEventSparkFizzle(cap);
-                  }
-              } else {
-                  pruned_sparks++; // discard spark
-                  cap->spark_stats.gcd++;
-                  traceEventSparkGC(cap);
-              }
+          continue;
+      }
+
+      info = spark->header.info;
+      if (IS_FORWARDING_PTR(info)) {
+          tmp = (StgClosure*)UN_FORWARDING_PTR(info);
+          /* if valuable work: shift inside the pool */
+          if (closure_SHOULD_SPARK(tmp)) {
+              spark = tmp; // keep entry (new address)
           } else {
-              if (INFO_PTR_TO_STRUCT(info)->type == THUNK_STATIC) {
-                  // We can't tell whether a THUNK_STATIC is garbage or not.
-                  // See also Note [STATIC_LINK fields]
-                  // isAlive() also ignores static closures (see GCAux.c)
-                  elements[botInd] = spark; // keep entry (new address)
-                  botInd++;
-                  n++;
-              } else {
+              pruned_sparks++; // discard spark
+              cap->spark_stats.fizzled++;
+              traceEventSparkFizzle(cap);
+              continue;
+          }
+      } else if (HEAP_ALLOCED(spark)) {
+          if ((Bdescr((P_)spark)->flags & BF_EVACUATED)) {
+              if (!closure_SHOULD_SPARK(spark)) {
                   pruned_sparks++; // discard spark
                   cap->spark_stats.fizzled++;
                   traceEventSparkFizzle(cap);
+                  continue;
               }
+          } else {
+              pruned_sparks++; // discard spark
+              cap->spark_stats.gcd++;
+              traceEventSparkGC(cap);
+              continue;
+          }
+      } else {
+          if (INFO_PTR_TO_STRUCT(info)->type != THUNK_STATIC) {
+              pruned_sparks++; // discard spark
+              cap->spark_stats.fizzled++;
+              traceEventSparkFizzle(cap);
+              continue;
           }
+          // We can't tell whether a THUNK_STATIC is garbage or not.
+          // See also Note [STATIC_LINK fields]
+          // isAlive() also ignores static closures (see GCAux.c)
       }
 
-      currInd++;
-
-      // in the loop, we may reach the bounds, and instantly wrap around
-      ASSERT( currInd <= pool->size && botInd <= pool->size );
-      if ( currInd == pool->size ) { currInd = 0; }
-      if ( botInd == pool->size )  { botInd = 0;  }
-
-    } // while-loop over spark pool elements
-
-    ASSERT(currInd == oldBotInd);
+      // keep the spark, and remember the youngest generation we keep
+      if (HEAP_ALLOCED(spark) && Bdescr((P_)spark)->gen_no < min_gen) {
+          min_gen = Bdescr((P_)spark)->gen_no;
+      }
+      elements[botInd & pool->moduloSize] = spark;
+      botInd++;
+      n++;
+    }
 
-    pool->top = oldBotInd; // where we started writing
-    pool->topBound = pool->top;
+    pool->bottom = botInd;
 
-    pool->bottom = (oldBotInd <= botInd) ? botInd : (botInd + pool->size);
-    // first free place we did not use (corrected by wraparound)
+    // Every spark we kept points into generation min_gen or older, and
+    // those before start into generations older than N.
+    for (g = 0; g < RtsFlags.GcFlags.generations; g++) {
+        if (g < min_gen && g <= N) {
+            marks[g] = pool->bottom;
+        } else if (g <= N || marks[g] > start) {
+            marks[g] = start;
+        }
+    }
 
     debugTrace(DEBUG_sparks, "pruned %d sparks", pruned_sparks);
 
@@ -29,6 +29,16 @@ typedef struct {
 
 typedef WSDeque SparkPool;
 
+// Number of recently created sparks each Capability remembers, to
+// discard duplicates in newSpark().  Must be a power of 2.
+#define SPARK_FILTER_SIZE 32
+#define SPARK_FILTER_INDEX(p) \
+    (((StgWord)(p) / sizeof(W_)) & (SPARK_FILTER_SIZE - 1))
+
+// Maximum number of sparks findSpark() steals from another Capability
+// in one go.
+#define SPARK_STEAL_BATCH 64
+
 // Initialisation
 SparkPool *allocSparkPool (void);
 
@@ -41,6 +51,8 @@ INLINE_HEADER StgClosure* reclaimSpark(SparkPool *pool);
 INLINE_HEADER rtsBool looksEmpty(SparkPool* deque);
 
 INLINE_HEADER StgClosure * tryStealSpark (SparkPool *pool);
+INLINE_HEADER uint32_t     tryStealSparks (SparkPool *pool, StgClosure **buf,
+                                           uint32_t max);
 INLINE_HEADER rtsBool      fizzledSpark  (StgClosure *);
 
 void         freeSparkPool     (SparkPool *pool);
@@ -96,6 +108,24 @@ INLINE_HEADER StgClosure * tryStealSpark (SparkPool *pool)
     // other pools before trying again.
 }
 
+/* ----------------------------------------------------------------------------
+ *
+ * tryStealSparks: try to steal up to half of the sparks of a Capability
+ * (but no more than max) with a single atomic operation, and put them
+ * in buf.
+ *
+ * Returns the number of sparks stolen, some of which may have fizzled.
+ * As with tryStealSpark(), 0 may mean that there was a race with another
+ * thread rather than that the pool was empty.
+ *
+ -------------------------------------------------------------------------- */
+
+INLINE_HEADER uint32_t tryStealSparks (SparkPool *pool, StgClosure **buf,
+                                       uint32_t max)
+{
+    return stealHalfWSDeque_(pool, (void **)buf, max);
+}
+
 INLINE_HEADER rtsBool fizzledSpark (StgClosure *spark)
 {
     return (GET_CLOSURE_TAG(spark) != 0 || !closure_SHOULD_SPARK(spark));
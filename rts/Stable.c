@@ -16,6 +16,7 @@
 #include "RtsUtils.h"
 #include "Trace.h"
 #include "Stable.h"
+#include "sm/CNF.h"
 
 #include <string.h>
 
@@ -130,6 +131,46 @@ static void enlargeStablePtrTable(void);
 
 static HashTable *addrToStableHash = NULL;
 
+/*
+ * Generation-aware stable name tracking.
+ *
+ * A stable name entry only needs attention from the GC when its object
+ * (addr) or its StableName object (sn_obj) lives in a generation that is
+ * being collected; otherwise neither of them can move or die.  So that a
+ * minor GC doesn't have to scan the whole stable name table, every entry
+ * in use is kept on the list of the youngest generation it refers to
+ * (see snEntryGen()).  An entry without an sn_obj is always kept on the
+ * generation 0 list, because the StableName object that
+ * stg_makeStableNamezh is about to allocate will live in the nursery.
+ *
+ * At the start of a GC, rememberOldStableNameAddresses() moves the
+ * lists of the collected generations to sn_gc_work.  gcStableTables()
+ * then decides which of those entries are still alive, with help from
+ * the other GC threads (see gcStableTablesWorker()), and
+ * updateStableTables() frees the dead ones, re-hashes the ones that
+ * moved and files the survivors under their new generations.
+ */
+
+typedef struct {
+    StgWord *sns;                       /* stable name indices */
+    uint32_t n_sns;
+    uint32_t size;
+} snGenList;
+
+static snGenList *sn_gen_lists = NULL;
+static uint32_t n_sn_gen_lists = 0;
+#define INIT_SN_GEN_LIST_SIZE 64
+
+static StgWord *sn_gc_work = NULL;
+static uint32_t sn_gc_work_n = 0;
+static uint32_t sn_gc_work_size = 0;
+
+/* The GC threads claim sn_gc_work in chunks of SN_GC_CHUNK entries, once
+ * the main GC thread has set sn_gc_ready. */
+#define SN_GC_CHUNK 256
+static volatile StgWord sn_gc_next = 0;
+static volatile StgWord sn_gc_ready = 0;
+
 /* -----------------------------------------------------------------------------
  * We must lock the StablePtr table during GC, to prevent simultaneous
  * calls to freeStablePtr().
@@ -190,6 +231,10 @@ initStableTables(void)
     initSnEntryFreeList(stable_name_table + 1,INIT_SNT_SIZE-1,NULL);
     addrToStableHash = allocHashTable();
 
+    n_sn_gen_lists = RtsFlags.GcFlags.generations;
+    sn_gen_lists = stgCallocBytes(n_sn_gen_lists, sizeof *sn_gen_lists,
+                                  "initStableNameTable");
+
     if (SPT_size > 0) return;
     SPT_size = INIT_SPT_SIZE;
     stable_ptr_table = stgMallocBytes(SPT_size * sizeof *stable_ptr_table,
@@ -293,6 +338,23 @@ exitStableTables(void)
     stable_name_table = NULL;
     SNT_size = 0;
 
+    if (sn_gen_lists) {
+        uint32_t g;
+        for (g = 0; g < n_sn_gen_lists; g++) {
+            if (sn_gen_lists[g].sns)
+                stgFree(sn_gen_lists[g].sns);
+        }
+        stgFree(sn_gen_lists);
+    }
+    sn_gen_lists = NULL;
+    n_sn_gen_lists = 0;
+
+    if (sn_gc_work)
+        stgFree(sn_gc_work);
+    sn_gc_work = NULL;
+    sn_gc_work_n = 0;
+    sn_gc_work_size = 0;
+
     if (stable_ptr_table)
         stgFree(stable_ptr_table);
     stable_ptr_table = NULL;
@@ -309,7 +371,8 @@ STATIC_INLINE void
 freeSnEntry(snEntry *sn)
 {
   ASSERT(sn->sn_obj == NULL);
-  removeHashTable(addrToStableHash, (W_)sn->old, NULL);
+  removeHashTable(addrToStableHash, (W_)sn->old,
+                  (void *)(sn - stable_name_table));
   sn->addr = (P_)stable_name_free;
   stable_name_free = sn;
 }
@@ -336,6 +399,61 @@ freeStablePtr(StgStablePtr sp)
     stableUnlock();
 }
 
+/* -----------------------------------------------------------------------------
+ * Per-generation stable name lists
+ * -------------------------------------------------------------------------- */
+
+static void
+pushSnGenList (uint32_t g, StgWord sn)
+{
+    snGenList *list = &sn_gen_lists[g];
+
+    if (list->n_sns == list->size) {
+        list->size = list->size == 0 ? INIT_SN_GEN_LIST_SIZE : list->size * 2;
+        list->sns = stgReallocBytes(list->sns, list->size * sizeof(StgWord),
+                                    "pushSnGenList");
+    }
+    list->sns[list->n_sns++] = sn;
+}
+
+/*
+ * The generation a closure lives in.  Only valid during GC, and static
+ * closures count as belonging to the oldest generation since they never
+ * move.
+ */
+static uint32_t
+closureGen (StgClosure *c)
+{
+    bdescr *bd;
+
+    c = UNTAG_CLOSURE(c);
+    if (!HEAP_ALLOCED_GC(c)) {
+        return oldest_gen->no;
+    }
+    bd = Bdescr((StgPtr)c);
+    if (bd->flags & BF_COMPACT) {
+        // only the first block of a compact region has a valid gen_no
+        bd = Bdescr((StgPtr)objectGetCompactBlock(c));
+    }
+    return bd->gen_no;
+}
+
+/* The youngest generation a stable name entry refers to. */
+static uint32_t
+snEntryGen (snEntry *sn)
+{
+    uint32_t g;
+
+    if (sn->sn_obj == NULL) {
+        return 0;
+    }
+    g = closureGen(sn->sn_obj);
+    if (sn->addr != NULL) {
+        g = stg_min(g, closureGen((StgClosure *)sn->addr));
+    }
+    return g;
+}
+
 /* -----------------------------------------------------------------------------
  * Looking up
  * -------------------------------------------------------------------------- */
@@ -373,6 +491,15 @@ removeIndirections (StgClosure* p)
     }
 }
 
+/* Does any stable name refer to p?  For the GC, which holds the stable
+ * table lock; p is an address from before the GC.
+ */
+rtsBool
+hasStableName (StgClosure *p)
+{
+    return lookupHashTable(addrToStableHash, (W_)UNTAG_CLOSURE(p)) != NULL;
+}
+
 StgWord
 lookupStableName (StgPtr p)
 {
@@ -407,6 +534,7 @@ lookupStableName (StgPtr p)
   stable_name_free  = (snEntry*)(stable_name_free->addr);
   stable_name_table[sn].addr = p;
   stable_name_table[sn].sn_obj = NULL;
+  pushSnGenList(0, sn);
   /* debugTrace(DEBUG_stable, "new stable name %d at %p\n",sn,p); */
 
   /* add the new stable name to the hash table */
@@ -477,11 +605,48 @@ markStablePtrTable(evac_fn evac, void *user)
     FOR_EACH_STABLE_PTR(p, evac(user, (StgClosure **)&p->addr););
 }
 
-STATIC_INLINE void
+/*
+ * Move the stable names that refer to the generations being collected to
+ * sn_gc_work, remembering their current addresses so that
+ * updateStableTables() can tell which of them moved.
+ *
+ * Only GarbageCollect() calls this, not markStableTables(): the retainer
+ * profiler calls markStableTables() outside GC, and the entries moved to
+ * sn_gc_work then would never be updated or put back on their lists.
+ */
+void
 rememberOldStableNameAddresses(void)
 {
-    /* TODO: Only if !full GC */
-    FOR_EACH_STABLE_NAME(p, p->old = p->addr;);
+    uint32_t g, i, n;
+    snGenList *list;
+    snEntry *p;
+
+    n = 0;
+    for (g = 0; g <= N; g++) {
+        n += sn_gen_lists[g].n_sns;
+    }
+    if (n > sn_gc_work_size) {
+        sn_gc_work_size = n;
+        sn_gc_work = stgReallocBytes(sn_gc_work,
+                                     sn_gc_work_size * sizeof(StgWord),
+                                     "rememberOldStableNameAddresses");
+    }
+
+    sn_gc_work_n = 0;
+    for (g = 0; g <= N; g++) {
+        list = &sn_gen_lists[g];
+        for (i = 0; i < list->n_sns; i++) {
+            p = &stable_name_table[list->sns[i]];
+            p->old = p->addr;
+            sn_gc_work[sn_gc_work_n++] = list->sns[i];
+        }
+        list->n_sns = 0;
+    }
+
+    // No GC thread looks at these until the main GC thread has finished
+    // scavenging, which is after this point.
+    sn_gc_next = 0;
+    sn_gc_ready = 0;
 }
 
 void
@@ -493,7 +658,6 @@ markStableTables(evac_fn evac, void *user)
     freeOldSPTs();
 
     markStablePtrTable(evac, user);
-    rememberOldStableNameAddresses();
 }
 
 /* -----------------------------------------------------------------------------
@@ -542,42 +706,93 @@ threadStableTables( evac_fn evac, void *user )
  * name table entry.  We can re-use stable name table entries for live
  * heap objects, as long as the program has no StableName objects that
  * refer to the entry.
+ *
+ * Only the entries in sn_gc_work are looked at, and the work is shared
+ * between the GC threads: each entry is only written by the thread that
+ * claimed it, and anything that touches the free list or the hash table
+ * is left to updateStableTables().  A dead entry is marked by setting
+ * both addr and sn_obj to NULL.
  * -------------------------------------------------------------------------- */
 
+static void
+gcStableNameEntry (snEntry *p)
+{
+    // Update the pointer to the StableName object, if there is one
+    if (p->sn_obj != NULL) {
+        p->sn_obj = isAlive(p->sn_obj);
+        if (p->sn_obj == NULL) {
+            // StableName object died
+            debugTrace(DEBUG_stable, "GC'd StableName %ld (addr=%p)",
+                       (long)(p - stable_name_table), p->addr);
+            p->addr = NULL;
+            return;
+        }
+    }
+    /* If sn_obj became NULL, the object died, and addr is now
+     * invalid. But if sn_obj was null, then the StableName
+     * object may not have been created yet, while the pointee
+     * already exists and must be updated to new location. */
+    if (p->addr != NULL) {
+        p->addr = (StgPtr)isAlive((StgClosure *)p->addr);
+        if (p->addr == NULL) {
+            // StableName pointee died
+            debugTrace(DEBUG_stable, "GC'd pointee %ld",
+                       (long)(p - stable_name_table));
+        }
+    }
+}
+
+static void
+gcStableNameChunks (void)
+{
+    StgWord i, start, end;
+
+    for (;;) {
+        start = atomic_inc(&sn_gc_next, SN_GC_CHUNK) - SN_GC_CHUNK;
+        if (start >= sn_gc_work_n) break;
+        end = stg_min(start + SN_GC_CHUNK, sn_gc_work_n);
+        for (i = start; i < end; i++) {
+            gcStableNameEntry(&stable_name_table[sn_gc_work[i]]);
+        }
+    }
+}
+
+/*
+ * Called by the main GC thread once the heap has been fully marked,
+ * but before shutdown_gc_threads(), so that the other GC threads can
+ * take part.
+ */
 void
 gcStableTables( void )
 {
-    FOR_EACH_STABLE_NAME(
-        p, {
-            // Update the pointer to the StableName object, if there is one
-            if (p->sn_obj != NULL) {
-                p->sn_obj = isAlive(p->sn_obj);
-                if(p->sn_obj == NULL) {
-                    // StableName object died
-                    debugTrace(DEBUG_stable, "GC'd StableName %ld (addr=%p)",
-                               (long)(p - stable_name_table), p->addr);
-                    freeSnEntry(p);
-                    /* Can't "continue", so use goto */
-                    goto next_stable_name;
-                }
-            }
-            /* If sn_obj became NULL, the object died, and addr is now
-             * invalid. But if sn_obj was null, then the StableName
-             * object may not have been created yet, while the pointee
-             * already exists and must be updated to new location. */
-            if (p->addr != NULL) {
-                p->addr = (StgPtr)isAlive((StgClosure *)p->addr);
-                if(p->addr == NULL) {
-                    // StableName pointee died
-                    debugTrace(DEBUG_stable, "GC'd pointee %ld",
-                               (long)(p - stable_name_table));
-                }
-            }
-    next_stable_name:
-            if (0) {}
-        });
+    write_barrier();
+    sn_gc_ready = 1;
+    gcStableNameChunks();
 }
 
+#ifdef THREADED_RTS
+/*
+ * Called by the other GC threads when they have finished scavenging:
+ * wait until the main GC thread has finished with the weak pointers,
+ * after which liveness is final, and help with gcStableTables().
+ */
+void
+gcStableTablesWorker( void )
+{
+    uint32_t spins = 0;
+
+    while (sn_gc_ready == 0) {
+        busy_wait_nop();
+        if (++spins == 1000) {
+            yieldThread();
+            spins = 0;
+        }
+    }
+    load_load_barrier();
+    gcStableNameChunks();
+}
+#endif
+
 /* -----------------------------------------------------------------------------
  * Update the StableName hash table
  *
@@ -585,34 +800,47 @@ gcStableTables( void )
  * being done, so we might as well throw away the hash table and build
  * a new one.  For a minor collection, we just re-hash the elements
  * that changed.
+ *
+ * This is also where the entries that gcStableTables() found to be
+ * dead are freed, and the survivors are filed under the generation
+ * they now refer to.
  * -------------------------------------------------------------------------- */
 
 void
 updateStableTables(rtsBool full)
 {
+    uint32_t i;
+    StgWord sn;
+    snEntry *p;
+
     if (full && addrToStableHash != NULL && 0 != keyCountHashTable(addrToStableHash)) {
         freeHashTable(addrToStableHash,NULL);
         addrToStableHash = allocHashTable();
     }
 
-    if(full) {
-        FOR_EACH_STABLE_NAME(
-            p, {
-                if (p->addr != NULL) {
-                    // Target still alive, Re-hash this stable name
-                    insertHashTable(addrToStableHash, (W_)p->addr, (void *)(p - stable_name_table));
-                }
-            });
-    } else {
-        FOR_EACH_STABLE_NAME(
-            p, {
-                if (p->addr != p->old) {
-                    removeHashTable(addrToStableHash, (W_)p->old, NULL);
-                    /* Movement happened: */
-                    if (p->addr != NULL) {
-                        insertHashTable(addrToStableHash, (W_)p->addr, (void *)(p - stable_name_table));
-                    }
-                }
-            });
+    for (i = 0; i < sn_gc_work_n; i++) {
+        sn = sn_gc_work[i];
+        p = &stable_name_table[sn];
+
+        if (p->sn_obj == NULL && p->addr == NULL) {
+            freeSnEntry(p);
+            continue;
+        }
+
+        if (full) {
+            if (p->addr != NULL) {
+                // Target still alive, Re-hash this stable name
+                insertHashTable(addrToStableHash, (W_)p->addr, (void *)sn);
+            }
+        } else if (p->addr != p->old) {
+            removeHashTable(addrToStableHash, (W_)p->old, (void *)sn);
+            /* Movement happened: */
+            if (p->addr != NULL) {
+                insertHashTable(addrToStableHash, (W_)p->addr, (void *)sn);
+            }
+        }
+
+        pushSnGenList(snEntryGen(p), sn);
     }
+    sn_gc_work_n = 0;
 }
@@ -27,18 +27,24 @@ void    freeStablePtrUnsafe   ( StgStablePtr sp );
 void    initStableTables      ( void );
 void    exitStableTables      ( void );
 StgWord lookupStableName      ( StgPtr p );
+rtsBool hasStableName         ( StgClosure *p );
 
 /* Call given function on every stable ptr. markStableTables depends
  * on the function updating its pointers in case the object is
  * moved. */
-/* TODO: This also remembers old stable name addresses, which isn't
- * necessary in some contexts markStableTables is called from.
- * Consider splitting it.
- */
 void    markStableTables      ( evac_fn evac, void *user );
 
+/* Collect the stable names that refer to the generations being
+ * collected (up to N), which gcStableTables and updateStableTables
+ * then work on.  Only for GarbageCollect().
+ */
+void    rememberOldStableNameAddresses ( void );
+
 void    threadStableTables    ( evac_fn evac, void *user );
 void    gcStableTables        ( void );
+#ifdef THREADED_RTS
+void    gcStableTablesWorker  ( void );
+#endif
 void    updateStableTables    ( rtsBool full );
 
 void    stableLock            ( void );
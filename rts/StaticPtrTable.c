@@ -14,16 +14,16 @@
 #include "Hash.h"
 #include "Stable.h"
 
-static HashTable * spt = NULL;
+static OpenHashTable * spt = NULL;
 
 #ifdef THREADED_RTS
 static Mutex spt_lock;
 #endif
 
 /// Hash function for the SPT.
-static int hashFingerprint(HashTable *table, StgWord64 key[2]) {
-  // Take half of the key to compute the hash.
-  return hashWord(table, (StgWord)key[1]);
+static StgWord hashFingerprint(StgWord64 key[2]) {
+  // The key is already a hash, take half of it.
+  return (StgWord)key[1];
 }
 
 /// Comparison function for the SPT.
@@ -35,9 +35,9 @@ void hs_spt_insert(StgWord64 key[2],void *spe_closure) {
   // hs_spt_insert is called from constructor functions, so
   // the SPT needs to be initialized here.
   if (spt == NULL) {
-    spt = allocHashTable_( (HashFunction *)hashFingerprint
-                         , (CompareFunction *)compareFingerprint
-                         );
+    spt = allocOpenHashTable( (OpenHashFunction *)hashFingerprint
+                            , (CompareFunction *)compareFingerprint
+                            );
 #ifdef THREADED_RTS
     initMutex(&spt_lock);
 #endif
@@ -51,7 +51,7 @@ void hs_spt_insert(StgWord64 key[2],void *spe_closure) {
                                        );
   *entry = getStablePtr(spe_closure);
   ACQUIRE_LOCK(&spt_lock);
-  insertHashTable(spt, (StgWord)key, entry);
+  insertOpenHashTable(spt, (StgWord)key, entry);
   RELEASE_LOCK(&spt_lock);
 }
 
@@ -63,7 +63,7 @@ static void freeSptEntry(void* entry) {
 void hs_spt_remove(StgWord64 key[2]) {
    if (spt) {
      ACQUIRE_LOCK(&spt_lock);
-     StgStablePtr* entry = removeHashTable(spt, (StgWord)key, NULL);
+     StgStablePtr* entry = removeOpenHashTable(spt, (StgWord)key, NULL);
      RELEASE_LOCK(&spt_lock);
 
      if (entry)
@@ -74,7 +74,7 @@ void hs_spt_remove(StgWord64 key[2]) {
 StgPtr hs_spt_lookup(StgWord64 key[2]) {
   if (spt) {
     ACQUIRE_LOCK(&spt_lock);
-    const StgStablePtr * entry = lookupHashTable(spt, (StgWord)key);
+    const StgStablePtr * entry = lookupOpenHashTable(spt, (StgWord)key);
     const StgPtr ret = entry ? deRefStablePtr(*entry) : NULL;
     RELEASE_LOCK(&spt_lock);
     return ret;
@@ -85,7 +85,7 @@ StgPtr hs_spt_lookup(StgWord64 key[2]) {
 int hs_spt_keys(StgPtr keys[], int szKeys) {
   if (spt) {
     ACQUIRE_LOCK(&spt_lock);
-    const int ret = keysHashTable(spt, (StgWord*)keys, szKeys);
+    const int ret = keysOpenHashTable(spt, (StgWord*)keys, szKeys);
     RELEASE_LOCK(&spt_lock);
     return ret;
   } else
@@ -93,12 +93,12 @@ int hs_spt_keys(StgPtr keys[], int szKeys) {
 }
 
 int hs_spt_key_count() {
-  return spt ? keyCountHashTable(spt) : 0;
+  return spt ? keyCountOpenHashTable(spt) : 0;
 }
 
 void exitStaticPtrTable() {
   if (spt) {
-    freeHashTable(spt, freeSptEntry);
+    freeOpenHashTable(spt, freeSptEntry);
     spt = NULL;
 #ifdef THREADED_RTS
     closeMutex(&spt_lock);
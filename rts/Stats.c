@@ -661,6 +661,22 @@ stat_exit (void)
             }
 #endif
 
+            {
+                uint32_t i;
+                W_ hits = 0, misses = 0;
+                for (i = 0; i < n_capabilities; i++) {
+                    hits   += capabilities[i]->stack_chunk_hits;
+                    misses += capabilities[i]->stack_chunk_misses;
+                }
+
+                // See Note [Stack chunk cache] in Threads.c
+                if (hits + misses > 0) {
+                    statsPrintf("  STACK CHUNKS: %" FMT_Word " (%" FMT_Word " reused from cache, %.1f%% hit rate)\n\n",
+                                hits + misses, hits,
+                                100.0 * (double)hits / (double)(hits + misses));
+                }
+            }
+
             statsPrintf("  INIT    time  %7.3fs  (%7.3fs elapsed)\n",
                         TimeToSecondsDbl(init_cpu), TimeToSecondsDbl(init_elapsed));
 
@@ -415,8 +415,8 @@ workerTaskStop (Task *task)
 
 #if defined(THREADED_RTS)
 
-static void OSThreadProcAttr
-workerStart(Task *task)
+static Capability *
+workerSetup(Task *task)
 {
     Capability *cap;
 
@@ -437,12 +437,39 @@ workerStart(Task *task)
 
     newInCall(task);
 
+    return cap;
+}
+
+static void OSThreadProcAttr
+workerStart(Task *task)
+{
+    Capability *cap;
+
+    cap = workerSetup(task);
+
     // Everything set up; emit the event before the worker starts working.
     traceTaskCreate(task, cap);
 
     scheduleWorker(cap,task);
 }
 
+static void OSThreadProcAttr
+spareWorkerStart(Task *task)
+{
+    Capability *cap;
+
+    workerSetup(task);
+
+    // We're on cap->spare_workers, wait to be given the Capability.
+    // See startSpareWorkerTask().
+    cap = waitForWorkerCapability(task);
+
+    // We can only emit the event once we own the Capability.
+    traceTaskCreate(task, cap);
+
+    scheduleWorker(cap,task);
+}
+
 void
 startWorkerTask (Capability *cap)
 {
@@ -483,6 +510,45 @@ startWorkerTask (Capability *cap)
   RELEASE_LOCK(&task->lock);
 }
 
+void
+startSpareWorkerTask (Capability *cap)
+{
+  int r;
+  OSThreadId tid;
+  Task *task;
+
+  task = newTask(rtsTrue);
+
+  // As in startWorkerTask(), the lock makes sure that we have finished
+  // setting up the Task structure before the worker thread reads it.
+  ACQUIRE_LOCK(&task->lock);
+
+  task->cap = cap;
+  task->node = cap->node;
+
+  // Unlike startWorkerTask(), the new worker doesn't get the
+  // Capability: it goes on the spare_workers list, and waits there in
+  // waitForWorkerCapability() until releaseCapability_() hands it the
+  // Capability, as it would a worker that had run out of work.
+  ASSERT_LOCK_HELD(&cap->lock);
+  task->next = cap->spare_workers;
+  cap->spare_workers = task;
+  cap->n_spare_workers++;
+
+  r = createOSThread(&tid, "ghc_worker", (OSThreadProc*)spareWorkerStart,
+                     task);
+  if (r != 0) {
+    sysErrorBelch("failed to create OS thread");
+    stg_exit(EXIT_FAILURE);
+  }
+
+  debugTrace(DEBUG_sched, "new spare worker task (taskCount: %d)", taskCount);
+
+  task->id = tid;
+
+  RELEASE_LOCK(&task->lock);
+}
+
 void
 interruptWorkerTask (Task *task)
 {
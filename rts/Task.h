@@ -245,6 +245,13 @@ INLINE_HEADER Task *myTask (void);
 //
 void startWorkerTask (Capability *cap);
 
+// Starts a worker that waits on cap->spare_workers until it is given
+// the Capability (+RTS -qp).  See Note [Spinning for a Capability] in
+// Capability.c.
+// Requires: cap->lock.
+//
+void startSpareWorkerTask (Capability *cap);
+
 // Interrupts a worker task that is performing an FFI call.  The thread
 // should not be destroyed.
 //
@@ -15,6 +15,7 @@
 #include "RaiseAsync.h"
 #include "Trace.h"
 #include "Threads.h"
+#include "BlackHoles.h"
 
 #include <string.h> // for memmove()
 
@@ -284,6 +285,8 @@ threadPaused(Capability *cap, StgTSO *tso)
                            "suspending duplicate work: %ld words of stack",
                            (long)((StgPtr)frame - tso->stackobj->sp));
 
+                recordDuplicateWork(bh);
+
                 // If this closure is already an indirection, then
                 // suspend the computation up to this point.
                 // NB. check raiseAsync() to see what happens when
@@ -325,6 +328,14 @@ threadPaused(Capability *cap, StgTSO *tso)
             }
 #endif
 
+            // Remember which thunk this was, before anyone else can
+            // see the BLACKHOLE: see Note [Blackhole contention] in
+            // BlackHoles.c
+            if (bh_info != &__stg_EAGER_BLACKHOLE_info &&
+                bh_info != &stg_CAF_BLACKHOLE_info) {
+                recordLazyBlackHole(bh, bh_info);
+            }
+
             // The payload of the BLACKHOLE points to the TSO
             ((StgInd *)bh)->indirectee = (StgClosure *)tso;
             write_barrier();
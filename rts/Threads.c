@@ -54,12 +54,47 @@ static StgThreadID next_thread_id = 1;
    createGenThread() and createIOThread() (in SchedAPI.h) are
    convenient packaged versions of this function.
    ------------------------------------------------------------------------ */
+
+/* Note [Recycling dead threads]
+   ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+   Programs that fork a thread for every request allocate a TSO and a
+   stack for each one, only for both to become garbage soon after.  So
+   the GC keeps some dead threads aside for createThread() to reuse:
+
+     - Once everything reachable has been evacuated, the threads left on
+       the old_threads lists are garbage (weak_stage == WeakDeadThreads,
+       see MarkWeak.c).  recycleDeadThreads() clears out up to
+       MAX_FREE_TSOS of them per Capability, and evacuates them onto
+       cap->free_tsos of the Capability they died on.  Only threads
+       whose stack is of the size createThread() gives a new thread with
+       the default -ki are kept.
+
+     - cap->free_tsos is a GC root (markCapability()), so recycled
+       threads that aren't reused survive, and soon get promoted to the
+       old generation, where minor GCs don't copy them again.
+
+     - createThread() takes a thread from the free list if its stack is
+       of the right size, instead of allocating.  The thread and its
+       stack may be in the old generation, so we use dirty_TSO() and
+       dirty_STACK(), and link the thread onto the threads list of the
+       generation it lives in rather than g0.
+
+   We only ever recycle a thread that is unreachable after the
+   finalizers of dead weak pointers have been evacuated: otherwise a
+   finalizer might end up holding the ThreadId of a new, unrelated
+   thread.  For the same reason we never recycle a thread that a stable
+   name refers to: the stable name would stay alive, and makeStableName
+   would return it for the new thread.
+*/
+
 StgTSO *
 createThread(Capability *cap, W_ size)
 {
     StgTSO *tso;
     StgStack *stack;
     uint32_t stack_size;
+    generation *gen;
 
     /* sched_mutex is *not* required */
 
@@ -80,16 +115,34 @@ createThread(Capability *cap, W_ size)
      * of a benchmark hack, but it doesn't do any harm.
      */
     stack_size = round_to_mblocks(size - sizeofW(StgTSO));
-    stack = (StgStack *)allocate(cap, stack_size);
-    TICK_ALLOC_STACK(stack_size);
-    SET_HDR(stack, &stg_STACK_info, cap->r.rCCCS);
-    stack->stack_size   = stack_size - sizeofW(StgStack);
-    stack->sp           = stack->stack + stack->stack_size;
-    stack->dirty        = 1;
 
-    tso = (StgTSO *)allocate(cap, sizeofW(StgTSO));
-    TICK_ALLOC_TSO();
-    SET_HDR(tso, &stg_TSO_info, CCS_SYSTEM);
+    tso = cap->free_tsos;
+    if (tso != END_TSO_QUEUE &&
+        tso->stackobj->stack_size == stack_size - sizeofW(StgStack)) {
+        // Reuse a dead thread: see Note [Recycling dead threads]
+        cap->free_tsos = tso->_link;
+        cap->n_free_tsos--;
+
+        stack = tso->stackobj;
+        SET_HDR(stack, &stg_STACK_info, cap->r.rCCCS);
+        stack->sp = stack->stack + stack->stack_size;
+        dirty_STACK(cap, stack);
+
+        SET_HDR(tso, &stg_TSO_info, CCS_SYSTEM);
+        dirty_TSO(cap, tso);
+    } else {
+        stack = (StgStack *)allocate(cap, stack_size);
+        TICK_ALLOC_STACK(stack_size);
+        SET_HDR(stack, &stg_STACK_info, cap->r.rCCCS);
+        stack->stack_size   = stack_size - sizeofW(StgStack);
+        stack->sp           = stack->stack + stack->stack_size;
+        stack->dirty        = 1;
+
+        tso = (StgTSO *)allocate(cap, sizeofW(StgTSO));
+        TICK_ALLOC_TSO();
+        SET_HDR(tso, &stg_TSO_info, CCS_SYSTEM);
+        tso->dirty = 1;
+    }
 
     // Always start with the compiled code evaluator
     tso->what_next = ThreadRunGHC;
@@ -98,7 +151,6 @@ createThread(Capability *cap, W_ size)
     tso->blocked_exceptions = END_BLOCKED_EXCEPTIONS_QUEUE;
     tso->bq = (StgBlockingQueue *)END_TSO_QUEUE;
     tso->flags = 0;
-    tso->dirty = 1;
     tso->_link = END_TSO_QUEUE;
 
     tso->saved_errno = 0;
@@ -108,6 +160,9 @@ createThread(Capability *cap, W_ size)
     tso->stackobj       = stack;
     tso->tot_stack_size = stack->stack_size;
 
+    tso->priority = ThreadPriorityNormal;
+    tso->run_queue_priority = ThreadPriorityNormal;
+
     ASSIGN_Int64((W_*)&(tso->alloc_limit), 0);
 
     tso->trec = NO_TREC;
@@ -121,12 +176,15 @@ createThread(Capability *cap, W_ size)
     SET_HDR((StgClosure*)stack->sp,
             (StgInfoTable *)&stg_stop_thread_info,CCS_SYSTEM);
 
-    /* Link the new thread on the global thread list.
+    /* Link the new thread on the global thread list.  A recycled
+     * thread may already have been promoted, so it goes on the list
+     * for its own generation.
      */
+    gen = Bdescr((P_)tso)->gen;
     ACQUIRE_LOCK(&sched_mutex);
     tso->id = next_thread_id++;  // while we have the mutex
-    tso->global_link = g0->threads;
-    g0->threads = tso;
+    tso->global_link = gen->threads;
+    gen->threads = tso;
     RELEASE_LOCK(&sched_mutex);
 
     // ToDo: report the stack size in the event?
@@ -506,6 +564,64 @@ isThreadBound(StgTSO* tso USED_IF_THREADS)
   return rtsFalse;
 }
 
+/* Note [Stack chunk cache]
+   ~~~~~~~~~~~~~~~~~~~~~~~~
+
+   A thread whose stack depth keeps moving back and forth across a chunk
+   boundary would allocate a new chunk on every overflow, and leave the
+   old one for the GC on every underflow (think of a deep recursive
+   parser called in a loop).  To avoid this churn, each Capability keeps
+   up to STACK_CHUNK_CACHE_SIZE empty chunks of the standard size
+   (+RTS -kc) in cap->stack_chunk_cache:
+
+     - threadStackUnderflow() adds the chunk it has just emptied, and
+       threadStackOverflow() adds the old chunk if it emptied it
+       completely.  Nothing else refers to the chunk at that point: a
+       STACK is only ever referenced by its TSO and by the underflow
+       frame of the chunk above it.
+
+     - threadStackOverflow() takes a chunk from the cache, if it needs
+       one of the standard size, before allocating.
+
+   The cache isn't a GC root: markCapability() empties it, and the GC
+   frees the chunks as it would have done without the cache.  So the
+   cache costs no memory beyond the current GC cycle, and we don't have
+   to worry about the cached chunks moving.
+
+   A chunk that was dirty when it was cached may still be on a mutable
+   list, so we leave its dirty flag alone when we reuse it; otherwise
+   dirty_STACK() would add it to the mutable list a second time.
+
+   Reusing a chunk isn't charged to the thread's allocation counter,
+   since nothing is allocated.
+
+   The number of chunks taken from the cache and allocated afresh are
+   counted in cap->stack_chunk_hits and cap->stack_chunk_misses, and
+   reported by +RTS -s.
+*/
+
+static void
+cacheStackChunk (Capability *cap, StgStack *stack)
+{
+    if (stack->stack_size + sizeofW(StgStack) ==
+            RtsFlags.GcFlags.stkChunkSize &&
+        cap->n_cached_stack_chunks < STACK_CHUNK_CACHE_SIZE) {
+        ASSERT(stack->sp == stack->stack + stack->stack_size);
+        cap->stack_chunk_cache[cap->n_cached_stack_chunks++] = stack;
+    }
+}
+
+static StgStack *
+takeCachedStackChunk (Capability *cap)
+{
+    if (cap->n_cached_stack_chunks == 0) {
+        cap->stack_chunk_misses++;
+        return NULL;
+    }
+    cap->stack_chunk_hits++;
+    return cap->stack_chunk_cache[--cap->n_cached_stack_chunks];
+}
+
 /* -----------------------------------------------------------------------------
    Stack overflow
 
@@ -521,6 +637,7 @@ threadStackOverflow (Capability *cap, StgTSO *tso)
     StgStack *new_stack, *old_stack;
     StgUnderflowFrame *frame;
     W_ chunk_size;
+    rtsBool discard_old_stack = rtsFalse;
 
     IF_DEBUG(sanity,checkTSO(tso));
 
@@ -598,23 +715,37 @@ threadStackOverflow (Capability *cap, StgTSO *tso)
         chunk_size = RtsFlags.GcFlags.stkChunkSize;
     }
 
-    debugTraceCap(DEBUG_sched, cap,
-                  "allocating new stack chunk of size %d bytes",
-                  chunk_size * sizeof(W_));
-
-    // Charge the current thread for allocating stack.  Stack usage is
-    // non-deterministic, because the chunk boundaries might vary from
-    // run to run, but accounting for this is better than not
-    // accounting for it, since a deep recursion will otherwise not be
-    // subject to allocation limits.
-    cap->r.rCurrentTSO = tso;
-    new_stack = (StgStack*) allocate(cap, chunk_size);
-    cap->r.rCurrentTSO = NULL;
-
-    SET_HDR(new_stack, &stg_STACK_info, old_stack->header.prof.ccs);
-    TICK_ALLOC_STACK(chunk_size);
-
-    new_stack->dirty = 0; // begin clean, we'll mark it dirty below
+    new_stack = NULL;
+    if (chunk_size == RtsFlags.GcFlags.stkChunkSize) {
+        new_stack = takeCachedStackChunk(cap);
+    }
+
+    if (new_stack != NULL) {
+        debugTraceCap(DEBUG_sched, cap, "reusing stack chunk %p", new_stack);
+
+        // Leave new_stack->dirty alone: if the chunk is dirty it may
+        // already be on the mutable list.
+        SET_HDR(new_stack, &stg_STACK_info, old_stack->header.prof.ccs);
+    } else {
+        debugTraceCap(DEBUG_sched, cap,
+                      "allocating new stack chunk of size %d bytes",
+                      chunk_size * sizeof(W_));
+
+        // Charge the current thread for allocating stack.  Stack usage is
+        // non-deterministic, because the chunk boundaries might vary from
+        // run to run, but accounting for this is better than not
+        // accounting for it, since a deep recursion will otherwise not be
+        // subject to allocation limits.
+        cap->r.rCurrentTSO = tso;
+        new_stack = (StgStack*) allocate(cap, chunk_size);
+        cap->r.rCurrentTSO = NULL;
+
+        SET_HDR(new_stack, &stg_STACK_info, old_stack->header.prof.ccs);
+        TICK_ALLOC_STACK(chunk_size);
+
+        new_stack->dirty = 0; // begin clean, we'll mark it dirty below
+    }
+
     new_stack->stack_size = chunk_size - sizeofW(StgStack);
     new_stack->sp = new_stack->stack + new_stack->stack_size;
 
@@ -662,6 +793,11 @@ threadStackOverflow (Capability *cap, StgTSO *tso)
             // first stack chunk will be discarded after the first
             // overflow, being replaced by a non-moving 32k chunk.
             //
+            // Nothing refers to the old chunk once we have switched
+            // tso->stackobj below, so it can go in the stack chunk
+            // cache if it is of the standard size.
+            //
+            discard_old_stack = rtsTrue;
         } else {
             new_stack->sp -= sizeofW(StgUnderflowFrame);
             frame = (StgUnderflowFrame*)new_stack->sp;
@@ -683,6 +819,10 @@ threadStackOverflow (Capability *cap, StgTSO *tso)
 
     tso->stackobj = new_stack;
 
+    if (discard_old_stack) {
+        cacheStackChunk(cap, old_stack);
+    }
+
     // we're about to run it, better mark it dirty
     dirty_STACK(cap, new_stack);
 
@@ -737,6 +877,10 @@ threadStackUnderflow (Capability *cap, StgTSO *tso)
     // restore the stack parameters, and update tot_stack_size
     tso->tot_stack_size -= old_stack->stack_size;
 
+    // nothing refers to the old stack any more, so keep it for the
+    // next time a stack on this Capability overflows.
+    cacheStackChunk(cap, old_stack);
+
     // we're about to run it, better mark it dirty
     dirty_STACK(cap, new_stack);
 
@@ -765,7 +909,7 @@ printThreadBlockage(StgTSO *tso)
     debugBelch("is blocked on write to fd %d", (int)(tso->block_info.fd));
     break;
   case BlockedOnDelay:
-    debugBelch("is blocked until %ld", (long)(tso->block_info.target));
+    debugBelch("is blocked on a delay");
     break;
 #endif
   case BlockedOnMVar:
@@ -787,6 +931,9 @@ printThreadBlockage(StgTSO *tso)
   case ThreadMigrating:
     debugBelch("is runnable, but not on the run queue");
     break;
+  case ThreadStealable:
+    debugBelch("is runnable, waiting to be stolen");
+    break;
   case BlockedOnCCall:
     debugBelch("is blocked on an external call");
     break;
@@ -831,7 +978,7 @@ void
 printAllThreads(void)
 {
   StgTSO *t, *next;
-  uint32_t i, g;
+  uint32_t i, g, p;
   Capability *cap;
 
   debugBelch("all threads:\n");
@@ -839,8 +986,10 @@ printAllThreads(void)
   for (i = 0; i < n_capabilities; i++) {
       cap = capabilities[i];
       debugBelch("threads on capability %d:\n", cap->no);
-      for (t = cap->run_queue_hd; t != END_TSO_QUEUE; t = t->_link) {
-          printThreadStatus(t);
+      for (p = 0; p < N_THREAD_PRIORITIES; p++) {
+          for (t = cap->run_queue_hd[p]; t != END_TSO_QUEUE; t = t->_link) {
+              printThreadStatus(t);
+          }
       }
   }
 
@@ -18,6 +18,11 @@ void startTicker (void);
 void stopTicker  (void);
 void exitTicker  (rtsBool wait);
 
+// Tickless idle, see Note [Tickless idle] in Timer.c.  idleTicker()
+// returns rtsFalse if this ticker can't skip ticks.
+rtsBool idleTicker (uint32_t ticks);
+void    wakeTicker (void);
+
 #include "EndPrivate.h"
 
 #endif /* TICKER_H */
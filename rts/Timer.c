@@ -24,13 +24,77 @@
 #include "Ticker.h"
 #include "Capability.h"
 #include "RtsSignals.h"
-
-/* ticks left before next pre-emptive context switch */
-static int ticks_to_ctxt_switch = 0;
+#include "GetTime.h"
 
 /* idle ticks left before we perform a GC */
 static int ticks_to_gc = 0;
 
+/* Note [Tickless idle]
+ * ~~~~~~~~~~~~~~~~~~~~
+ * The timer is only needed while Haskell code is running: to preempt
+ * it, and to sample it when profiling.  Once the RTS has gone idle the
+ * remaining ticks just count down to the idle GC, and then the timer
+ * is stopped (see recent_activity in Schedule.h).  On machines running
+ * lots of mostly-idle programs, that is still a wakeup every
+ * tickInterval for each program that ran anything in the last
+ * idleGCDelayTime.
+ *
+ * So when handle_tick() finds that no capability is running Haskell
+ * code, and we aren't profiling, it asks the ticker to skip the ticks
+ * until the idle GC is due (idleTicker()), and sets timer_idle.  When
+ * the scheduler starts running a thread, or a thread returns from a
+ * foreign call, it calls wakeTimer(), which resumes the regular ticks
+ * with wakeTicker().
+ *
+ * The ticker sets timer_idle, re-arms itself and then looks at the
+ * capabilities; the scheduler sets cap->r.rCurrentTSO before it looks
+ * at timer_idle.  So either the ticker sees that a capability is
+ * running and resumes ticking itself, or the scheduler sees timer_idle
+ * set and resumes the ticks after the ticker re-armed.  That needs a
+ * store/load barrier on both sides, but the scheduler passes this
+ * point every time it runs a thread, and the ticker only goes idle
+ * once per burst of activity.  So the ticker pays for both:
+ * idleTicker() forces a barrier on every running thread with
+ * membarrier(), and the scheduler only needs a compiler barrier (see
+ * wakeTimerIfIdle()).
+ *
+ * Only the pthread ticker with timerfd and membarrier() can skip
+ * ticks; the others keep ticking as before.
+ */
+volatile StgWord timer_idle = 0;
+
+static rtsBool
+anyCapabilityRunning (void)
+{
+    uint32_t i;
+
+    for (i = 0; i < n_capabilities; i++) {
+        if (capabilities[i]->r.rCurrentTSO != NULL) {
+            return rtsTrue;
+        }
+    }
+    return rtsFalse;
+}
+
+static rtsBool
+needProfTicks (void)
+{
+#ifdef PROFILING
+    if (RtsFlags.CcFlags.doCostCentres) {
+        return rtsTrue;
+    }
+#endif
+    return RtsFlags.ProfFlags.doHeapProfile != 0;
+}
+
+void
+wakeTimer (void)
+{
+    if (cas(&timer_idle, 1, 0) == 1) {
+        wakeTicker();
+    }
+}
+
 /*
  * Function: handle_tick()
  *
@@ -41,13 +105,11 @@ static
 void
 handle_tick(int unused STG_UNUSED)
 {
+  timer_idle = 0;
+
   handleProfTick();
   if (RtsFlags.ConcFlags.ctxtSwitchTicks > 0) {
-      ticks_to_ctxt_switch--;
-      if (ticks_to_ctxt_switch <= 0) {
-          ticks_to_ctxt_switch = RtsFlags.ConcFlags.ctxtSwitchTicks;
-          contextSwitchAllCapabilities(); /* schedule a context switch */
-      }
+      preemptCapabilities(getProcessElapsedTime());
   }
 
   /*
@@ -92,6 +154,24 @@ handle_tick(int unused STG_UNUSED)
   default:
       break;
   }
+
+  /*
+   * Skip the ticks until the idle GC if there is nothing to do until
+   * then, see Note [Tickless idle].
+   */
+  if (recent_activity == ACTIVITY_MAYBE_NO && ticks_to_gc > 0
+      && !needProfTicks() && !anyCapabilityRunning()) {
+      timer_idle = 1;
+      if (idleTicker(ticks_to_gc)) {
+          ticks_to_gc = 0;
+          if (anyCapabilityRunning()) {
+              timer_idle = 0;
+              wakeTicker();
+          }
+      } else {
+          timer_idle = 0;
+      }
+  }
 }
 
 // This global counter is used to allow multiple threads to stop the
@@ -12,4 +12,20 @@
 RTS_PRIVATE void initTimer (void);
 RTS_PRIVATE void exitTimer (rtsBool wait);
 
+// Set while the ticker is skipping ticks (Note [Tickless idle] in
+// Timer.c); call wakeTimerIfIdle() before running Haskell code.
+extern volatile StgWord timer_idle;
+RTS_PRIVATE void wakeTimer (void);
+
+// Call after setting cap->r.rCurrentTSO.  The ticker does the
+// expensive half of the barrier, so all we need here is to stop the
+// compiler from moving the load of timer_idle before that store.
+INLINE_HEADER void wakeTimerIfIdle (void)
+{
+    __asm__ __volatile__ ("" : : : "memory");
+    if (timer_idle) {
+        wakeTimer();
+    }
+}
+
 #endif /* TIMER_H */
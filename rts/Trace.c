@@ -32,6 +32,7 @@ int TRACE_spark_sampled;
 int TRACE_spark_full;
 int TRACE_user;
 int TRACE_cap;
+int TRACE_blackholes;
 
 #ifdef THREADED_RTS
 static Mutex trace_utx;
@@ -74,6 +75,9 @@ void initTracing (void)
     TRACE_user =
         RtsFlags.TraceFlags.user;
 
+    TRACE_blackholes =
+        RtsFlags.TraceFlags.blackholes;
+
     // We trace cap events if we're tracing anything else
     TRACE_cap =
         TRACE_sched ||
@@ -544,6 +548,27 @@ void traceSparkCounters_ (Capability *cap,
     }
 }
 
+#ifdef THREADED_RTS
+void traceThreadMigrationCounters_ (Capability *cap)
+{
+    uint32_t node;
+
+#ifdef DEBUG
+    if (RtsFlags.TraceFlags.tracing == TRACE_STDERR) {
+        /* the counters are only of interest in the eventlog */
+    } else
+#endif
+    {
+        for (node = 0; node < n_numa_nodes; node++) {
+            if (cap->thread_migrations[node] != 0) {
+                postThreadMigrationCountersEvent(cap, cap->node, node,
+                                                 cap->thread_migrations[node]);
+            }
+        }
+    }
+}
+#endif
+
 void traceTaskCreate_ (Task       *task,
                        Capability *cap)
 {
@@ -597,6 +622,24 @@ void traceHeapProfBegin(StgWord8 profile_id)
     }
 }
 
+void traceBlackHoleContention(const StgInfoTable *info,
+                              StgWord64 blocked, StgWord64 duplicated)
+{
+#ifdef DEBUG
+    if (RtsFlags.TraceFlags.tracing == TRACE_STDERR) {
+        ACQUIRE_LOCK(&trace_utx);
+        tracePreface();
+        debugBelch("blackhole contention: info %p: %" FMT_Word64
+                   " blocked, %" FMT_Word64 " duplicated\n",
+                   info, blocked, duplicated);
+        RELEASE_LOCK(&trace_utx);
+    } else
+#endif
+    if (eventlog_enabled) {
+        postBlackHoleContentionEvent(info, blocked, duplicated);
+    }
+}
+
 void traceHeapProfSampleBegin(StgInt era)
 {
     if (eventlog_enabled) {
@@ -655,6 +698,29 @@ static void traceCap_stderr(Capability *cap, char *msg, ...)
 }
 #endif
 
+#ifdef THREADED_RTS
+void traceTaskReturnWait_ (Capability *cap,
+                           Task       *task,
+                           Time        wait_start,
+                           rtsBool     parked)
+{
+    Time wait = getProcessElapsedTime() - wait_start;
+
+#ifdef DEBUG
+    if (RtsFlags.TraceFlags.tracing == TRACE_STDERR) {
+        traceCap_stderr(cap, "task %#" FMT_HexWord64 " waited %"
+                        FMT_Word64 "ns to return%s",
+                        serialisableTaskId(task), (StgWord64)TimeToNS(wait),
+                        parked ? " (slept)" : "");
+    } else
+#endif
+    {
+        postTaskReturnWaitEvent(cap, serialisableTaskId(task),
+                                TimeToNS(wait), parked ? 1 : 0);
+    }
+}
+#endif
+
 void traceCap_(Capability *cap, char *msg, ...)
 {
     va_list ap;
@@ -70,6 +70,7 @@ extern int TRACE_spark_sampled;
 extern int TRACE_spark_full;
 /* extern int TRACE_user; */  // only used in Trace.c
 extern int TRACE_cap;
+extern int TRACE_blackholes;
 
 // -----------------------------------------------------------------------------
 // Posting events
@@ -271,6 +272,10 @@ void traceSparkCounters_ (Capability *cap,
                           SparkCounters counters,
                           StgWord remaining);
 
+#ifdef THREADED_RTS
+void traceThreadMigrationCounters_ (Capability *cap);
+#endif
+
 void traceTaskCreate_ (Task       *task,
                        Capability *cap);
 
@@ -280,6 +285,16 @@ void traceTaskMigrate_ (Task       *task,
 
 void traceTaskDelete_ (Task       *task);
 
+#ifdef THREADED_RTS
+void traceTaskReturnWait_ (Capability *cap,
+                           Task       *task,
+                           Time        wait_start,
+                           rtsBool     parked);
+#endif
+
+void traceBlackHoleContention(const StgInfoTable *info,
+                              StgWord64 blocked, StgWord64 duplicated);
+
 void traceHeapProfBegin(StgWord8 profile_id);
 void traceHeapProfSampleBegin(StgInt era);
 void traceHeapProfSampleString(StgWord8 profile_id,
@@ -320,9 +335,12 @@ void traceHeapProfSampleCostCentre(StgWord8 profile_id,
 #define traceWallClockTime_() /* nothing */
 #define traceOSProcessInfo_() /* nothing */
 #define traceSparkCounters_(cap, counters, remaining) /* nothing */
+#define traceThreadMigrationCounters_(cap) /* nothing */
 #define traceTaskCreate_(taskID, cap) /* nothing */
 #define traceTaskMigrate_(taskID, cap, new_cap) /* nothing */
 #define traceTaskDelete_(taskID) /* nothing */
+#define traceTaskReturnWait_(cap, task, wait_start, parked) /* nothing */
+#define traceBlackHoleContention(info, blocked, duplicated) /* nothing */
 #define traceHeapProfBegin(profile_id) /* nothing */
 #define traceHeapProfCostCentre(ccID, label, module, srcloc, is_caf) /* nothing */
 #define traceHeapProfSampleBegin(era) /* nothing */
@@ -780,6 +798,15 @@ INLINE_HEADER void traceSparkCounters(Capability *cap STG_UNUSED)
 #endif
 }
 
+INLINE_HEADER void traceThreadMigrationCounters(Capability *cap STG_UNUSED)
+{
+#ifdef THREADED_RTS
+    if (RTS_UNLIKELY(TRACE_sched)) {
+        traceThreadMigrationCounters_(cap);
+    }
+#endif
+}
+
 INLINE_HEADER void traceEventSparkCreate(Capability *cap STG_UNUSED)
 {
     traceSparkEvent(cap, EVENT_SPARK_CREATE);
@@ -857,6 +884,20 @@ INLINE_HEADER void traceTaskMigrate(Task       *task    STG_UNUSED,
                                                 (EventCapNo)new_cap->no);
 }
 
+INLINE_HEADER void traceTaskReturnWait(Capability *cap        STG_UNUSED,
+                                       Task       *task       STG_UNUSED,
+                                       Time        wait_start STG_UNUSED,
+                                       rtsBool     parked     STG_UNUSED)
+{
+#ifdef THREADED_RTS
+    // A Task returning from a foreign call has waited since wait_start
+    // to get cap.  See Note [Spinning for a Capability] in Capability.c.
+    if (RTS_UNLIKELY(TRACE_sched)) {
+        traceTaskReturnWait_(cap, task, wait_start, parked);
+    }
+#endif
+}
+
 INLINE_HEADER void traceTaskDelete(Task *task STG_UNUSED)
 {
     ASSERT(task->cap != NULL);
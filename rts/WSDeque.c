@@ -225,6 +225,59 @@ stealWSDeque (WSDeque *q)
     return stolen;
 }
 
+/* -----------------------------------------------------------------------------
+ * stealHalfWSDeque_
+ *
+ * Steal up to half of the elements of the deque (but at most max) from
+ * the "read" end with a single cas, copying them into buf in order.
+ * Returns the number of elements stolen, which is 0 if the deque was
+ * empty or if we lost a race with another thief.
+ *
+ * This is only safe if the owner of the deque never calls popWSDeque():
+ * a pop only synchronises with thieves when it takes the last element,
+ * so it could take one of the elements we are about to steal.  The
+ * spark pools are fine, because the owner steals its own sparks too
+ * (see findSpark()).  Pushing is fine, because pushWSDeque() never
+ * overwrites the elements between top and bottom.
+ * -------------------------------------------------------------------------- */
+
+uint32_t
+stealHalfWSDeque_ (WSDeque *q, void **buf, uint32_t max)
+{
+    StgWord b,t;
+    long n;
+    uint32_t i;
+
+    // NB. these loads must be ordered, see stealWSDeque_()
+    t = q->top;
+    load_load_barrier();
+    b = q->bottom;
+
+    n = (long)b - (long)t;
+    if (n <= 0 || max == 0) {
+        return 0; /* already looks empty, abort */
+    }
+
+    // take half, rounding up, so that we take the last element too
+    n = (n + 1) / 2;
+    if (n > (long)max) {
+        n = max;
+    }
+
+    /* now access array, see pushBottom() */
+    for (i = 0; i < n; i++) {
+        buf[i] = q->elements[(t + i) & q->moduloSize];
+    }
+
+    /* now decide whether we have won */
+    if ( !(CASTOP(&(q->top),t,t+n)) ) {
+        /* lost the race, someone else has changed top in the meantime */
+        return 0;
+    }
+
+    return n;
+}
+
 /* -----------------------------------------------------------------------------
  * pushWSQueue
  * -------------------------------------------------------------------------- */
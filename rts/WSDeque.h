@@ -90,6 +90,12 @@ void * stealWSDeque_ (WSDeque *q);
 // NULL if the pool is empty.
 void * stealWSDeque (WSDeque *q);
 
+// Removes up to half of the elements (at most max) from the "read"
+// end into buf, and returns how many.  Returns 0 if the pool is empty
+// or if there was a collision with another thief.  Not safe if the
+// owner uses popWSDeque().
+uint32_t stealHalfWSDeque_ (WSDeque *q, void **buf, uint32_t max);
+
 // "guesses" whether a deque is empty. Can return false negatives in
 //  presence of concurrent steal() calls, and false positives in
 //  presence of a concurrent pushBottom().
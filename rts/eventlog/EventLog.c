@@ -115,6 +115,9 @@ char *EventDesc[] = {
   [EVENT_HEAP_PROF_SAMPLE_BEGIN]  = "Start of heap profile sample",
   [EVENT_HEAP_PROF_SAMPLE_STRING] = "Heap profile string sample",
   [EVENT_HEAP_PROF_SAMPLE_COST_CENTRE] = "Heap profile cost-centre sample",
+  [EVENT_THREAD_MIGRATION_COUNTERS] = "Thread migration counters",
+  [EVENT_TASK_RETURN_WAIT]    = "Task waited to return from foreign call",
+  [EVENT_BLACKHOLE_CONTENTION] = "Blackhole contention counters",
 };
 
 // Event type.
@@ -507,6 +510,20 @@ writeEventLoggingHeader(EventsBuf *eb)
             eventTypes[t].size = EVENT_SIZE_DYNAMIC;
             break;
 
+        case EVENT_THREAD_MIGRATION_COUNTERS: // (from_node, to_node, count)
+            eventTypes[t].size =
+                2 * sizeof(EventNumaNode) + sizeof(StgWord64);
+            break;
+
+        case EVENT_TASK_RETURN_WAIT: // (taskID, wait, parked)
+            eventTypes[t].size =
+                sizeof(EventTaskId) + sizeof(StgWord64) + sizeof(StgWord8);
+            break;
+
+        case EVENT_BLACKHOLE_CONTENTION: // (info, blocked, duplicated)
+            eventTypes[t].size = 3 * sizeof(StgWord64);
+            break;
+
         default:
             continue; /* ignore deprecated events */
         }
@@ -736,6 +753,58 @@ postSparkCountersEvent (Capability *cap,
     postWord64(eb,remaining);
 }
 
+void
+postThreadMigrationCountersEvent (Capability    *cap,
+                                  EventNumaNode  from_node,
+                                  EventNumaNode  to_node,
+                                  StgWord64      count)
+{
+    EventsBuf *eb;
+
+    eb = &capEventBuf[cap->no];
+    ensureRoomForEvent(eb, EVENT_THREAD_MIGRATION_COUNTERS);
+
+    postEventHeader(eb, EVENT_THREAD_MIGRATION_COUNTERS);
+    /* EVENT_THREAD_MIGRATION_COUNTERS (from_node, to_node, count) */
+    postWord16(eb,from_node);
+    postWord16(eb,to_node);
+    postWord64(eb,count);
+}
+
+void
+postTaskReturnWaitEvent (Capability  *cap,
+                         EventTaskId  taskId,
+                         StgWord64    wait,
+                         StgWord8     parked)
+{
+    EventsBuf *eb;
+
+    eb = &capEventBuf[cap->no];
+    ensureRoomForEvent(eb, EVENT_TASK_RETURN_WAIT);
+
+    postEventHeader(eb, EVENT_TASK_RETURN_WAIT);
+    /* EVENT_TASK_RETURN_WAIT (taskID, wait, parked) */
+    postTaskId(eb,taskId);
+    postWord64(eb,wait);
+    postWord8(eb,parked);
+}
+
+void
+postBlackHoleContentionEvent (const StgInfoTable *info,
+                              StgWord64           blocked,
+                              StgWord64           duplicated)
+{
+    ACQUIRE_LOCK(&eventBufMutex);
+    ensureRoomForEvent(&eventBuf, EVENT_BLACKHOLE_CONTENTION);
+
+    postEventHeader(&eventBuf, EVENT_BLACKHOLE_CONTENTION);
+    /* EVENT_BLACKHOLE_CONTENTION (info, blocked, duplicated) */
+    postWord64(&eventBuf,(StgWord64)(StgWord)info);
+    postWord64(&eventBuf,blocked);
+    postWord64(&eventBuf,duplicated);
+    RELEASE_LOCK(&eventBufMutex);
+}
+
 void
 postCapEvent (EventTypeNum  tag,
               EventCapNo    capno)
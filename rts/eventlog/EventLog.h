@@ -93,6 +93,32 @@ void postSparkCountersEvent (Capability *cap,
                              SparkCounters counters,
                              StgWord remaining);
 
+/*
+ * Post the number of threads that have been pushed from one NUMA node
+ * to another.
+ */
+void postThreadMigrationCountersEvent (Capability    *cap,
+                                       EventNumaNode  from_node,
+                                       EventNumaNode  to_node,
+                                       StgWord64      count);
+
+/*
+ * Post the time (in nanoseconds) that a Task returning from a foreign
+ * call waited for its Capability, and whether it had to sleep.
+ */
+void postTaskReturnWaitEvent (Capability  *cap,
+                              EventTaskId  taskId,
+                              StgWord64    wait,
+                              StgWord8     parked);
+
+/*
+ * Post the blackhole contention counters for one thunk info table
+ * (see Note [Blackhole contention] in BlackHoles.c)
+ */
+void postBlackHoleContentionEvent (const StgInfoTable *info,
+                                   StgWord64           blocked,
+                                   StgWord64           duplicated);
+
 /*
  * Post an event to annotate a thread with a label
  */
@@ -8,6 +8,8 @@
 
 #include "Rts.h"
 #include "sm/OSMem.h"
+#include "Hash.h"
+#include "RtsUtils.h"
 #include "linker/M32Alloc.h"
 
 #include <inttypes.h>
@@ -58,42 +60,44 @@ try to fill pages as much as we can for small objects.
 How does it work?
 -----------------
 
-For small objects, a Word64 counter is added at the beginning of the page they
-are stored in. It indicates the number of objects that are still alive in the
-page. When the counter drops down to zero, the page is freed. The counter is
-atomically decremented, hence the deallocation is thread-safe.
-
-During the allocation phase, the allocator keeps track of some pages that are
-not totally filled: the number of pages in the "filling" list is configurable
-with M32_MAX_PAGES. Allocation consists in finding some place in one of these
-pages or starting a new one, then increasing the page counter. If none of the
-pages in the "filling" list has enough free space, the most filled one is
-flushed (see below) and a new one is allocated.
-
-The allocator holds a reference on pages in the "filling" list: the counter in
-these pages is 1+n where n is the current number of objects allocated in the
-page. Hence allocated objects can be freed while the allocator is using
-(filling) the page. Flushing a page consists in decreasing its counter and
-removing it from the "filling" list. By extension, flushing the allocator
-consists in flushing all the pages in the "filling" list.  Don't forget to
-flush the allocator at the end of the allocation phase in order to avoid space
-leaks!
-
-Large objects are objects that are larger than a page (minus the bytes required
-for the counter and the optional padding). These objects are allocated into
-their own set of pages.  We can differentiate large and small objects from
-their address: large objects are aligned on page size while small objects never
-are (because of the space reserved for the page's object counter).
-
-For large objects, the remaining space at the end of the last page is left
-unused by the allocator. It can be used with care as it will be freed with the
-associated large object. GHC linker uses this feature/hack, hence changing the
-implementation of the M32 allocator must be done with care (i.e. do not try to
-improve the allocator to avoid wasting this space without modifying the linker
-code accordingly).
-
-Object allocation is *not* thread-safe (however it could be done easily with a
-lock in the allocator structure). Object deallocation is thread-safe.
+Memory comes from three pools (M32Pool): code, read-only data and writable
+data.  Pages are never shared between pools, so that only the pages of the
+code pool need to be executable: the others are mapped PROT_READ|PROT_WRITE.
+Read-only data stays writable, because the linker relocates sections in
+place after allocating them, and a page may be shared by objects loaded at
+different times.
+
+Small objects are allocated from slabs: pages divided into slots of one
+size class.  The size classes are the powers of two from M32_MIN_SIZE to half
+a page, and an object gets the smallest class that is at least as big as
+both its size and its alignment; a slot is aligned to its size, since pages
+are.  Each pool has, for each size class, a list of the pages that have free
+slots.  A page keeps its freed slots on a free list, linked through the
+first word of each slot, and hands out the slots that have never been used
+from its end (n_fresh), so a new page doesn't need to be initialised.
+
+The descriptors of the pages (struct m32_page_t) are kept out of the pages
+themselves, in the hash table `alloc.pages` indexed by page address, so that
+a page can be divided into slots without losing any space to a header.
+Freeing an object looks up the page it is in, and puts the slot back on the
+page's free list, and the page back on its list if it was full.  When a
+page becomes empty, it is unmapped, except that each size class keeps one
+empty page as a spare, so that loading and unloading an object repeatedly
+doesn't map and unmap pages each time.  Flushing the allocator
+(m32_allocator_flush) releases the spares.
+
+Large objects are objects that are bigger than half a page, or need
+stronger alignment.  These objects are allocated into their own set of
+pages, which also have a descriptor in `alloc.pages`.  For large objects,
+the remaining space at the end of the last page is left unused by the
+allocator.
+
+The allocator keeps count of the bytes it has mapped for each pool and of
+the bytes it has handed out, which the linker reports with
+getLinkerMemStats().
+
+Allocation and deallocation take a lock, since objects may be freed by the
+GC (see checkUnload()) while the linker is allocating.
 
 */
 
@@ -104,26 +108,49 @@ lock in the allocator structure). Object deallocation is thread-safe.
  * M32 ALLOCATOR (see Note [M32 Allocator]
  ***************************************************************************/
 
-#define M32_MAX_PAGES 32
-#define M32_REFCOUNT_BYTES 8
+#define M32_MIN_SIZE_LOG2 4
+#define M32_MIN_SIZE (1 << M32_MIN_SIZE_LOG2)
 
+// enough size classes for 1MB pages
+#define M32_MAX_CLASSES 16
+
+// the "size class" of large objects
+#define M32_LARGE 0xff
+
+/**
+ * A page of slots of one size class, or the pages of a large object
+ */
+struct m32_page_t {
+   struct m32_page_t *next;      // Pages of the class that have free slots
+   struct m32_page_t *prev;
+   char     *base_addr;          // Page address
+   void     *free;               // Freed slots
+   uint32_t  n_used;             // Number of slots allocated
+   uint32_t  n_fresh;            // Number of slots never allocated
+   uint8_t   pool;
+   uint8_t   size_class;         // or M32_LARGE
+};
 
 /**
- * An allocated page being filled by the allocator
+ * The pages of one size class in one pool
  */
-struct m32_alloc_t {
-   void * base_addr;             // Page address
-   size_t current_size;          // Number of bytes already reserved
+struct m32_class_t {
+   struct m32_page_t *pages;     // Pages with free slots
+   struct m32_page_t *spare;     // An empty page, or NULL
 };
 
 /**
  * Allocator
- *
- * Currently an allocator is just a set of pages being filled. The maximum
- * number of pages can be configured with M32_MAX_PAGES.
  */
 typedef struct m32_allocator_t {
-   struct m32_alloc_t pages[M32_MAX_PAGES];
+   struct m32_class_t classes[M32_N_POOLS][M32_MAX_CLASSES];
+   uint32_t n_classes;           // Size classes that fit in half a page
+   HashTable *pages;             // Page address -> struct m32_page_t
+   StgWord64 mapped[M32_N_POOLS];// Bytes mapped for each pool
+   StgWord64 allocated;          // Bytes handed out by m32_alloc
+#if defined(THREADED_RTS)
+   Mutex lock;
+#endif
 } m32_allocator;
 
 // We use a global memory allocator
@@ -144,6 +171,33 @@ munmapForLinker (void * addr, size_t size)
    }
 }
 
+/**
+ * Map `size` bytes for the given pool, with the pool's protection.
+ */
+static void *
+m32_map(M32Pool pool, size_t size)
+{
+   void *addr = mmapForLinker(size,MAP_ANONYMOUS,-1,0);
+   if (addr == NULL) {
+      return NULL;
+   }
+   if (pool != M32_CODE
+       && mprotect(addr, roundUpToPage(size), PROT_READ|PROT_WRITE) == -1) {
+      sysErrorBelch("mprotect");
+   }
+   alloc.mapped[pool] += roundUpToPage(size);
+   return addr;
+}
+
+/**
+ * The number of slots in a page of the given size class
+ */
+static uint32_t
+m32_slots(uint8_t size_class)
+{
+   return getPageSize() >> (size_class + M32_MIN_SIZE_LOG2);
+}
+
 /**
  * Initialize the allocator structure
  * This is the real implementation. There is another dummy implementation below.
@@ -153,65 +207,81 @@ void
 m32_allocator_init(void)
 {
    memset(&alloc, 0, sizeof(struct m32_allocator_t));
-   // Preallocate the initial M32_MAX_PAGES to ensure that they don't
-   // fragment the memory.
-   size_t pgsz = getPageSize();
-   char* bigchunk = mmapForLinker(pgsz * M32_MAX_PAGES,MAP_ANONYMOUS,-1,0);
-   int i;
-   for (i=0; i<M32_MAX_PAGES; i++) {
-      alloc.pages[i].base_addr = bigchunk + i*pgsz;
-      *((uintptr_t*)alloc.pages[i].base_addr) = 1;
-      alloc.pages[i].current_size = M32_REFCOUNT_BYTES;
+   while (alloc.n_classes < M32_MAX_CLASSES
+          && (M32_MIN_SIZE << alloc.n_classes) <= getPageSize() / 2) {
+      alloc.n_classes++;
+   }
+   alloc.pages = allocHashTable();
+#if defined(THREADED_RTS)
+   initMutex(&alloc.lock);
+#endif
+}
+
+static void
+m32_push_page(struct m32_class_t *c, struct m32_page_t *page)
+{
+   page->prev = NULL;
+   page->next = c->pages;
+   if (c->pages != NULL) {
+      c->pages->prev = page;
+   }
+   c->pages = page;
+}
+
+static void
+m32_unlink_page(struct m32_class_t *c, struct m32_page_t *page)
+{
+   if (page->prev != NULL) {
+      page->prev->next = page->next;
+   } else {
+      c->pages = page->next;
+   }
+   if (page->next != NULL) {
+      page->next->prev = page->prev;
    }
 }
 
 /**
- * Atomically decrement the object counter on the given page and release the
- * page if necessary. The given address must be the *base address* of the page.
- *
- * You shouldn't have to use this method. Use `m32_free` instead.
+ * Unmap a page (or the pages of a large object) and forget about it.
+ * The allocator must be locked.
  */
 static void
-m32_free_internal(void * addr) {
-   uintptr_t c = __sync_sub_and_fetch((uintptr_t*)addr, 1);
-   if (c == 0) {
-      munmapForLinker(addr, getPageSize());
-   }
+m32_release_page(struct m32_page_t *page, size_t size)
+{
+   removeHashTable(alloc.pages, (StgWord)page->base_addr, page);
+   munmapForLinker(page->base_addr, roundUpToPage(size));
+   alloc.mapped[page->pool] -= roundUpToPage(size);
+   stgFree(page);
 }
 
 /**
- * Release the allocator's reference to pages on the "filling" list. This
- * should be called when it is believed that no more allocations will be needed
- * from the allocator to ensure that empty pages waiting to be filled aren't
- * unnecessarily held.
+ * Release the empty pages the allocator keeps as spares. This should be
+ * called when it is believed that no more allocations will be needed for a
+ * while.
  *
  * This is the real implementation. There is another dummy implementation below.
  * See the note titled "Compile Time Trickery" at the top of this file.
  */
 void
 m32_allocator_flush(void) {
-   int i;
-   for (i=0; i<M32_MAX_PAGES; i++) {
-      void * addr =  __sync_fetch_and_and(&alloc.pages[i].base_addr, 0x0);
-      if (addr != 0) {
-         m32_free_internal(addr);
+   uint32_t p, i;
+   ACQUIRE_LOCK(&alloc.lock);
+   for (p = 0; p < M32_N_POOLS; p++) {
+      for (i = 0; i < alloc.n_classes; i++) {
+         if (alloc.classes[p][i].spare != NULL) {
+            m32_release_page(alloc.classes[p][i].spare, getPageSize());
+            alloc.classes[p][i].spare = NULL;
+         }
       }
    }
+   RELEASE_LOCK(&alloc.lock);
 }
 
-// Return true if the object has its own dedicated set of pages
-#define m32_is_large_object(size,alignment) \
-   (size >= getPageSize() - ROUND_UP(M32_REFCOUNT_BYTES,alignment))
-
-// Return true if the object has its own dedicated set of pages
-#define m32_is_large_object_addr(addr) \
-   ((uintptr_t) addr % getPageSize() == 0)
-
 /**
  * Free the memory associated with an object.
  *
- * If the object is "small", the object counter of the page it is allocated in
- * is decremented and the page is not freed until all of its objects are freed.
+ * A small object's slot goes back to its page, which is unmapped if it is
+ * now empty (unless it becomes a spare).  A large object is unmapped.
  *
  * This is the real implementation. There is another dummy implementation below.
  * See the note titled "Compile Time Trickery" at the top of this file.
@@ -219,92 +289,164 @@ m32_allocator_flush(void) {
 void
 m32_free(void *addr, size_t size)
 {
-   uintptr_t m = (uintptr_t) addr % getPageSize();
+   struct m32_page_t *page;
+   struct m32_class_t *c;
+   uintptr_t base = ROUND_DOWN((uintptr_t)addr, getPageSize());
 
-   if (m == 0) {
-      // large object
-      munmapForLinker(addr,roundUpToPage(size));
+   ACQUIRE_LOCK(&alloc.lock);
+
+   page = lookupHashTable(alloc.pages, base);
+   if (page == NULL) {
+      barf("m32_free: %p was not allocated by m32_alloc", addr);
    }
-   else {
-      // small object
-      void * page_addr = (void*)((uintptr_t)addr - m);
-      m32_free_internal(page_addr);
+   alloc.allocated -= size;
+
+   if (page->size_class == M32_LARGE) {
+      m32_release_page(page, size);
+      RELEASE_LOCK(&alloc.lock);
+      return;
+   }
+
+   c = &alloc.classes[page->pool][page->size_class];
+   if (page->free == NULL && page->n_fresh == 0) {
+      // it was full, and now has a free slot
+      m32_push_page(c, page);
+   }
+   *(void**)addr = page->free;
+   page->free = addr;
+   page->n_used--;
+
+   if (page->n_used == 0) {
+      m32_unlink_page(c, page);
+      if (c->spare == NULL) {
+         page->free = NULL;
+         page->n_fresh = m32_slots(page->size_class);
+         c->spare = page;
+      } else {
+         m32_release_page(page, getPageSize());
+      }
+   }
+
+   RELEASE_LOCK(&alloc.lock);
+}
+
+/**
+ * Allocate a new page (or the pages of a large object) for the given pool
+ * and size class.  The allocator must be locked.
+ */
+static struct m32_page_t *
+m32_new_page(M32Pool pool, uint8_t size_class, size_t size)
+{
+   struct m32_page_t *page;
+   void *addr = m32_map(pool, size);
+   if (addr == NULL) {
+      return NULL;
    }
+   page = stgMallocBytes(sizeof(struct m32_page_t), "m32_new_page");
+   page->next       = NULL;
+   page->prev       = NULL;
+   page->base_addr  = addr;
+   page->free       = NULL;
+   page->n_used     = 0;
+   page->n_fresh    = size_class == M32_LARGE ? 0 : m32_slots(size_class);
+   page->pool       = pool;
+   page->size_class = size_class;
+   insertHashTable(alloc.pages, (StgWord)addr, page);
+   return page;
 }
 
 /**
- * Allocate `size` bytes of memory with the given alignment.
+ * Allocate `size` bytes of memory with the given alignment from the given
+ * pool.
  *
  * This is the real implementation. There is another dummy implementation below.
  * See the note titled "Compile Time Trickery" at the top of this file.
  */
 void *
-m32_alloc(size_t size, size_t alignment)
+m32_alloc(M32Pool pool, size_t size, size_t alignment)
 {
-   size_t pgsz = getPageSize();
+   struct m32_page_t *page;
+   struct m32_class_t *c;
+   void *addr;
+   uint32_t size_class = 0;
+
+   while (size_class < alloc.n_classes
+          && ((size_t)M32_MIN_SIZE << size_class) < size) {
+      size_class++;
+   }
+   while (size_class < alloc.n_classes
+          && ((size_t)M32_MIN_SIZE << size_class) < alignment) {
+      size_class++;
+   }
+
+   ACQUIRE_LOCK(&alloc.lock);
 
-   if (m32_is_large_object(size,alignment)) {
-       // large object
-       return mmapForLinker(size,MAP_ANONYMOUS,-1,0);
+   if (size_class == alloc.n_classes) {
+      // large object
+      page = m32_new_page(pool, M32_LARGE, size);
+      if (page == NULL) {
+         RELEASE_LOCK(&alloc.lock);
+         return NULL;
+      }
+      page->n_used = 1;
+      alloc.allocated += size;
+      RELEASE_LOCK(&alloc.lock);
+      return page->base_addr;
    }
 
    // small object
-   // Try to find a page that can contain it
-   int empty = -1;
-   int most_filled = -1;
-   int i;
-   for (i=0; i<M32_MAX_PAGES; i++) {
-      // empty page
-      if (alloc.pages[i].base_addr == 0) {
-         empty = empty == -1 ? i : empty;
-         continue;
-      }
-      // If the page is referenced only by the allocator, we can reuse it.
-      // If we don't then we'll be left with a bunch of pages that have a
-      // few bytes left to allocate and we don't get to use or free them
-      // until we use up all the "filling" pages. This will unnecessarily
-      // allocate new pages and fragment the address space.
-      if (*((uintptr_t*)(alloc.pages[i].base_addr)) == 1) {
-         alloc.pages[i].current_size = M32_REFCOUNT_BYTES;
-      }
-      // page can contain the buffer?
-      size_t alsize = ROUND_UP(alloc.pages[i].current_size, alignment);
-      if (size <= pgsz - alsize) {
-         void * addr = (char*)alloc.pages[i].base_addr + alsize;
-         alloc.pages[i].current_size = alsize + size;
-         // increment the counter atomically
-         __sync_fetch_and_add((uintptr_t*)alloc.pages[i].base_addr, 1);
-         return addr;
-      }
-      // most filled?
-      if (most_filled == -1
-       || alloc.pages[most_filled].current_size < alloc.pages[i].current_size)
-      {
-         most_filled = i;
+   c = &alloc.classes[pool][size_class];
+   page = c->pages;
+   if (page == NULL) {
+      if (c->spare != NULL) {
+         page = c->spare;
+         c->spare = NULL;
+      } else {
+         page = m32_new_page(pool, size_class, getPageSize());
+         if (page == NULL) {
+            RELEASE_LOCK(&alloc.lock);
+            return NULL;
+         }
       }
+      m32_push_page(c, page);
    }
 
-   // If we haven't found an empty page, flush the most filled one
-   if (empty == -1) {
-      m32_free_internal(alloc.pages[most_filled].base_addr);
-      alloc.pages[most_filled].base_addr    = 0;
-      alloc.pages[most_filled].current_size = 0;
-      empty = most_filled;
+   if (page->free != NULL) {
+      addr = page->free;
+      page->free = *(void**)addr;
+   } else {
+      addr = page->base_addr
+           + ((size_t)(m32_slots(size_class) - page->n_fresh)
+              << (size_class + M32_MIN_SIZE_LOG2));
+      page->n_fresh--;
    }
+   page->n_used++;
 
-   // Allocate a new page
-   void * addr = mmapForLinker(pgsz,MAP_ANONYMOUS,-1,0);
-   if (addr == NULL) {
-      return NULL;
+   if (page->free == NULL && page->n_fresh == 0) {
+      // full
+      m32_unlink_page(c, page);
    }
-   alloc.pages[empty].base_addr    = addr;
-   // Add M32_REFCOUNT_BYTES bytes for the counter + padding
-   alloc.pages[empty].current_size =
-       size+ROUND_UP(M32_REFCOUNT_BYTES,alignment);
-   // Initialize the counter:
-   // 1 for the allocator + 1 for the returned allocated memory
-   *((uintptr_t*)addr)            = 2;
-   return (char*)addr + ROUND_UP(M32_REFCOUNT_BYTES,alignment);
+
+   alloc.allocated += size;
+   RELEASE_LOCK(&alloc.lock);
+   return addr;
+}
+
+/**
+ * Add the allocator's statistics to `stats`.
+ *
+ * This is the real implementation. There is another dummy implementation below.
+ * See the note titled "Compile Time Trickery" at the top of this file.
+ */
+void
+m32_get_stats(LinkerMemStats *stats)
+{
+   ACQUIRE_LOCK(&alloc.lock);
+   stats->code_bytes      += alloc.mapped[M32_CODE];
+   stats->rodata_bytes    += alloc.mapped[M32_RODATA];
+   stats->rwdata_bytes    += alloc.mapped[M32_RWDATA];
+   stats->allocated_bytes += alloc.allocated;
+   RELEASE_LOCK(&alloc.lock);
 }
 
 #elif RTS_LINKER_USE_MMAP == 0
@@ -332,12 +474,19 @@ m32_free(void *addr STG_UNUSED, size_t size STG_UNUSED)
 }
 
 void *
-m32_alloc(size_t size STG_UNUSED, size_t alignment STG_UNUSED)
+m32_alloc(M32Pool pool STG_UNUSED, size_t size STG_UNUSED,
+          size_t alignment STG_UNUSED)
 {
     barf("%s: RTS_LINKER_USE_MMAP is %d", __func__, RTS_LINKER_USE_MMAP);
     return NULL;
 }
 
+void
+m32_get_stats(LinkerMemStats *stats STG_UNUSED)
+{
+    barf("%s: RTS_LINKER_USE_MMAP is %d", __func__, RTS_LINKER_USE_MMAP);
+}
+
 #else
 
 #error RTS_LINKER_USE_MMAP should be either `0` or `1`.
@@ -32,13 +32,24 @@
 #define M32_NO_RETURN    GNUC3_ATTRIBUTE(__noreturn__)
 #endif
 
+/* Code, read-only data and writable data are allocated from separate
+   pools of pages; see Note [M32 Allocator] */
+typedef enum {
+    M32_CODE,
+    M32_RODATA,
+    M32_RWDATA,
+    M32_N_POOLS
+} M32Pool;
+
 void m32_allocator_init(void) M32_NO_RETURN;
 
 void m32_allocator_flush(void) M32_NO_RETURN;
 
 void m32_free(void *addr, size_t size) M32_NO_RETURN;
 
-void * m32_alloc(size_t size, size_t alignment) M32_NO_RETURN;
+void * m32_alloc(M32Pool pool, size_t size, size_t alignment) M32_NO_RETURN;
+
+void m32_get_stats(LinkerMemStats *stats) M32_NO_RETURN;
 
 void * mmapForLinker (size_t bytes, uint32_t flags, int fd, int offset);
 
@@ -34,12 +34,19 @@
 #include <errno.h>
 #include <string.h>
 
+#if defined(USE_EPOLL)
+#  include <sys/epoll.h>
+#  include <fcntl.h>
+#  include <time.h>
+#  include <unistd.h>
+#endif
+
 #include "Clock.h"
 
 #if !defined(THREADED_RTS)
 
 // The target time for a threadDelay is stored in a one-word quantity
-// in the TSO (tso->block_info.target).  On a 32-bit machine we
+// (Sleeper.target below).  On a 32-bit machine we
 // therefore can't afford to use nanosecond resolution because it
 // would overflow too quickly, so instead we use millisecond
 // resolution.
@@ -82,6 +89,31 @@ LowResTime getDelayTarget (HsInt us)
     }
 }
 
+/* -----------------------------------------------------------------------------
+ * Note [Sleeping threads]
+ * ~~~~~~~~~~~~~~~~~~~~~~~
+ * Threads blocked in threadDelay# are kept in a binary min-heap,
+ * ordered by their target time, rather than in a sorted list: with
+ * many sleeping threads (e.g. one timeout per connection) the O(n)
+ * list insertion dominated the scheduler.  Now inserting a thread,
+ * and removing it again when it is woken or gets an exception, are
+ * O(log n), and the next thread to wake up is at sleepers[0].
+ *
+ * Each sleeping thread records its position in the heap in
+ * tso->block_info.sleep_index, so that removeSleepingThread() can
+ * find it.  The heap lives outside the Haskell heap, so its TSOs are
+ * GC roots (markSleepingThreads()).
+ * -------------------------------------------------------------------------- */
+
+typedef struct {
+    LowResTime target;
+    StgTSO    *tso;
+} Sleeper;
+
+static Sleeper  *sleepers = NULL;
+static uint32_t  n_sleepers = 0;
+static uint32_t  sleepers_size = 0;
+
 /* There's a clever trick here to avoid problems when the time wraps
  * around.  Since our maximum delay is smaller than 31 bits of ticks
  * (it's actually 31 bits of microseconds), we can safely check
@@ -93,17 +125,119 @@ LowResTime getDelayTarget (HsInt us)
  * if this is true, then our time has expired.
  * (idea due to Andy Gill).
  */
+#define TIME_BEFORE(t1,t2) (((long)(t1) - (long)(t2)) < 0)
+
+static void
+setSleeper (uint32_t i, Sleeper s)
+{
+    sleepers[i] = s;
+    s.tso->block_info.sleep_index = i;
+}
+
+static void
+siftUp (uint32_t i)
+{
+    Sleeper s = sleepers[i];
+    uint32_t parent;
+
+    while (i > 0) {
+        parent = (i - 1) / 2;
+        if (!TIME_BEFORE(s.target, sleepers[parent].target)) break;
+        setSleeper(i, sleepers[parent]);
+        i = parent;
+    }
+    setSleeper(i, s);
+}
+
+static void
+siftDown (uint32_t i)
+{
+    Sleeper s = sleepers[i];
+    uint32_t child;
+
+    for (;;) {
+        child = 2 * i + 1;
+        if (child >= n_sleepers) break;
+        if (child + 1 < n_sleepers &&
+            TIME_BEFORE(sleepers[child+1].target, sleepers[child].target)) {
+            child++;
+        }
+        if (!TIME_BEFORE(sleepers[child].target, s.target)) break;
+        setSleeper(i, sleepers[child]);
+        i = child;
+    }
+    setSleeper(i, s);
+}
+
+// Called from stg_delayzh
+void
+insertSleepingThread (StgTSO *tso, LowResTime target)
+{
+    if (n_sleepers == sleepers_size) {
+        sleepers_size = stg_max(64, 2 * sleepers_size);
+        sleepers = stgReallocBytes(sleepers, sleepers_size * sizeof(Sleeper),
+                                   "insertSleepingThread");
+    }
+    sleepers[n_sleepers].target = target;
+    sleepers[n_sleepers].tso    = tso;
+    siftUp(n_sleepers++);
+}
+
+void
+removeSleepingThread (StgTSO *tso)
+{
+    uint32_t i = tso->block_info.sleep_index;
+
+    ASSERT(i < n_sleepers && sleepers[i].tso == tso);
+
+    n_sleepers--;
+    if (i < n_sleepers) {
+        setSleeper(i, sleepers[n_sleepers]);
+        if (i > 0 &&
+            TIME_BEFORE(sleepers[i].target, sleepers[(i-1)/2].target)) {
+            siftUp(i);
+        } else {
+            siftDown(i);
+        }
+    }
+}
+
+rtsBool
+anySleepingThreads (void)
+{
+    return n_sleepers != 0;
+}
+
+void
+markSleepingThreads (evac_fn evac, void *user)
+{
+    uint32_t i;
+
+    for (i = 0; i < n_sleepers; i++) {
+        evac(user, (StgClosure **)(void *)&sleepers[i].tso);
+    }
+}
+
+void
+freeSleepingThreads (void)
+{
+    stgFree(sleepers);
+    sleepers = NULL;
+    n_sleepers = 0;
+    sleepers_size = 0;
+}
+
 static rtsBool wakeUpSleepingThreads (LowResTime now)
 {
     StgTSO *tso;
     rtsBool flag = rtsFalse;
 
-    while (sleeping_queue != END_TSO_QUEUE) {
-        tso = sleeping_queue;
-        if (((long)now - (long)tso->block_info.target) < 0) {
+    while (n_sleepers != 0) {
+        if (TIME_BEFORE(now, sleepers[0].target)) {
             break;
         }
-        sleeping_queue = tso->_link;
+        tso = sleepers[0].tso;
+        removeSleepingThread(tso);
         tso->why_blocked = NotBlocked;
         tso->_link = END_TSO_QUEUE;
         IF_DEBUG(scheduler, debugBelch("Waking up sleeping thread %lu\n",
@@ -115,6 +249,483 @@ static rtsBool wakeUpSleepingThreads (LowResTime now)
     return flag;
 }
 
+#if defined(USE_EPOLL)
+
+/* -----------------------------------------------------------------------------
+ * Note [Waiting for I/O]
+ * ~~~~~~~~~~~~~~~~~~~~~~
+ * waitRead# and waitWrite# append the thread to blocked_queue (see
+ * PrimOps.cmm).  Rebuilding an fd_set from the whole of blocked_queue
+ * on every call to awaitEvent() costs O(blocked threads), and select()
+ * can't handle fds >= FD_SETSIZE, so where we have epoll we use it
+ * instead:
+ *
+ *   - awaitEvent() moves each thread on blocked_queue into io_waiters,
+ *     a table of the threads blocked on each fd, and registers the fd
+ *     with the epoll set.  So blocked_queue only holds the threads that
+ *     blocked since the last call.
+ *
+ *   - An fd stays registered, for reading and/or writing, for as long
+ *     as any thread is waiting for it, so the epoll set is updated only
+ *     when threads block and wake up.  epoll_wait() tells us which fds
+ *     are ready, and we only look at the threads waiting on those.
+ *
+ *   - The threads in io_waiters are GC roots (markIOWaiters()), and an
+ *     exception removes a thread from there or from blocked_queue (see
+ *     removeFromQueues()).
+ *
+ *   - epoll_ctl() refuses regular files, which select() always reports
+ *     as ready, so we wake those threads straight away.  epoll silently
+ *     forgets fds that are closed while a thread is waiting on them, so
+ *     when we time out we check that the fds we are waiting on are
+ *     still open, and raise blockedOnBadFD in the threads waiting on
+ *     those that aren't, as we do with select().  To make sure that
+ *     happens we don't wait for longer than MAX_EPOLL_WAIT at a time.
+ *
+ *   - If such an fd is reopened before we notice, the number is the
+ *     same but the kernel no longer has it in the epoll set, so every
+ *     thread that starts waiting on an fd re-registers it, even when
+ *     the events we want are unchanged.
+ * -------------------------------------------------------------------------- */
+
+typedef struct {
+    StgTSO   **tsos;     // threads waiting on this fd, in order of arrival
+    uint32_t   n_tsos;
+    uint32_t   size;     // of tsos[]
+    uint32_t   events;   // registered with the epoll set (0 if none)
+} IOWaiters;
+
+static IOWaiters *io_waiters = NULL;  // indexed by fd
+static uint32_t   io_waiters_size = 0;
+static uint32_t   n_io_waiters = 0;   // total number of threads in io_waiters
+static int        epoll_fd = -1;
+
+// The most events we handle in one go; any others will be reported by
+// the next call to epoll_wait().
+#define MAX_EPOLL_EVENTS 256
+
+// Longest time (in milliseconds) we block in epoll_wait(), see Note
+// [Waiting for I/O].
+#define MAX_EPOLL_WAIT 1000
+
+rtsBool
+anyIOWaiters (void)
+{
+    return n_io_waiters != 0;
+}
+
+static uint32_t
+tsoEvents (StgTSO *tso)
+{
+    return tso->why_blocked == BlockedOnRead ? EPOLLIN : EPOLLOUT;
+}
+
+static void
+addIOWaiter (int fd, StgTSO *tso)
+{
+    IOWaiters *w;
+    uint32_t n;
+
+    if ((uint32_t)fd >= io_waiters_size) {
+        n = stg_max((uint32_t)fd + 1, 2 * io_waiters_size);
+        io_waiters = stgReallocBytes(io_waiters, n * sizeof(IOWaiters),
+                                     "addIOWaiter");
+        memset(&io_waiters[io_waiters_size], 0,
+               (n - io_waiters_size) * sizeof(IOWaiters));
+        io_waiters_size = n;
+    }
+
+    w = &io_waiters[fd];
+    if (w->n_tsos == w->size) {
+        w->size = stg_max(4, 2 * w->size);
+        w->tsos = stgReallocBytes(w->tsos, w->size * sizeof(StgTSO *),
+                                  "addIOWaiter");
+    }
+    w->tsos[w->n_tsos++] = tso;
+    n_io_waiters++;
+}
+
+// Tell the kernel which events we want for fd now.  Returns 0, or the
+// errno from epoll_ctl().
+//
+// When a thread has just started waiting on fd we always call
+// epoll_ctl(), even if the events haven't changed: fd may have been
+// closed and reopened since it was registered, in which case the
+// kernel has dropped it from the epoll set without telling us.
+static int
+updateIOInterest (int fd, rtsBool new_waiter)
+{
+    IOWaiters *w = &io_waiters[fd];
+    struct epoll_event ev;
+    uint32_t i, events;
+    int r, op;
+
+    events = 0;
+    for (i = 0; i < w->n_tsos; i++) {
+        events |= tsoEvents(w->tsos[i]);
+    }
+    if (events == w->events && !(new_waiter && events != 0)) return 0;
+
+    if (epoll_fd < 0) {
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd < 0) {
+            sysErrorBelch("epoll_create1");
+            stg_exit(EXIT_FAILURE);
+        }
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events  = events;
+    ev.data.fd = fd;
+
+    if (events == 0) {
+        op = EPOLL_CTL_DEL;
+    } else if (w->events == 0) {
+        op = EPOLL_CTL_ADD;
+    } else {
+        op = EPOLL_CTL_MOD;
+    }
+
+    r = epoll_ctl(epoll_fd, op, fd, &ev);
+    if (r != 0 && op == EPOLL_CTL_MOD && errno == ENOENT) {
+        // the fd was closed and the number reused behind our back
+        r = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+    } else if (r != 0 && op == EPOLL_CTL_ADD && errno == EEXIST) {
+        r = epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+    }
+    if (r != 0 && op != EPOLL_CTL_DEL) {
+        w->events = 0;
+        return errno;
+    }
+
+    // Failing to remove an fd doesn't matter: it has been closed.
+    w->events = events;
+    return 0;
+}
+
+rtsBool
+removeIOWaiter (StgTSO *tso)
+{
+    int fd = tso->block_info.fd;
+    IOWaiters *w;
+    uint32_t i;
+
+    if (fd < 0 || (uint32_t)fd >= io_waiters_size) return rtsFalse;
+
+    w = &io_waiters[fd];
+    for (i = 0; i < w->n_tsos; i++) {
+        if (w->tsos[i] == tso) break;
+    }
+    if (i == w->n_tsos) return rtsFalse;
+
+    for (; i + 1 < w->n_tsos; i++) {
+        w->tsos[i] = w->tsos[i+1];
+    }
+    w->n_tsos--;
+    n_io_waiters--;
+    updateIOInterest(fd, rtsFalse);
+    return rtsTrue;
+}
+
+static void
+wakeIOWaiter (StgTSO *tso)
+{
+    IF_DEBUG(scheduler,
+        debugBelch("Waking up blocked thread %lu\n",
+                   (unsigned long)tso->id));
+    tso->why_blocked = NotBlocked;
+    tso->_link = END_TSO_QUEUE;
+    pushOnRunQueue(&MainCapability,tso);
+}
+
+static void
+killIOWaiter (StgTSO *tso)
+{
+    /*
+     * Don't let RTS loop on such descriptors,
+     * pass an IOError to blocked threads (Trac #4934)
+     */
+    IF_DEBUG(scheduler,
+        debugBelch("Killing blocked thread %lu on bad fd=%i\n",
+                   (unsigned long)tso->id, (int)tso->block_info.fd));
+    raiseAsync(&MainCapability, tso,
+               (StgClosure *)blockedOnBadFD_closure, rtsFalse, NULL);
+}
+
+// Wake up (or kill, if the fd has gone bad) the threads waiting for
+// any of the given events on fd.
+static void
+wakeIOWaiters (int fd, uint32_t events, rtsBool bad_fd)
+{
+    IOWaiters *w = &io_waiters[fd];
+    StgTSO *tso;
+    uint32_t i, j;
+
+    for (i = 0, j = 0; i < w->n_tsos; i++) {
+        tso = w->tsos[i];
+        if (bad_fd || (tsoEvents(tso) & events)) {
+            n_io_waiters--;
+            if (bad_fd) {
+                killIOWaiter(tso);
+            } else {
+                wakeIOWaiter(tso);
+            }
+        } else {
+            w->tsos[j++] = tso;
+        }
+    }
+    w->n_tsos = j;
+
+    if (bad_fd) {
+        // the kernel has already forgotten about it
+        w->events = 0;
+    } else if (updateIOInterest(fd, rtsFalse) != 0) {
+        wakeIOWaiters(fd, 0, rtsTrue);
+    }
+}
+
+// Move the threads that have blocked since we last looked from
+// blocked_queue into io_waiters.
+static void
+registerIOWaiters (void)
+{
+    StgTSO *tso, *next;
+    int fd, r;
+
+    tso = blocked_queue_hd;
+    blocked_queue_hd = blocked_queue_tl = END_TSO_QUEUE;
+
+    for (; tso != END_TSO_QUEUE; tso = next) {
+        next = tso->_link;
+        tso->_link = END_TSO_QUEUE;
+
+        switch (tso->why_blocked) {
+        case BlockedOnRead:
+        case BlockedOnWrite:
+            break;
+        default:
+            barf("registerIOWaiters");
+        }
+
+        fd = tso->block_info.fd;
+        if (fd < 0) {
+            killIOWaiter(tso);
+            continue;
+        }
+
+        addIOWaiter(fd, tso);
+        r = updateIOInterest(fd, rtsTrue);
+        if (r == EPERM) {
+            // a regular file, which is always ready
+            wakeIOWaiters(fd, EPOLLIN | EPOLLOUT, rtsFalse);
+        } else if (r == EBADF) {
+            wakeIOWaiters(fd, 0, rtsTrue);
+        } else if (r != 0) {
+            errno = r;
+            sysErrorBelch("epoll_ctl");
+            stg_exit(EXIT_FAILURE);
+        }
+    }
+}
+
+// Kill the threads waiting on fds that have been closed, see Note
+// [Waiting for I/O].
+static void
+checkIOWaiters (void)
+{
+    uint32_t fd;
+
+    for (fd = 0; fd < io_waiters_size; fd++) {
+        if (io_waiters[fd].n_tsos != 0 &&
+            fcntl(fd, F_GETFD) == -1 && errno == EBADF) {
+            wakeIOWaiters(fd, 0, rtsTrue);
+        }
+    }
+}
+
+void
+markIOWaiters (evac_fn evac, void *user)
+{
+    uint32_t fd, i;
+
+    for (fd = 0; fd < io_waiters_size; fd++) {
+        for (i = 0; i < io_waiters[fd].n_tsos; i++) {
+            evac(user, (StgClosure **)(void *)&io_waiters[fd].tsos[i]);
+        }
+    }
+}
+
+void
+resetIOWaitersAfterFork (void)
+{
+    uint32_t fd;
+
+    // The epoll set is shared with the parent: we must not touch it.
+    if (epoll_fd >= 0) {
+        close(epoll_fd);
+        epoll_fd = -1;
+    }
+    for (fd = 0; fd < io_waiters_size; fd++) {
+        io_waiters[fd].events = 0;
+    }
+}
+
+void
+freeIOWaiters (void)
+{
+    uint32_t fd;
+
+    for (fd = 0; fd < io_waiters_size; fd++) {
+        stgFree(io_waiters[fd].tsos);
+    }
+    stgFree(io_waiters);
+    io_waiters = NULL;
+    io_waiters_size = 0;
+    n_io_waiters = 0;
+    if (epoll_fd >= 0) {
+        close(epoll_fd);
+        epoll_fd = -1;
+    }
+}
+
+/* Argument 'wait' says whether to wait for I/O to become available,
+ * or whether to just check and return immediately.  If there are
+ * other threads ready to run, we normally do the non-waiting variety,
+ * otherwise we wait (see Schedule.c).
+ *
+ * See Note [Waiting for I/O].
+ */
+void
+awaitEvent(rtsBool wait)
+{
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    int i, numFound, timeout;
+    LowResTime now;
+
+    IF_DEBUG(scheduler,
+             debugBelch("scheduler: checking for threads blocked on I/O");
+             if (wait) {
+                 debugBelch(" (waiting)");
+             }
+             debugBelch("\n");
+             );
+
+    /* loop until we've woken up some threads.  This loop is needed
+     * because the timeout isn't accurate, we sometimes sleep for a
+     * while but not long enough to wake up a thread in a threadDelay.
+     */
+    do {
+
+      now = getLowResTimeOfDay();
+      if (wakeUpSleepingThreads(now)) {
+          return;
+      }
+
+      registerIOWaiters();
+      if (!emptyRunQueue(&MainCapability)) {
+          // some fds were ready (or bad) straight away
+          wait = rtsFalse;
+      }
+
+      if (!wait) {
+          // just poll
+          timeout = 0;
+      } else if (n_sleepers != 0) {
+          Time min = LowResTimeToTime(sleepers[0].target - now);
+          // round up, we never want to wake up too early
+          timeout = (int)stg_min((TimeToUS(min) + 999) / 1000,
+                                 (Time)MAX_EPOLL_WAIT);
+      } else {
+          timeout = MAX_EPOLL_WAIT;
+      }
+
+      if (n_io_waiters == 0) {
+          // epoll_wait() needs an epoll set, so just sleep
+          struct timespec ts;
+          ts.tv_sec  = timeout / 1000;
+          ts.tv_nsec = (timeout % 1000) * 1000000;
+          numFound = timeout > 0 ? nanosleep(&ts, NULL) : 0;
+      } else {
+          numFound = epoll_wait(epoll_fd, events, MAX_EPOLL_EVENTS, timeout);
+      }
+
+      if (numFound < 0) {
+          if (errno != EINTR) {
+              sysErrorBelch("epoll_wait");
+              stg_exit(EXIT_FAILURE);
+          }
+
+          /* We got a signal; could be one of ours.  If so, we need
+           * to start up the signal handler straight away, otherwise
+           * we could block for a long time before the signal is
+           * serviced.
+           */
+#if defined(RTS_USER_SIGNALS)
+          if (RtsFlags.MiscFlags.install_signal_handlers && signals_pending()) {
+              startSignalHandlers(&MainCapability);
+              return; /* still hold the lock */
+          }
+#endif
+
+          /* we were interrupted, return to the scheduler immediately.
+           */
+          if (sched_state >= SCHED_INTERRUPTING) {
+              return; /* still hold the lock */
+          }
+
+          continue;
+      }
+
+      if (numFound == 0 && timeout > 0) {
+          checkIOWaiters();
+      }
+
+      /* Wake up the threads waiting on the fds that are now ready.
+       * Errors and hangups wake up everyone, like select() does.
+       */
+      for (i = 0; i < numFound; i++) {
+          uint32_t ev = events[i].events;
+          if (ev & (EPOLLERR | EPOLLHUP)) {
+              ev |= EPOLLIN | EPOLLOUT;
+          }
+          wakeIOWaiters(events[i].data.fd, ev, rtsFalse);
+      }
+
+    } while (wait && sched_state == SCHED_RUNNING
+             && emptyRunQueue(&MainCapability));
+}
+
+#else /* !USE_EPOLL */
+
+// With select() every thread blocked on I/O stays on blocked_queue.
+
+rtsBool
+anyIOWaiters (void)
+{
+    return rtsFalse;
+}
+
+rtsBool
+removeIOWaiter (StgTSO *tso STG_UNUSED)
+{
+    return rtsFalse;
+}
+
+void
+markIOWaiters (evac_fn evac STG_UNUSED, void *user STG_UNUSED)
+{
+}
+
+void
+resetIOWaitersAfterFork (void)
+{
+}
+
+void
+freeIOWaiters (void)
+{
+}
+
 static void GNUC3_ATTRIBUTE(__noreturn__)
 fdOutOfRange (int fd)
 {
@@ -293,7 +904,7 @@ awaitEvent(rtsBool wait)
           tv.tv_sec  = 0;
           tv.tv_usec = 0;
           ptv = &tv;
-      } else if (sleeping_queue != END_TSO_QUEUE) {
+      } else if (n_sleepers != 0) {
           /* SUSv2 allows implementations to have an implementation defined
            * maximum timeout for select(2). The standard requires
            * implementations to silently truncate values exceeding this maximum
@@ -312,7 +923,7 @@ awaitEvent(rtsBool wait)
            */
           const time_t max_seconds = 2678400; // 31 * 24 * 60 * 60
 
-          Time min = LowResTimeToTime(sleeping_queue->block_info.target - now);
+          Time min = LowResTimeToTime(sleepers[0].target - now);
           tv.tv_sec  = TimeToSeconds(min);
           if (tv.tv_sec < max_seconds) {
               tv.tv_usec = TimeToUS(min) % 1000000;
@@ -450,4 +1061,6 @@ awaitEvent(rtsBool wait)
              && emptyRunQueue(&MainCapability));
 }
 
+#endif /* !USE_EPOLL */
+
 #endif /* THREADED_RTS */
@@ -14,4 +14,28 @@ typedef StgWord LowResTime;
 
 RTS_PRIVATE LowResTime getDelayTarget (HsInt us);
 
+#if !defined(THREADED_RTS)
+
+// Threads blocked in threadDelay, see Note [Sleeping threads] in Select.c
+RTS_PRIVATE void    insertSleepingThread (StgTSO *tso, LowResTime target);
+RTS_PRIVATE void    removeSleepingThread (StgTSO *tso);
+RTS_PRIVATE rtsBool anySleepingThreads   (void);
+RTS_PRIVATE void    markSleepingThreads  (evac_fn evac, void *user);
+RTS_PRIVATE void    freeSleepingThreads  (void);
+
+// Use epoll rather than select() to wait for I/O, see Note [Waiting
+// for I/O] in Select.c
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_EPOLL_CREATE1)
+#define USE_EPOLL 1
+#endif
+
+// Threads blocked on I/O that awaitEvent() has taken off blocked_queue
+RTS_PRIVATE rtsBool anyIOWaiters           (void);
+RTS_PRIVATE rtsBool removeIOWaiter         (StgTSO *tso);
+RTS_PRIVATE void    markIOWaiters          (evac_fn evac, void *user);
+RTS_PRIVATE void    resetIOWaitersAfterFork (void);
+RTS_PRIVATE void    freeIOWaiters          (void);
+
+#endif /* !THREADED_RTS */
+
 #endif /* POSIX_SELECT_H */
@@ -80,6 +80,19 @@
 #define TFD_CLOEXEC 0
 #endif
 
+// idleTicker() needs membarrier(), see Note [Tickless idle] in Timer.c
+#if USE_TIMERFD_FOR_ITIMER && HAVE_LINUX_MEMBARRIER_H
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#endif
+#if USE_TIMERFD_FOR_ITIMER && HAVE_LINUX_MEMBARRIER_H && defined(SYS_membarrier)
+#define USE_MEMBARRIER 1
+#define USED_IF_MEMBARRIER
+#else
+#define USE_MEMBARRIER 0
+#define USED_IF_MEMBARRIER STG_UNUSED
+#endif
+
 static Time itimer_interval = DEFAULT_TICK_INTERVAL;
 
 // Should we be firing ticks?
@@ -95,18 +108,37 @@ static Condition start_cond;
 static Mutex mutex;
 static OSThreadId thread;
 
+static int timerfd = -1;
+
+#if USE_MEMBARRIER
+// Does the kernel support membarrier(MEMBARRIER_CMD_SHARED)?
+static HsBool have_membarrier = 0;
+#endif
+
+#if USE_TIMERFD_FOR_ITIMER
+// Arm the timer to expire after 'first', and every itimer_interval
+// after that.
+static void setTimerfd (Time first)
+{
+    struct itimerspec it;
+    it.it_value.tv_sec  = TimeToSeconds(first);
+    it.it_value.tv_nsec = TimeToNS(first) % 1000000000;
+    it.it_interval.tv_sec  = TimeToSeconds(itimer_interval);
+    it.it_interval.tv_nsec = TimeToNS(itimer_interval) % 1000000000;
+
+    if (timerfd_settime(timerfd, 0, &it, NULL)) {
+        sysErrorBelch("timerfd_settime");
+        stg_exit(EXIT_FAILURE);
+    }
+}
+#endif
+
 static void *itimer_thread_func(void *_handle_tick)
 {
     TickProc handle_tick = _handle_tick;
     uint64_t nticks;
-    int timerfd = -1;
 
 #if USE_TIMERFD_FOR_ITIMER
-    struct itimerspec it;
-    it.it_value.tv_sec  = TimeToSeconds(itimer_interval);
-    it.it_value.tv_nsec = TimeToNS(itimer_interval) % 1000000000;
-    it.it_interval = it.it_value;
-
     timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
     if (timerfd == -1) {
         sysErrorBelch("timerfd_create");
@@ -115,10 +147,7 @@ static void *itimer_thread_func(void *_handle_tick)
     if (!TFD_CLOEXEC) {
       fcntl(timerfd, F_SETFD, FD_CLOEXEC);
     }
-    if (timerfd_settime(timerfd, 0, &it, NULL)) {
-        sysErrorBelch("timerfd_settime");
-        stg_exit(EXIT_FAILURE);
-    }
+    setTimerfd(itimer_interval);
 #endif
 
     while (!exited) {
@@ -147,10 +176,16 @@ static void *itimer_thread_func(void *_handle_tick)
         }
     }
 
-    if (USE_TIMERFD_FOR_ITIMER)
-        close(timerfd);
-    closeMutex(&mutex);
-    closeCondition(&start_cond);
+    if (USE_TIMERFD_FOR_ITIMER) {
+        // under the mutex, so that wakeTicker() can't use it any more
+        ACQUIRE_LOCK(&mutex);
+        int fd = timerfd;
+        timerfd = -1;
+        close(fd);
+        RELEASE_LOCK(&mutex);
+    }
+    // exitTicker() frees the mutex and start_cond: wakeTicker() may
+    // still be using them.
     return NULL;
 }
 
@@ -164,6 +199,13 @@ initTicker (Time interval, TickProc handle_tick)
     initCondition(&start_cond);
     initMutex(&mutex);
 
+#if USE_MEMBARRIER
+    {
+        long cmds = syscall(SYS_membarrier, MEMBARRIER_CMD_QUERY, 0);
+        have_membarrier = cmds > 0 && (cmds & MEMBARRIER_CMD_SHARED);
+    }
+#endif
+
     /*
      * We can't use the RTS's createOSThread here as we need to remain attached
      * to the thread we create so we can later join to it if requested
@@ -210,11 +252,56 @@ exitTicker (rtsBool wait)
         if (pthread_join(thread, NULL)) {
             sysErrorBelch("Itimer: Failed to join");
         }
+        closeMutex(&mutex);
+        closeCondition(&start_cond);
     } else {
+        // The ticker thread, and wakeTicker() in other threads, may
+        // still use the mutex, so we never free it.
         pthread_detach(thread);
     }
 }
 
+/* Skip the next 'ticks' ticks, then make every running thread execute a
+ * memory barrier.  Only called by handle_tick(), in the ticker thread.
+ * With usleep() we can't be woken up early, and without membarrier()
+ * the scheduler would need the barrier instead, so we just keep
+ * ticking.
+ */
+rtsBool
+idleTicker (uint32_t ticks USED_IF_MEMBARRIER)
+{
+#if USE_MEMBARRIER
+    if (!have_membarrier) {
+        return rtsFalse;
+    }
+    setTimerfd(itimer_interval * ((Time)ticks + 1));
+    if (syscall(SYS_membarrier, MEMBARRIER_CMD_SHARED, 0) != 0) {
+        // can't happen after MEMBARRIER_CMD_QUERY said we have it, but
+        // if it does, we must tick again
+        have_membarrier = 0;
+        setTimerfd(itimer_interval);
+        return rtsFalse;
+    }
+    return rtsTrue;
+#else
+    return rtsFalse;
+#endif
+}
+
+/* Resume ticking every itimer_interval, from any thread */
+void
+wakeTicker (void)
+{
+#if USE_TIMERFD_FOR_ITIMER
+    if (exited) return;
+    ACQUIRE_LOCK(&mutex);
+    if (!exited && timerfd != -1) {
+        setTimerfd(itimer_interval);
+    }
+    RELEASE_LOCK(&mutex);
+#endif
+}
+
 int
 rtsTimerSignal(void)
 {
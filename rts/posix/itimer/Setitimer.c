@@ -78,6 +78,17 @@ exitTicker (rtsBool wait STG_UNUSED)
     return;
 }
 
+rtsBool
+idleTicker (uint32_t ticks STG_UNUSED)
+{
+    return rtsFalse;
+}
+
+void
+wakeTicker (void)
+{
+}
+
 int
 rtsTimerSignal(void)
 {
@@ -85,6 +85,17 @@ exitTicker (rtsBool wait STG_UNUSED)
     // ignore errors - we don't really care if it fails.
 }
 
+rtsBool
+idleTicker (uint32_t ticks STG_UNUSED)
+{
+    return rtsFalse;
+}
+
+void
+wakeTicker (void)
+{
+}
+
 int
 rtsTimerSignal(void)
 {
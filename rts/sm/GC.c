@@ -48,6 +48,7 @@
 #include "Stable.h"
 #include "CheckUnload.h"
 #include "CNF.h"
+#include "BlackHoles.h"
 
 #include <string.h> // for memset()
 #include <unistd.h>
@@ -316,6 +317,9 @@ GarbageCollect (uint32_t collect_gen,
   // Prepare this gc_thread
   init_gc_thread(gct);
 
+  // Must be before wakeup_gc_threads(), see checkUnloadWorker()
+  prepareUnloadCheck(major_gc);
+
   /* Allocate a mark stack if we're doing a major collection.
    */
   if (major_gc && oldest_gen->mark) {
@@ -394,6 +398,7 @@ GarbageCollect (uint32_t collect_gen,
 
   // Mark the stable pointer table.
   markStableTables(mark_root, gct);
+  rememberOldStableNameAddresses();
 
   /* -------------------------------------------------------------------------
    * Repeatedly scavenge all the areas we know about until there's no
@@ -416,11 +421,17 @@ GarbageCollect (uint32_t collect_gen,
       break;
   }
 
-  shutdown_gc_threads(gct->thread_index);
-
-  // Now see which stable names are still alive.
+  // Now see which stable names are still alive.  The other GC threads
+  // help with this (see gcWorkerThread()), so it must come before
+  // shutdown_gc_threads().
   gcStableTables();
 
+  // Likewise, look for references to object code that is waiting to be
+  // unloaded; the objects are freed later, by checkUnload().
+  markUnloadReferences(gct);
+
+  shutdown_gc_threads(gct->thread_index);
+
 #ifdef THREADED_RTS
   if (n_gc_threads == 1) {
       for (n = 0; n < n_capabilities; n++) {
@@ -682,6 +693,9 @@ GarbageCollect (uint32_t collect_gen,
 
   resetNurseries();
 
+  // BLACKHOLEs have moved: see Note [Blackhole contention] in BlackHoles.c
+  resetBlackHoleOwners();
+
  // mark the garbage collected CAFs as dead
 #if defined(DEBUG)
   if (major_gc) { gcCAFs(); }
@@ -696,9 +710,7 @@ GarbageCollect (uint32_t collect_gen,
   stableUnlock();
 
   // Must be after stableUnlock(), because it might free stable ptrs.
-  if (major_gc) {
-      checkUnload (gct->scavenged_static_objects);
-  }
+  checkUnload();
 
 #ifdef PROFILING
   // resetStaticObjectForRetainerProfiling() must be called before
@@ -1074,6 +1086,13 @@ gcWorkerThread (Capability *cap)
     // only reachable via weak pointers.  To fix this problem would
     // require another GC barrier, which is too high a price.
     pruneSparkQueue(cap);
+
+    // Help the main GC thread to find the dead stable names, once it
+    // has finished with the weak pointers.
+    gcStableTablesWorker();
+
+    // ... and to search for references to unloaded object code.
+    checkUnloadWorker(gct);
 #endif
 
     // Wait until we're told to continue
@@ -24,6 +24,8 @@
 #include "Weak.h"
 #include "Storage.h"
 #include "Threads.h"
+#include "STM.h"
+#include "Stable.h"
 
 #include "sm/GCUtils.h"
 #include "sm/MarkWeak.h"
@@ -65,6 +67,13 @@
      are evacuated and placed on the resurrected_threads list so we
      can send them a signal later.
 
+   - weak_stage == WeakDeadThreads
+
+     Everything reachable has now been evacuated, so any thread still on
+     an old_threads list is garbage.  Some of them are evacuated onto
+     the free lists of their Capabilities, to be reused by
+     createThread() (see Note [Recycling dead threads] in Threads.c).
+
    - weak_stage == WeakDone
 
      No more evacuation is done.
@@ -74,7 +83,7 @@
 /* Which stage of processing various kinds of weak pointer are we at?
  * (see traverse_weak_ptr_list() below for discussion).
  */
-typedef enum { WeakPtrs, WeakThreads, WeakDone } WeakStage;
+typedef enum { WeakPtrs, WeakThreads, WeakDeadThreads, WeakDone } WeakStage;
 static WeakStage weak_stage;
 
 // List of weak pointers whose key is dead
@@ -87,6 +96,7 @@ static void    collectDeadWeakPtrs (generation *gen);
 static rtsBool tidyWeakList (generation *gen);
 static rtsBool resurrectUnreachableThreads (generation *gen);
 static void    tidyThreadList (generation *gen);
+static rtsBool recycleDeadThreads (generation *gen);
 
 void
 initWeakForGC(void)
@@ -177,12 +187,30 @@ traverseWeakPtrList(void)
               collectDeadWeakPtrs(&generations[g]);
           }
 
-          weak_stage = WeakDone;  // *now* we're done,
+          weak_stage = WeakDeadThreads;
       }
 
       return rtsTrue;         // but one more round of scavenging, please
   }
 
+  case WeakDeadThreads:
+  {
+      uint32_t g;
+
+      // The finalizers we evacuated in the WeakPtrs stage have now been
+      // scavenged, and they might have referred to dead threads, so
+      // only now do we know which threads are really garbage.
+      for (g = 0; g <= N; g++) {
+          if (recycleDeadThreads(&generations[g])) {
+              flag = rtsTrue;
+          }
+      }
+
+      weak_stage = WeakDone;  // *now* we're done,
+
+      return flag;            // scavenge the recycled threads, if any
+  }
+
   default:
       barf("traverse_weak_ptr_list");
       return rtsTrue;
@@ -232,6 +260,61 @@ static rtsBool resurrectUnreachableThreads (generation *gen)
     return flag;
 }
 
+// Move some of the dead threads on gen->old_threads onto the free lists
+// of their Capabilities.  See Note [Recycling dead threads] in Threads.c.
+static rtsBool recycleDeadThreads (generation *gen)
+{
+    StgTSO *t, *next;
+    StgStack *stack;
+    Capability *cap;
+    W_ stack_size;
+    rtsBool flag = rtsFalse;
+
+    // the size of the stack that createThread() gives a new thread
+    stack_size = round_to_mblocks(RtsFlags.GcFlags.initialStkSize
+                                  - sizeofW(StgTSO)) - sizeofW(StgStack);
+
+    for (t = gen->old_threads; t != END_TSO_QUEUE; t = next) {
+        next = t->global_link;
+        cap = t->cap;
+        stack = t->stackobj;
+
+        // A thread with a stable name can't be reused, or the stable
+        // name would be kept alive and handed out for the new thread.
+        if (cap->n_free_tsos >= MAX_FREE_TSOS ||
+            isAlive((StgClosure *)t) != NULL ||
+            (t->what_next != ThreadComplete &&
+             t->what_next != ThreadKilled) ||
+            stack->stack_size != stack_size ||
+            hasStableName((StgClosure *)t)) {
+            continue;
+        }
+
+        // Drop everything the thread refers to before we evacuate it,
+        // so that we don't keep any garbage alive.  Emptying the stack
+        // also drops any older stack chunks.
+        t->what_next = ThreadKilled;
+        t->why_blocked = NotBlocked;
+        t->block_info.closure = (StgClosure *)END_TSO_QUEUE;
+        t->blocked_exceptions = END_BLOCKED_EXCEPTIONS_QUEUE;
+        t->bq = (StgBlockingQueue *)END_TSO_QUEUE;
+        t->trec = NO_TREC;
+        t->bound = NULL;
+        stack->sp = stack->stack + stack->stack_size;
+
+        // The rest of old_threads is garbage, and the compacting GC
+        // threads global_link (thread_TSO()) even on the free list.
+        t->global_link = END_TSO_QUEUE;
+        t->_link = cap->free_tsos;
+        evacuate((StgClosure **)&t);
+        cap->free_tsos = t;
+        cap->n_free_tsos++;
+        flag = rtsTrue;
+    }
+
+    return flag;
+}
+
 static rtsBool tidyWeakList(generation *gen)
 {
     StgWeak *w, **last_w, *next_w;
@@ -838,14 +838,18 @@ void
 checkRunQueue(Capability *cap)
 {
     StgTSO *prev, *tso;
-    prev = END_TSO_QUEUE;
-    uint32_t n;
-    for (n = 0, tso = cap->run_queue_hd; tso != END_TSO_QUEUE;
-         prev = tso, tso = tso->_link, n++) {
-        ASSERT(prev == END_TSO_QUEUE || prev->_link == tso);
-        ASSERT(tso->block_info.prev == prev);
+    uint32_t n, p;
+    n = 0;
+    for (p = 0; p < N_THREAD_PRIORITIES; p++) {
+        prev = END_TSO_QUEUE;
+        for (tso = cap->run_queue_hd[p]; tso != END_TSO_QUEUE;
+             prev = tso, tso = tso->_link, n++) {
+            ASSERT(prev == END_TSO_QUEUE || prev->_link == tso);
+            ASSERT(tso->block_info.prev == prev);
+            ASSERT(tso->run_queue_priority == p);
+        }
+        ASSERT(cap->run_queue_tl[p] == prev);
     }
-    ASSERT(cap->run_queue_tl == prev);
     ASSERT(cap->n_run_queue == n);
 }
 
@@ -89,7 +89,7 @@ scavengeTSO (StgTSO *tso)
     // in the THREADED_RTS, block_info.closure must always point to a
     // valid closure, because we assume this in throwTo().  In the
     // non-threaded RTS it might be a FD (for
-    // BlockedOnRead/BlockedOnWrite) or a time value (BlockedOnDelay)
+    // BlockedOnRead/BlockedOnWrite) or a heap index (BlockedOnDelay)
     else {
         tso->block_info.closure = (StgClosure *)END_TSO_QUEUE;
     }
@@ -78,3 +78,14 @@ exitTicker (rtsBool wait)
         timer_queue = NULL;
     }
 }
+
+rtsBool
+idleTicker (uint32_t ticks STG_UNUSED)
+{
+    return rtsFalse;
+}
+
+void
+wakeTicker (void)
+{
+}
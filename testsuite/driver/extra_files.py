@@ -343,6 +343,7 @@ extra_src_files = {
   'linker_error2': ['linker_error.c'],
   'linker_error3': ['linker_error.c'],
   'linker_unload': ['LinkerUnload.hs', 'Test.hs'],
+  'linker_unload_parallel': ['LinkerUnload.hs', 'Test.hs', 'linker_unload.c'],
   'listCommand001': ['../Test3.hs'],
   'listcomps': ['ListComprehensions.hs'],
   'literals': ['LiteralsTest.hs'],
@@ -542,7 +543,9 @@ extra_src_files = {
   'tcfail186': ['Tcfail186_Help.hs'],
   'tcrun025': ['TcRun025_B.hs'],
   'tcrun038': ['TcRun038_B.hs'],
+  'testhashtable': ['../../../rts/Hash.h', '../../../rts/BeginPrivate.h', '../../../rts/EndPrivate.h'],
   'testwsdeque': ['../../../rts/WSDeque.h'],
+  'testwsdeque_half': ['../../../rts/WSDeque.h'],
   'thurston-modular-arith': ['Main.hs', 'TypeVal.hs'],
   'tough': ['../hpcrun.pl'],
   'tough2': ['../hpcrun.pl', 'subdir/'],
@@ -0,0 +1,18 @@
+import Control.Concurrent
+import Control.Monad
+
+-- Several threads demand the same expensive thunk at once, so that the
+-- RTS sees contention on its blackhole and starts blackholing thunks of
+-- that kind eagerly (see Note [Adaptive eager blackholing] in
+-- rts/BlackHoles.c).  The results must of course be unaffected.
+
+main :: IO ()
+main = do
+  totals <- forM [1..20] $ \n -> do
+    let shared = sum [1 .. n * 100000 :: Integer]
+    rs <- forM [1..4 :: Int] $ \_ -> do
+      r <- newEmptyMVar
+      _ <- forkIO $ putMVar r $! shared
+      return r
+    fmap sum (mapM takeMVar rs)
+  print (sum totals)
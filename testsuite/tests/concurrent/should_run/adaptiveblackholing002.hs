@@ -0,0 +1,57 @@
+import Control.Concurrent
+import Control.Exception
+import Control.Monad
+import Data.IORef
+import System.IO.Unsafe
+
+-- A second thread blocks on a thunk that was blackholed eagerly by
+-- -fadaptive-blackholing, while the thread evaluating it is still in a
+-- loop that never yields.  The eagerly blackholed thunk must be updated
+-- through stg_bh_upd_frame, which wakes up the blocked thread; see
+-- Note [Adaptive eager blackholing] in rts/BlackHoles.c.
+
+data Box = Box Int
+
+-- All the thunks below have the info table of this one
+{-# NOINLINE mkBox #-}
+mkBox :: IORef Bool -> Int -> Box
+mkBox started n = Box (work started n)
+
+work :: IORef Bool -> Int -> Int
+work started n
+  | n < 0     = fromIntegral (sum [1 .. toInteger (negate n)])
+  | otherwise = unsafeDupablePerformIO (writeIORef started True)
+                `seq` spin n 0
+
+spin :: Int -> Int -> Int
+spin 0 acc = acc
+spin k acc = spin (k - 1) ((acc * 31 + k) `rem` 1000003)
+
+main :: IO ()
+main = do
+  -- Make the RTS see contention on mkBox's thunk, so that it starts
+  -- blackholing those thunks eagerly (+RTS -qe1).  Evaluating these
+  -- allocates, so their owners pause and blackhole them lazily.
+  started <- newIORef False
+  forM_ [1 .. 20] $ \i -> do
+    Box x <- evaluate (mkBox started (negate (i * 20000)))
+    rs <- forM [1 .. 4 :: Int] $ \_ -> do
+      r <- newEmptyMVar
+      _ <- forkIO $ putMVar r $! x
+      return r
+    mapM_ takeMVar rs
+
+  -- Now one thread evaluates a thunk of the same kind without ever
+  -- yielding, and another blocks on it in the meantime.
+  Box y <- evaluate (mkBox started 100000000)
+  owner <- newEmptyMVar
+  blocked <- newEmptyMVar
+  _ <- forkOn 0 $ evaluate y >>= putMVar owner
+  _ <- forkOn 1 $ do
+    let wait = do s <- readIORef started
+                  unless s (yield >> wait)
+    wait
+    evaluate y >>= putMVar blocked
+  a <- takeMVar owner
+  b <- takeMVar blocked
+  print (a == b)
@@ -0,0 +1,19 @@
+import Control.Concurrent
+import Control.Monad
+import Foreign.C.Types
+
+-- Lots of short safe foreign calls from several threads at once, with
+-- a pool of spare workers and spinning while waiting to return (see
+-- Note [Spinning for a Capability] in rts/Capability.c).
+
+foreign import ccall safe "abs" c_abs :: CInt -> IO CInt
+
+main :: IO ()
+main = do
+  results <- forM [1..4] $ \t -> do
+    r <- newEmptyMVar
+    _ <- forkIO $ do
+      xs <- forM [1..20000] $ \i -> c_abs (negate (fromIntegral (t + i)))
+      putMVar r $! sum (map fromIntegral xs :: [Integer])
+    return r
+  mapM takeMVar results >>= print
@@ -0,0 +1,39 @@
+import Control.Concurrent
+import Control.Exception
+import Control.Monad
+
+-- Exercise +RTS -qt: lots of short-lived threads are forked on one
+-- Capability for the others to steal, some of them are killed while
+-- they may be waiting to be stolen, and threads created with forkOn
+-- must stay where they were put.
+
+main :: IO ()
+main = do
+  n <- getNumCapabilities
+  rs <- forM [1..1000] $ \i -> do
+    r <- newEmptyMVar
+    t <- forkIO $ do
+      x <- evaluate (work i)
+      yield
+      putMVar r (Just x)
+    return (t, r)
+  forM_ (zip [0..] rs) $ \(i, (t, r)) ->
+    when (i `mod` 3 == (0 :: Int)) $ do
+      killThread t
+      void (tryPutMVar r Nothing)
+  xs <- mapM (takeMVar . snd) rs
+  print (length [ () | Just _ <- xs ] >= 666)
+
+  ok <- forM [0 .. n-1] $ \c -> do
+    r <- newEmptyMVar
+    _ <- forkOn c $ do
+      replicateM_ 100 $ do
+        _ <- evaluate (work c)
+        yield
+      (c', locked) <- threadCapability =<< myThreadId
+      putMVar r (c' == c && locked)
+    takeMVar r
+  print (and ok)
+
+work :: Int -> Int
+work i = sum [ j `mod` 7 | j <- [1 .. 1000 + i] ]
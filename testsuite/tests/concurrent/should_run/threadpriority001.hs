@@ -0,0 +1,37 @@
+import Control.Concurrent
+import Control.Monad
+import Data.IORef
+import GHC.Conc
+
+-- With one capability, a HighPriority thread that becomes runnable at
+-- the same time as a LowPriority one runs first.
+
+main :: IO ()
+main = do
+  self <- myThreadId
+  getThreadPriority self >>= print
+  forM_ [LowPriority, HighPriority, NormalPriority] $ \p -> do
+    setThreadPriority self p
+    getThreadPriority self >>= print
+
+  start <- newEmptyMVar
+  done <- newEmptyMVar
+  ref <- newIORef []
+  let worker name = forkIO $ do
+        readMVar start
+        atomicModifyIORef ref (\xs -> (name : xs, ()))
+        putMVar done ()
+  low <- worker "low"
+  high <- worker "high"
+  setThreadPriority low LowPriority
+  setThreadPriority high HighPriority
+  let waitBlocked t = do
+        s <- threadStatus t
+        case s of
+          ThreadBlocked _ -> return ()
+          _ -> yield >> waitBlocked t
+  mapM_ waitBlocked [low, high]
+  putMVar start ()
+  takeMVar done
+  takeMVar done
+  readIORef ref >>= print . reverse
@@ -0,0 +1,24 @@
+{-# LANGUAGE ForeignFunctionInterface #-}
+import Control.Concurrent
+import Control.Monad
+import Foreign.StablePtr
+import GHC.Conc
+
+-- Set and read thread priorities through the C API
+-- (rts_setThreadPriority and rts_getThreadPriority).
+
+foreign import ccall safe "set_priority"
+  set_priority :: StablePtr ThreadId -> Int -> IO Int
+
+main :: IO ()
+main = do
+  block <- newEmptyMVar
+  t <- forkIO (readMVar block)
+  sp <- newStablePtr t
+  -- ThreadPriorityHigh, ThreadPriorityNormal, ThreadPriorityLow
+  forM_ [0, 2, 1] $ \p -> do
+    r <- set_priority sp p
+    print r
+    getThreadPriority t >>= print
+  freeStablePtr sp
+  putMVar block ()
@@ -0,0 +1,15 @@
+#include "Rts.h"
+
+HsInt set_priority (HsStablePtr sp, HsInt priority)
+{
+    Capability *cap;
+    HaskellObj tid;
+    HsInt r;
+
+    cap = rts_lock();
+    tid = (HaskellObj)deRefStablePtr(sp);
+    rts_setThreadPriority(cap, tid, priority);
+    r = rts_getThreadPriority(tid);
+    rts_unlock(cap);
+    return r;
+}
@@ -0,0 +1,61 @@
+-- Create and free lots of adjustors of a couple of different sizes, so
+-- that their memory gets reused (see Note [Adjustor pool] in
+-- rts/AdjustorPool.c), and free some from a different thread than the
+-- one that created them, and from a C thread.
+
+import Control.Concurrent
+import Control.Monad
+import Foreign.C
+import Foreign.Marshal.Array
+import Foreign.Ptr
+
+type F1 = Int -> IO Int
+type F8 = Int -> Int -> Int -> Int -> Int -> Int -> Int -> Int -> IO Int
+
+foreign import ccall "wrapper" mkF1 :: F1 -> IO (FunPtr F1)
+foreign import ccall "dynamic" callF1 :: FunPtr F1 -> F1
+
+foreign import ccall "wrapper" mkF8 :: F8 -> IO (FunPtr F8)
+foreign import ccall "dynamic" callF8 :: FunPtr F8 -> F8
+
+foreign import ccall safe "free_fun_ptrs_in_thread"
+  freeFunPtrsInThread :: Ptr (FunPtr F1) -> CInt -> IO ()
+
+oneRound :: Int -> IO Int
+oneRound r = do
+  f1s <- forM [1 .. 1000] $ \i -> mkF1 (\x -> return (x + i + r))
+  f8s <- forM [1 .. 1000] $ \i ->
+           mkF8 (\a b c d e f g h -> return (a + b + c + d + e + f + g + h + i))
+  s1 <- foldM (\acc f -> (acc +) <$> callF1 f 1) 0 f1s
+  s8 <- foldM (\acc f -> (acc +) <$> callF8 f 1 1 1 1 1 1 1 1) 0 f8s
+  mapM_ freeHaskellFunPtr f1s
+  mapM_ freeHaskellFunPtr f8s
+  return (s1 + s8)
+
+main :: IO ()
+main = do
+  rs <- mapM oneRound [1 .. 20]
+  print (sum rs)
+
+  -- adjustors created by one thread and freed by another
+  mv <- newEmptyMVar
+  done <- newEmptyMVar
+  _ <- forkIO $ do
+         replicateM_ 20 (takeMVar mv >>= mapM_ freeHaskellFunPtr)
+         putMVar done ()
+  ss <- forM [1 .. 20] $ \r -> do
+          fs <- forM [1 .. 1000] $ \i -> mkF1 (\x -> return (x * i))
+          s <- foldM (\acc f -> (acc +) <$> callF1 f r) 0 fs
+          putMVar mv fs
+          return s
+  takeMVar done
+  print (sum ss)
+
+  -- adjustors freed by a thread that doesn't own a Capability, and
+  -- then reused
+  ts <- forM [1 .. 5] $ \r -> do
+          fs <- forM [1 .. 1000] $ \i -> mkF1 (\x -> return (x - i))
+          s <- foldM (\acc f -> (acc +) <$> callF1 f r) 0 fs
+          withArrayLen fs $ \n p -> freeFunPtrsInThread p (fromIntegral n)
+          return s
+  print (sum ts)
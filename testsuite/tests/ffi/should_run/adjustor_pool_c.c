@@ -0,0 +1,28 @@
+#include "HsFFI.h"
+#include <pthread.h>
+
+struct fun_ptrs {
+    HsFunPtr *fps;
+    int n;
+};
+
+static void *free_fun_ptrs (void *arg)
+{
+    struct fun_ptrs *p = arg;
+    int i;
+
+    for (i = 0; i < p->n; i++) {
+        hs_free_fun_ptr(p->fps[i]);
+    }
+    return NULL;
+}
+
+// Free the adjustors from a thread that has never run Haskell code
+void free_fun_ptrs_in_thread (HsFunPtr *fps, int n)
+{
+    struct fun_ptrs p = { fps, n };
+    pthread_t t;
+
+    pthread_create(&t, NULL, free_fun_ptrs, &p);
+    pthread_join(t, NULL);
+}
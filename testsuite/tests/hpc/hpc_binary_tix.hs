@@ -0,0 +1,12 @@
+-- Coverage data in a binary .tix file (HPCTIXFORMAT=binary) should
+-- accumulate over runs like the textual format, and should read back
+-- the same.
+
+classify :: Int -> String
+classify n
+  | n < 3     = "small"
+  | n < 8     = "medium"
+  | otherwise = "large"
+
+main :: IO ()
+main = mapM_ (putStrLn . classify) [1, 5]
@@ -0,0 +1,22 @@
+import Control.Concurrent
+import Control.Monad
+
+-- Many threads sleeping in threadDelay at the same time, as with one
+-- timeout per connection, for increasing numbers of threads.  Each
+-- thread wakes up later than the ones forked before it, which is the
+-- worst case for keeping the sleeping threads in a sorted list.  Run
+-- with +RTS -s and look at how the elapsed time grows with the number
+-- of threads.
+
+sleepers :: Int -> IO ()
+sleepers n = do
+  done <- newEmptyMVar
+  forM_ [1..n] $ \i -> forkIO $ do
+    threadDelay (100000 + i)
+    putMVar done ()
+  replicateM_ n (takeMVar done)
+
+main :: IO ()
+main = forM_ [1000, 10000, 50000] $ \n -> do
+  sleepers n
+  print n
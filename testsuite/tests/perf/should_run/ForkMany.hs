@@ -0,0 +1,39 @@
+import Control.Concurrent
+import Control.Monad
+import GHC.Stats
+import System.Mem
+
+-- Fork a short-lived thread per "request", many times over, as a
+-- server with one thread per request does.  Most threads are created
+-- from the TSOs and stacks of threads that have already died (see Note
+-- [Recycling dead threads] in rts/Threads.c).  Run with +RTS -s and
+-- look at the elapsed time and the bytes allocated.
+
+forkBatch :: MVar Int -> Int -> IO ()
+forkBatch done n = do
+  forM_ [1 .. n] $ \i -> forkIO $ putMVar done $! i * 2
+  replicateM_ n (takeMVar done)
+
+main :: IO ()
+main = do
+  done <- newEmptyMVar
+  replicateM_ 20 (forkBatch done 10000)
+  print (20 * 10000 :: Int)
+
+  -- Check that the threads really are recycled.  Each GC keeps up to
+  -- 32 dead threads (MAX_FREE_TSOS) for reuse, so fork 32 at a time
+  -- with a GC in between.  A thread that isn't recycled costs a new
+  -- TSO and stack, which take 1k (the default -ki) between them; a
+  -- recycled one only costs the closures forkIO allocates.
+  performGC
+  before <- getGCStats
+  replicateM_ rounds (forkBatch done 32 >> performGC)
+  after <- getGCStats
+  let per_fork = (bytesAllocated after - bytesAllocated before)
+                 `div` fromIntegral (rounds * 32)
+  putStrLn $ if per_fork < 1024
+               then "threads were recycled"
+               else "threads were not recycled: " ++ show per_fork
+                    ++ " bytes allocated per forkIO"
+  where
+    rounds = 500
@@ -0,0 +1,35 @@
+-- A bytecode interpreter benchmark: building and searching a binary
+-- search tree, which is mostly constructor allocation and case analysis.
+
+import Data.List (foldl')
+
+data Tree = Leaf | Node Tree !Int Tree
+
+insert :: Int -> Tree -> Tree
+insert x Leaf = Node Leaf x Leaf
+insert x t@(Node l y r)
+  | x < y     = Node (insert x l) y r
+  | x > y     = Node l y (insert x r)
+  | otherwise = t
+
+member :: Int -> Tree -> Bool
+member _ Leaf = False
+member x (Node l y r)
+  | x < y     = member x l
+  | x > y     = member x r
+  | otherwise = True
+
+size :: Tree -> Int
+size Leaf         = 0
+size (Node l _ r) = size l + 1 + size r
+
+depth :: Tree -> Int
+depth Leaf         = 0
+depth (Node l _ r) = 1 + max (depth l) (depth r)
+
+main :: IO ()
+main = do
+  let keys = take 20000 (iterate (\k -> (k * 75 + 74) `mod` 65537) 1)
+      t    = foldl' (flip insert) Leaf keys
+  print (size t, depth t)
+  print (length (filter (`member` t) [0, 3 .. 65536]))
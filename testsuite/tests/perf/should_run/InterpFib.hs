@@ -0,0 +1,11 @@
+-- A bytecode interpreter benchmark: naive fib, which is mostly calls,
+-- comparisons and arithmetic on boxed Ints.  Run it in GHCi and look at
+-- the elapsed time.
+
+fib :: Int -> Int
+fib n
+  | n < 2     = n
+  | otherwise = fib (n - 1) + fib (n - 2)
+
+main :: IO ()
+main = print (fib 25)
@@ -0,0 +1,14 @@
+-- A bytecode interpreter benchmark: a strict left fold and a map, both
+-- defined here so that they are interpreted too, which makes it heavy
+-- in unknown calls of functions passed as arguments.
+
+myFoldl :: (b -> a -> b) -> b -> [a] -> b
+myFoldl _ z []     = z
+myFoldl f z (x:xs) = let z' = f z x in z' `seq` myFoldl f z' xs
+
+myMap :: (a -> b) -> [a] -> [b]
+myMap _ []     = []
+myMap f (x:xs) = f x : myMap f xs
+
+main :: IO ()
+main = print (myFoldl (+) 0 (myMap (\x -> (x * 3) `mod` 7) [1 .. 1000000 :: Int]))
@@ -0,0 +1,11 @@
+-- A bytecode interpreter benchmark: an interpreted loop that calls
+-- compiled library code (show, length) on every iteration, so it
+-- switches between the interpreter and compiled code all the time (see
+-- Note [Switching evaluators] in rts/Schedule.c).
+
+digits :: Int -> Int -> Int
+digits acc 0 = acc
+digits acc n = let acc' = acc + length (show n) in acc' `seq` digits acc' (n - 1)
+
+main :: IO ()
+main = print (digits 0 200000)
@@ -0,0 +1,16 @@
+import GHC.Conc (par, pseq)
+
+-- A spark-heavy benchmark: very fine-grained parallel fib, so that
+-- idle capabilities spend their time stealing sparks.  Run with
+-- +RTS -N -s and look at the elapsed time and the SPARKS line.
+
+pfib :: Int -> Int
+pfib n
+  | n < 2     = 1
+  | otherwise = x `par` (y `pseq` x + y + 1)
+  where
+    x = pfib (n - 1)
+    y = pfib (n - 2)
+
+main :: IO ()
+main = print (pfib 30)
@@ -0,0 +1,50 @@
+#include "ghcconfig.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include "Rts.h"
+
+// Load an archive and call a function from one of its members, which
+// calls a function from another member.  A third member refers to a
+// symbol that doesn't exist, but nothing needs it, so it is never
+// loaded.
+
+typedef int testfun(int);
+
+int main (int argc, char *argv[])
+{
+    testfun *f;
+    int r;
+
+    hs_init(&argc, &argv);
+
+    initLinker_(0);
+
+    if (argc != 2) {
+        errorBelch("syntax: linker_archive_lazy <archive>");
+        exit(1);
+    }
+
+    r = loadArchive(argv[1]);
+    if (!r) {
+        errorBelch("loadArchive(%s) failed", argv[1]);
+        exit(1);
+    }
+    r = resolveObjs();
+    if (!r) {
+        errorBelch("resolveObjs failed");
+        exit(1);
+    }
+#if LEADING_UNDERSCORE
+    f = lookupSymbol("_lazy_a");
+#else
+    f = lookupSymbol("lazy_a");
+#endif
+    if (!f) {
+        errorBelch("lookupSymbol failed");
+        exit(1);
+    }
+    printf("%d\n", f(20));
+
+    hs_exit();
+    return 0;
+}
@@ -0,0 +1,6 @@
+extern int lazy_b(int x);
+
+int lazy_a(int x)
+{
+    return lazy_b(x) + 1;
+}
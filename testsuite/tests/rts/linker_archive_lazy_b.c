@@ -0,0 +1,4 @@
+int lazy_b(int x)
+{
+    return 2 * x;
+}
@@ -0,0 +1,6 @@
+extern int lazy_does_not_exist(int x);
+
+int lazy_c(int x)
+{
+    return lazy_does_not_exist(x);
+}
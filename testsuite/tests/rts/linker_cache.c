@@ -0,0 +1,50 @@
+#include "ghcconfig.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include "Rts.h"
+
+// Load an object and call a function from it.  Run with
+// +RTS --linker-cache: the first run relocates the object and saves it
+// in the cache, the second maps it back from there.  The Makefile
+// checks which of the two happened in the +RTS -Dl output.
+
+typedef int testfun(int);
+
+int main (int argc, char *argv[])
+{
+    testfun *f;
+    int r;
+
+    hs_init(&argc, &argv);
+
+    initLinker_(0);
+
+    if (argc != 2) {
+        errorBelch("syntax: linker_cache <object>");
+        exit(1);
+    }
+
+    r = loadObj(argv[1]);
+    if (!r) {
+        errorBelch("loadObj(%s) failed", argv[1]);
+        exit(1);
+    }
+    r = resolveObjs();
+    if (!r) {
+        errorBelch("resolveObjs failed");
+        exit(1);
+    }
+#if LEADING_UNDERSCORE
+    f = lookupSymbol("_cache_f");
+#else
+    f = lookupSymbol("cache_f");
+#endif
+    if (!f) {
+        errorBelch("lookupSymbol failed");
+        exit(1);
+    }
+    printf("%d\n", f(20));
+
+    hs_exit();
+    return 0;
+}
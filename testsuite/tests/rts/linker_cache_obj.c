@@ -0,0 +1,15 @@
+#include <stddef.h>
+
+// Refers to data in another section and to a function in the RTS, so
+// the cached copy is only usable if both are where they were.
+
+extern void stg_exit(int n);
+
+static int offsets[] = { 1, 21 };
+int *cache_offset = &offsets[1];
+void (*cache_exit)(int) = stg_exit;
+
+int cache_f (int x)
+{
+    return x + *cache_offset + (cache_exit == NULL);
+}
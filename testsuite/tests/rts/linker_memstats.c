@@ -0,0 +1,86 @@
+#include "ghcconfig.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include "Rts.h"
+
+// Load and unload an object repeatedly, and check that the linker
+// reuses the memory it frees.
+
+#define ITERATIONS 100
+
+typedef int testfun(int);
+
+static StgWord64 mapped (LinkerMemStats *stats)
+{
+    return stats->code_bytes + stats->rodata_bytes + stats->rwdata_bytes;
+}
+
+int main (int argc, char *argv[])
+{
+    LinkerMemStats stats, first;
+    testfun *f;
+    int i, r;
+
+    hs_init(&argc, &argv);
+
+    initLinker_(0);
+
+    if (argc != 2) {
+        errorBelch("syntax: linker_memstats <object>");
+        exit(1);
+    }
+
+    for (i = 0; i < ITERATIONS; i++) {
+        r = loadObj(argv[1]);
+        if (!r) {
+            errorBelch("loadObj(%s) failed", argv[1]);
+            exit(1);
+        }
+        r = resolveObjs();
+        if (!r) {
+            errorBelch("resolveObjs failed");
+            exit(1);
+        }
+#if LEADING_UNDERSCORE
+        f = lookupSymbol("_memstats_f");
+#else
+        f = lookupSymbol("memstats_f");
+#endif
+        if (!f) {
+            errorBelch("lookupSymbol failed");
+            exit(1);
+        }
+        r = f(20);
+        if (r != 41) {
+            errorBelch("call failed; %d", r);
+            exit(1);
+        }
+
+        getLinkerMemStats(&stats);
+        if (i == 0) {
+            first = stats;
+            printf("code: %d, rodata: %d, rwdata: %d\n",
+                   stats.code_bytes > 0, stats.rodata_bytes > 0,
+                   stats.rwdata_bytes > 0);
+        } else if (mapped(&stats) > mapped(&first)) {
+            errorBelch("linker memory grew from %" FMT_Word64
+                       " to %" FMT_Word64 " bytes",
+                       mapped(&first), mapped(&stats));
+            exit(1);
+        }
+
+        unloadObj(argv[1]);
+        performMajorGC();
+
+        getLinkerMemStats(&stats);
+        if (stats.allocated_bytes != 0) {
+            errorBelch("%" FMT_Word64 " bytes still allocated after unloading",
+                       stats.allocated_bytes);
+            exit(1);
+        }
+    }
+    printf("ok\n");
+
+    hs_exit();
+    return 0;
+}
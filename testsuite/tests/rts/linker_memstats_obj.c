@@ -0,0 +1,10 @@
+// Has code, read-only data and writable data.
+
+static const int offsets[] = { 1, 21 };
+int counter = 1;
+
+int memstats_f (int x)
+{
+    counter++;
+    return x + offsets[(x >> 2) & 1];
+}
@@ -0,0 +1,15 @@
+import Control.Monad
+
+-- A non-tail-recursive function whose stack repeatedly grows and
+-- shrinks across chunk boundaries, so that stack chunks are taken from
+-- and returned to the per-Capability cache (see Note [Stack chunk
+-- cache] in rts/Threads.c).
+
+count :: Int -> Int
+count 0 = 0
+count n = 1 + count (n - 1)
+
+main :: IO ()
+main = do
+  rs <- forM [1 .. 2000] $ \i -> return $! count (i * 10)
+  print (sum rs)
@@ -0,0 +1,219 @@
+#include "Rts.h"
+#include "Hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Checks OpenHashTable against HashTable.  With an argument N, instead
+// times inserting and looking up N symbol-like strings in both.
+
+#define KEYS 100000
+
+static char **mkKeys (int n)
+{
+    char **keys = malloc(n * sizeof(char *));
+    char buf[64];
+    int i;
+    for (i = 0; i < n; i++) {
+        sprintf(buf, "base_GHCziBase_zdfMonadIO%d_closure", i);
+        keys[i] = strdup(buf);
+    }
+    return keys;
+}
+
+static void check (int ok, const char *what)
+{
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        exit(1);
+    }
+}
+
+// A poor hash, so that we get long clusters
+static StgWord hashMod7 (StgWord key)
+{
+    return key % 7;
+}
+
+// Home slots in the last two entries of the table, whatever its size,
+// so that the clusters wrap around the end of the array
+static StgWord hashNearEnd (StgWord key)
+{
+    return ~(StgWord)0 - (key & 1);
+}
+
+static int compareWord (StgWord a, StgWord b)
+{
+    return a == b;
+}
+
+static void testStr (void)
+{
+    char **keys = mkKeys(KEYS);
+    OpenHashTable *t = allocStrOpenHashTable();
+    HashTable *ref = allocStrHashTable();
+    char other[64];
+    int i;
+
+    for (i = 0; i < KEYS; i++) {
+        insertStrOpenHashTable(t, keys[i], keys[i]);
+        insertStrHashTable(ref, keys[i], keys[i]);
+    }
+    check(keyCountOpenHashTable(t) == KEYS, "count");
+
+    for (i = 0; i < KEYS; i++) {
+        // a copy, to check that we compare strings rather than pointers
+        strcpy(other, keys[i]);
+        check(lookupStrOpenHashTable(t, other) == keys[i], "lookup");
+        check(lookupStrOpenHashTable(t, other) ==
+              lookupStrHashTable(ref, other), "lookup agrees");
+    }
+    check(lookupStrOpenHashTable(t, "no_such_symbol") == NULL, "missing");
+
+    for (i = 0; i < KEYS; i += 2) {
+        check(removeStrOpenHashTable(t, keys[i], NULL) == keys[i], "remove");
+    }
+    for (i = 0; i < KEYS; i++) {
+        check(lookupStrOpenHashTable(t, keys[i]) ==
+              (i % 2 ? keys[i] : NULL), "lookup after remove");
+    }
+    check(keyCountOpenHashTable(t) == KEYS / 2, "count after remove");
+
+    freeOpenHashTable(t, NULL);
+    freeHashTable(ref, NULL);
+    for (i = 0; i < KEYS; i++) free(keys[i]);
+    free(keys);
+}
+
+static void testClusters (void)
+{
+    OpenHashTable *t = allocOpenHashTable(hashMod7, compareWord);
+    StgWord keys[1000];
+    int i, n;
+
+    // The newest of several equal keys is found first, also after the
+    // table has grown and after other keys have been removed
+    insertOpenHashTable(t, 42, (void *)42);
+    for (i = 1; i <= 1000; i++) {
+        if (i != 42) {
+            insertOpenHashTable(t, i, (void *)(StgWord)i);
+        }
+        insertOpenHashTable(t, 42, (void *)(StgWord)(i * 10000));
+    }
+    for (i = 1; i <= 1000; i++) {
+        if (i != 42) {
+            check(removeOpenHashTable(t, i, NULL) == (void *)(StgWord)i,
+                  "remove from cluster");
+        }
+    }
+    for (i = 1000; i >= 1; i--) {
+        check(lookupOpenHashTable(t, 42) == (void *)(StgWord)(i * 10000),
+              "newest first");
+        check(removeOpenHashTable(t, 42, NULL) == (void *)(StgWord)(i * 10000),
+              "remove newest");
+    }
+    check(removeOpenHashTable(t, 42, (void *)42) == (void *)42,
+          "remove by data");
+    check(lookupOpenHashTable(t, 42) == NULL, "all removed");
+
+    for (i = 0; i < 100; i++) {
+        insertOpenHashTable(t, i * 7, (void *)(StgWord)(i + 1));
+    }
+    n = keysOpenHashTable(t, keys, 1000);
+    check(n == 100 && keyCountOpenHashTable(t) == 100, "keys");
+
+    freeOpenHashTable(t, NULL);
+}
+
+static void testWrap (void)
+{
+    OpenHashTable *t = allocOpenHashTable(hashNearEnd, compareWord);
+    StgWord i;
+
+    // Removing entries from a cluster that wraps around: the entries
+    // after the end of the array must shift back over it
+    insertOpenHashTable(t, 1000, (void *)1);
+    for (i = 1; i <= 40; i++) {
+        insertOpenHashTable(t, i, (void *)i);
+    }
+    for (i = 1; i <= 40; i += 3) {
+        check(removeOpenHashTable(t, i, NULL) == (void *)i,
+              "remove from wrapped cluster");
+    }
+    for (i = 1; i <= 40; i++) {
+        check(lookupOpenHashTable(t, i) == (i % 3 == 1 ? NULL : (void *)i),
+              "lookup in wrapped cluster");
+    }
+
+    // Growing the table while a cluster wraps around: equal keys must
+    // stay newest first, although the older one is now past the end
+    insertOpenHashTable(t, 1000, (void *)2);
+    for (i = 41; i <= 100; i++) {
+        insertOpenHashTable(t, i, (void *)i);
+    }
+    check(lookupOpenHashTable(t, 1000) == (void *)2, "newest after grow");
+    check(removeOpenHashTable(t, 1000, NULL) == (void *)2, "remove newest");
+    check(lookupOpenHashTable(t, 1000) == (void *)1, "oldest after grow");
+    check(removeOpenHashTable(t, 1000, NULL) == (void *)1, "remove oldest");
+    for (i = 1; i <= 100; i++) {
+        check(lookupOpenHashTable(t, i) ==
+              (i <= 40 && i % 3 == 1 ? NULL : (void *)i),
+              "lookup after grow");
+    }
+
+    for (i = 1; i <= 100; i++) {
+        if (i > 40 || i % 3 != 1) {
+            check(removeOpenHashTable(t, i, NULL) == (void *)i,
+                  "remove after grow");
+        }
+    }
+    check(keyCountOpenHashTable(t) == 0, "count after wrap");
+
+    freeOpenHashTable(t, NULL);
+}
+
+static double seconds (clock_t start)
+{
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void bench (int n)
+{
+    char **keys = mkKeys(n);
+    HashTable *h;
+    OpenHashTable *o;
+    clock_t start;
+    int i, r;
+
+    start = clock();
+    h = allocStrHashTable();
+    for (i = 0; i < n; i++) insertStrHashTable(h, keys[i], keys[i]);
+    for (r = 0; r < 10; r++) {
+        for (i = 0; i < n; i++) lookupStrHashTable(h, keys[i]);
+    }
+    printf("HashTable:     %.3fs\n", seconds(start));
+    freeHashTable(h, NULL);
+
+    start = clock();
+    o = allocStrOpenHashTable();
+    for (i = 0; i < n; i++) insertStrOpenHashTable(o, keys[i], keys[i]);
+    for (r = 0; r < 10; r++) {
+        for (i = 0; i < n; i++) lookupStrOpenHashTable(o, keys[i]);
+    }
+    printf("OpenHashTable: %.3fs\n", seconds(start));
+    freeOpenHashTable(o, NULL);
+}
+
+int main (int argc, char *argv[])
+{
+    if (argc > 1) {
+        bench(atoi(argv[1]));
+        return 0;
+    }
+    testStr();
+    testClusters();
+    testWrap();
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,87 @@
+#define THREADED_RTS
+
+#include "Rts.h"
+#include "WSDeque.h"
+#include <stdio.h>
+
+// Test stealHalfWSDeque_(): one thread pushes, several threads steal
+// batches.  Every element must be stolen exactly once.
+
+#define SCRATCH_SIZE (1024*1024)
+#define THREADS 3
+#define BATCH 16
+
+WSDeque *q;
+
+StgWord scratch[SCRATCH_SIZE];
+volatile StgWord done;
+volatile StgWord finished;
+
+OSThreadId ids[THREADS];
+
+void work(void *p, uint32_t n)
+{
+    StgWord val;
+
+    val = *(StgWord *)p;
+    if (val != 0) {
+        fflush(stdout);
+        fflush(stderr);
+        barf("FAIL: %p %d %ld", p, n, val);
+    }
+    *(StgWord*)p = n+10;
+}
+
+void OSThreadProcAttr thief(void *info)
+{
+    void *buf[BATCH];
+    StgWord n;
+    uint32_t i, stolen;
+
+    n = (StgWord)info;
+
+    while (!done || !looksEmptyWSDeque(q)) {
+        stolen = stealHalfWSDeque_(q, buf, BATCH);
+        for (i = 0; i < stolen; i++) {
+            work(buf[i], n+1);
+        }
+    }
+    atomic_inc(&finished, 1);
+}
+
+int main(int argc, char*argv[])
+{
+    int n;
+
+    q = newWSDeque(1024);
+    done = 0;
+    finished = 0;
+
+    for (n=0; n < SCRATCH_SIZE; n++) {
+        scratch[n] = 0;
+    }
+
+    for (n=0; n < THREADS; n++) {
+        createOSThread(&ids[n], "thief", thief, (void*)(StgWord)n);
+    }
+
+    for (n=0; n < SCRATCH_SIZE; n++) {
+        while (!pushWSDeque(q,&scratch[n])) {
+            yieldThread();
+        }
+    }
+    done = 1;
+
+    while (finished != THREADS) {
+        yieldThread();
+    }
+
+    for (n=0; n < SCRATCH_SIZE; n++) {
+        if (scratch[n] == 0) {
+            barf("FAIL: element %d was never stolen", n);
+        }
+    }
+
+    printf("OK\n");
+    exit(0);
+}
@@ -0,0 +1,41 @@
+import Foreign.C
+import Foreign.Marshal.Array
+import Foreign.Ptr
+import Foreign.Storable
+import Control.Concurrent
+import Control.Monad
+import System.Timeout
+
+-- The test works only on UNIX like.
+-- unportable bits:
+import qualified System.Posix.Internals as SPI
+import qualified System.Posix.Types as SPT
+
+pipe :: IO (CInt, CInt)
+pipe = allocaArray 2 $ \fds -> do
+    throwErrnoIfMinus1_ "pipe" $ SPI.c_pipe fds
+    rd <- peekElemOff fds 0
+    wr <- peekElemOff fds 1
+    return (rd, wr)
+
+-- A thread waits on a pipe whose read end is then closed and the fd
+-- number reused for a new pipe.  A second thread waiting on the new
+-- pipe, for the same event, must still be woken up: the kernel has
+-- dropped the fd from the non-threaded RTS's epoll set, so the RTS has
+-- to register it again.
+main :: IO ()
+main = do
+    (r1, w1) <- pipe
+    _ <- forkIO $ threadWaitRead (SPT.Fd r1)   -- thread A
+    threadDelay 100000   -- A is now blocked on r1
+    _ <- SPI.c_close r1
+    (r2, w2) <- pipe
+    when (r2 /= r1) $ putStrLn "fd number was not reused"
+    done <- newEmptyMVar
+    _ <- forkIO $ do threadWaitRead (SPT.Fd r2)   -- thread B
+                     putMVar done ()
+    threadDelay 100000   -- B is now blocked on r2
+    _ <- withCString "x" $ \s -> SPI.c_write w2 (castPtr s) 1
+    r <- timeout 5000000 (takeMVar done)
+    putStrLn (maybe "thread B hung" (const "thread B woke up") r)
+    mapM_ SPI.c_close [w1, r2, w2]
@@ -636,6 +636,9 @@ wanteds os = concat
 
           ,constantWord Haskell "MUT_ARR_PTRS_CARD_BITS" "MUT_ARR_PTRS_CARD_BITS"
 
+          ,constantWord Haskell "EAGER_BH_TABLE_BITS" "EAGER_BH_TABLE_BITS"
+          ,constantWord Haskell "EAGER_BH_SHIFT"      "EAGER_BH_SHIFT"
+
           -- A section of code-generator-related MAGIC CONSTANTS.
           ,constantWord Haskell "MAX_Vanilla_REG"      "MAX_VANILLA_REG"
           ,constantWord Haskell "MAX_Float_REG"        "MAX_FLOAT_REG"
@@ -5,10 +5,11 @@
 
 module HpcCombine (sum_plugin,combine_plugin,map_plugin) where
 
-import Trace.Hpc.Tix
+import Trace.Hpc.Tix hiding (readTix)
 import Trace.Hpc.Util
 
 import HpcFlags
+import HpcTixFile (readTix)
 
 import Control.Monad
 import qualified Data.Set as Set
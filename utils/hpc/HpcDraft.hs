@@ -1,10 +1,11 @@
 module HpcDraft (draft_plugin) where
 
-import Trace.Hpc.Tix
+import Trace.Hpc.Tix hiding (readTix)
 import Trace.Hpc.Mix
 import Trace.Hpc.Util
 
 import HpcFlags
+import HpcTixFile (readTix)
 
 import qualified Data.Set as Set
 import qualified Data.Map as Map
@@ -6,10 +6,11 @@
 module HpcMarkup (markup_plugin) where
 
 import Trace.Hpc.Mix
-import Trace.Hpc.Tix
+import Trace.Hpc.Tix hiding (readTix)
 import Trace.Hpc.Util
 
 import HpcFlags
+import HpcTixFile (readTix)
 import HpcUtils
 
 import System.Directory
@@ -8,8 +8,9 @@ module HpcReport (report_plugin) where
 import Prelude hiding (exp)
 import Data.List(sort,intersperse,sortBy)
 import HpcFlags
+import HpcTixFile (readTix)
 import Trace.Hpc.Mix
-import Trace.Hpc.Tix
+import Trace.Hpc.Tix hiding (readTix)
 import Control.Monad hiding (guard)
 import qualified Data.Set as Set
 
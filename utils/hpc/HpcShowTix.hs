@@ -1,9 +1,10 @@
 module HpcShowTix (showtix_plugin) where
 
 import Trace.Hpc.Mix
-import Trace.Hpc.Tix
+import Trace.Hpc.Tix hiding (readTix)
 
 import HpcFlags
+import HpcTixFile (readTix)
 
 import qualified Data.Set as Set
 
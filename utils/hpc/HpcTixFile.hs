@@ -0,0 +1,76 @@
+---------------------------------------------------------
+-- Reading .tix files in either of the formats the RTS
+-- writes: the textual one, read by Trace.Hpc.Tix, or the
+-- binary one, written when HPCTIXFORMAT=binary (see
+-- Note [Binary .tix files] in rts/Hpc.c).
+---------------------------------------------------------
+
+module HpcTixFile (readTix) where
+
+import qualified Trace.Hpc.Tix as Tix
+import Trace.Hpc.Tix (Tix(..), TixModule(..))
+import Trace.Hpc.Util (catchIO, toHash)
+
+import Control.Monad
+import Data.Char (chr)
+import Data.Word
+import Foreign.Marshal.Alloc (allocaBytes)
+import Foreign.Marshal.Array (peekArray)
+import Foreign.Ptr
+import Foreign.Storable
+import System.IO
+
+tixMagic :: String
+tixMagic = "HPCTIX01"
+
+tixByteOrder :: Word32
+tixByteOrder = 0x01020304
+
+readTix :: String -> IO (Maybe Tix)
+readTix file = do
+  binary <- catchIO (isBinaryTix file) (\ _ -> return False)
+  if binary
+    then fmap Just (readBinaryTix file)
+    else Tix.readTix file
+
+isBinaryTix :: FilePath -> IO Bool
+isBinaryTix file = withBinaryFile file ReadMode $ \ h -> do
+  size <- hFileSize h
+  if size < fromIntegral (length tixMagic)
+    then return False
+    else do magic <- replicateM (length tixMagic) (hGetChar h)
+            return (magic == tixMagic)
+
+readBinaryTix :: FilePath -> IO Tix
+readBinaryTix file = withBinaryFile file ReadMode $ \ h -> do
+  size <- fmap fromIntegral (hFileSize h)
+  allocaBytes size $ \ buf -> do
+    n <- hGetBuf h buf size
+    when (n /= size || size < 16) $ bad "truncated"
+    order <- peekByteOff buf 8 :: IO Word32
+    when (order /= tixByteOrder) $
+      bad "written on a machine with a different byte order"
+    n_modules <- peekByteOff buf 12 :: IO Word32
+    fmap Tix (readModules buf size (fromIntegral n_modules) 16)
+  where
+    bad msg = ioError (userError (file ++ ": " ++ msg ++ " binary .tix file"))
+
+    readModules :: Ptr Word8 -> Int -> Int -> Int -> IO [TixModule]
+    readModules _   _    0 _   = return []
+    readModules buf size k off = do
+      when (off + 16 > size) $ bad "truncated"
+      hash     <- peekByteOff buf off       :: IO Word32
+      count    <- peekByteOff buf (off + 4) :: IO Word32
+      name_len <- peekByteOff buf (off + 8) :: IO Word32
+      let name_off  = off + 16
+          ticks_off = name_off + ((fromIntegral name_len + 7) `div` 8) * 8
+          next      = ticks_off + 8 * fromIntegral count
+      when (next > size) $ bad "truncated"
+      name  <- peekArray (fromIntegral name_len) (buf `plusPtr` name_off)
+      ticks <- peekArray (fromIntegral count) (buf `plusPtr` ticks_off)
+      let m = TixModule (map (chr . fromIntegral) (name :: [Word8]))
+                        (toHash (fromIntegral hash :: Int))
+                        (fromIntegral count)
+                        (map toInteger (ticks :: [Word64]))
+      ms <- readModules buf size (k - 1) next
+      return (m : ms)
@@ -4,7 +4,13 @@ import Types
 
 optimizationsOptions :: [Flag]
 optimizationsOptions =
-  [ flag { flagName = "-fcall-arity"
+  [ flag { flagName = "-fadaptive-blackholing"
+         , flagDescription =
+           "Turn on :ref:`adaptive eager blackholing <parallel-compile-options>`"
+         , flagType = DynamicFlag
+         , flagReverse = "-fno-adaptive-blackholing"
+         }
+  , flag { flagName = "-fcall-arity"
          , flagDescription =
            "Enable call-arity optimisation. Implied by :ghc-flag:`-O`."
          , flagType = DynamicFlag